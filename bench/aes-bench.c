@@ -0,0 +1,240 @@
+/* Copyright (C) 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Verifies each AES-128 CBC kernel available on this CPU against FIPS-197
+ * and SP 800-38A vectors and measures its in-place decryption throughput.
+ *
+ * Usage: aes-bench [buffer size in KB]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gstdlnaaes.h"
+
+#define DEFAULT_BUFFER_KB 1024
+#define BENCH_USECS (G_USEC_PER_SEC / 2)
+
+// FIPS-197 appendix C.1
+static const guint8 fips_key[16] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+
+static const guint8 fips_plain[16] = {
+  0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+  0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+};
+
+static const guint8 fips_cipher[16] = {
+  0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+  0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a
+};
+
+// SP 800-38A F.2.1 and F.2.2, CBC-AES128
+static const guint8 cbc_key[16] = {
+  0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+  0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+static const guint8 cbc_iv[16] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+
+static const guint8 cbc_plain[64] = {
+  0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+  0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+  0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+  0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+  0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+  0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+  0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+  0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+};
+
+static const guint8 cbc_cipher[64] = {
+  0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46,
+  0xce, 0xe9, 0x8e, 0x9b, 0x12, 0xe9, 0x19, 0x7d,
+  0x50, 0x86, 0xcb, 0x9b, 0x50, 0x72, 0x19, 0xee,
+  0x95, 0xdb, 0x11, 0x3a, 0x91, 0x76, 0x78, 0xb2,
+  0x73, 0xbe, 0xd6, 0xb8, 0xe3, 0xc1, 0x74, 0x3b,
+  0x71, 0x16, 0xe6, 0x9e, 0x22, 0x22, 0x95, 0x16,
+  0x3f, 0xf1, 0xca, 0xa1, 0x68, 0x1f, 0xac, 0x09,
+  0x12, 0x0e, 0xca, 0x30, 0x75, 0x86, 0xe1, 0xa7
+};
+
+/**
+ * Checks supplied kernel against known answers and against encryption of
+ * random data, decrypting in pieces of varying size so that chaining of
+ * initialization vector across calls is covered.
+ *
+ * @param	impl	kernel to check
+ *
+ * @return	true if all checks passed, false otherwise
+ */
+static gboolean
+check_impl (GstDlnaSrcAesImpl impl)
+{
+  GstDlnaSrcAesKey key;
+  guint8 iv[16];
+  guint8 data[64];
+  guint8 *plain = NULL;
+  guint8 *buf = NULL;
+  gsize size = 64 * 1024 + 48;
+  gsize done = 0;
+  gsize len = 0;
+  gboolean ok = TRUE;
+  guint i = 0;
+
+  gst_dlna_src_aes_set_key (&key, fips_key);
+  memset (iv, 0, sizeof (iv));
+  memcpy (data, fips_cipher, 16);
+  gst_dlna_src_aes_cbc_decrypt (impl, &key, iv, data, 16);
+  if (memcmp (data, fips_plain, 16) != 0) {
+    g_printerr ("%s: FIPS-197 decryption mismatch\n",
+        gst_dlna_src_aes_impl_name (impl));
+    ok = FALSE;
+  }
+
+  gst_dlna_src_aes_set_key (&key, cbc_key);
+  memcpy (iv, cbc_iv, sizeof (iv));
+  memcpy (data, cbc_plain, sizeof (data));
+  gst_dlna_src_aes_cbc_encrypt (&key, iv, data, sizeof (data));
+  if (memcmp (data, cbc_cipher, sizeof (data)) != 0) {
+    g_printerr ("SP 800-38A encryption mismatch\n");
+    ok = FALSE;
+  }
+
+  memcpy (iv, cbc_iv, sizeof (iv));
+  memcpy (data, cbc_cipher, sizeof (data));
+  gst_dlna_src_aes_cbc_decrypt (impl, &key, iv, data, sizeof (data));
+  if ((memcmp (data, cbc_plain, sizeof (data)) != 0) ||
+      (memcmp (iv, cbc_cipher + 48, 16) != 0)) {
+    g_printerr ("%s: SP 800-38A decryption mismatch\n",
+        gst_dlna_src_aes_impl_name (impl));
+    ok = FALSE;
+  }
+
+  plain = g_malloc (size);
+  buf = g_malloc (size);
+  for (i = 0; i < size; i++)
+    plain[i] = g_random_int () & 0xff;
+  memcpy (buf, plain, size);
+  memcpy (iv, cbc_iv, sizeof (iv));
+  gst_dlna_src_aes_cbc_encrypt (&key, iv, buf, size);
+
+  memcpy (iv, cbc_iv, sizeof (iv));
+  for (i = 1; done < size; i++) {
+    len = MIN (16 * (i % 7 + 1) * i, size - done);
+    gst_dlna_src_aes_cbc_decrypt (impl, &key, iv, buf + done, len);
+    done += len;
+  }
+  if (memcmp (buf, plain, size) != 0) {
+    g_printerr ("%s: round trip mismatch\n",
+        gst_dlna_src_aes_impl_name (impl));
+    ok = FALSE;
+  }
+
+  g_free (plain);
+  g_free (buf);
+
+  return ok;
+}
+
+/**
+ * Measures throughput of in-place decryption of supplied buffer.
+ *
+ * @param	impl	kernel to measure
+ * @param	buf		buffer to decrypt repeatedly
+ * @param	size	size of buffer
+ *
+ * @return	throughput in MB/s
+ */
+static gdouble
+bench_impl (GstDlnaSrcAesImpl impl, guint8 * buf, gsize size)
+{
+  GstDlnaSrcAesKey key;
+  guint8 iv[16];
+  gint64 start = 0;
+  gint64 elapsed = 0;
+  guint64 bytes = 0;
+
+  gst_dlna_src_aes_set_key (&key, cbc_key);
+
+  start = g_get_monotonic_time ();
+  do {
+    memcpy (iv, cbc_iv, sizeof (iv));
+    gst_dlna_src_aes_cbc_decrypt (impl, &key, iv, buf, size);
+    bytes += size;
+    elapsed = g_get_monotonic_time () - start;
+  } while (elapsed < BENCH_USECS);
+
+  return (gdouble) bytes / elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  GstDlnaSrcAesImpl impl;
+  guint8 *buf = NULL;
+  gsize size = DEFAULT_BUFFER_KB * 1024;
+  gboolean ok = TRUE;
+
+  if (argc > 1)
+    size = g_ascii_strtoull (argv[1], NULL, 10) * 1024;
+  size &= ~(gsize) 15;
+  if (size == 0)
+    size = DEFAULT_BUFFER_KB * 1024;
+
+  gst_dlna_src_aes_init ();
+
+  buf = g_malloc (size);
+  memset (buf, 0x5a, size);
+
+  g_print ("AES-128 CBC in-place decryption of %" G_GSIZE_FORMAT
+      " KB buffers, default kernel: %s\n", size / 1024,
+      gst_dlna_src_aes_impl_name (gst_dlna_src_aes_impl_best ()));
+
+  for (impl = GST_DLNA_SRC_AES_GENERIC; impl < GST_DLNA_SRC_AES_IMPL_CNT;
+      impl++) {
+    if (!gst_dlna_src_aes_impl_available (impl)) {
+      g_print ("  %-10s not available on this CPU\n",
+          gst_dlna_src_aes_impl_name (impl));
+      continue;
+    }
+    if (!check_impl (impl)) {
+      ok = FALSE;
+      continue;
+    }
+    g_print ("  %-10s %8.1f MB/s\n", gst_dlna_src_aes_impl_name (impl),
+        bench_impl (impl, buf, size));
+  }
+
+  g_free (buf);
+
+  return ok ? 0 : 1;
+}
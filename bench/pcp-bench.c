@@ -0,0 +1,358 @@
+/* Copyright (C) 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Measures throughput of dlnadecrypter on a generated stream of protected
+ * content packets (PCPs) encrypted with the test key provider's scheme,
+ * decrypting on the streaming thread (1 worker) and with worker pools of
+ * increasing size.  Output of every configuration is first checked against
+ * the cleartext.
+ *
+ * Usage: pcp-bench [stream size in MB] [PCP size in KB] [aes kernel]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+
+#include "gstdlnadecrypter.h"
+
+#define DEFAULT_STREAM_MB 64
+#define DEFAULT_PCP_KB 256
+#define DEFAULT_AES_KERNEL "auto"
+
+// Size of buffers pushed into decrypter, like reads of souphttpsrc
+#define NETWORK_BUFFER_SIZE (64 * 1024)
+
+static const guint8 bench_key[GST_DLNA_SRC_AES_KEY_SIZE] = {
+  0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+  0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+/**
+ * Receiving end of decrypter, compares cleartext while verifying
+ */
+typedef struct
+{
+  const guint8 *plain;
+  gsize plain_size;
+  gsize received;
+  gboolean verify;
+  gboolean ok;
+  gboolean eos;
+  GMutex mutex;
+  GCond cond;
+} BenchSink;
+
+static GstFlowReturn
+bench_sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
+{
+  BenchSink *sink = gst_pad_get_element_private (pad);
+  GstMapInfo map;
+
+  if (sink->verify && gst_buffer_map (buf, &map, GST_MAP_READ)) {
+    if ((sink->received + map.size > sink->plain_size) ||
+        (memcmp (sink->plain + sink->received, map.data, map.size) != 0))
+      sink->ok = FALSE;
+    gst_buffer_unmap (buf, &map);
+  }
+  sink->received += gst_buffer_get_size (buf);
+  gst_buffer_unref (buf);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+bench_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  BenchSink *sink = gst_pad_get_element_private (pad);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS) {
+    g_mutex_lock (&sink->mutex);
+    sink->eos = TRUE;
+    g_cond_signal (&sink->cond);
+    g_mutex_unlock (&sink->mutex);
+  }
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+/**
+ * Builds stream of PCPs holding supplied cleartext.  Header is 14 bytes with
+ * nonce in bytes 2 to 9 and cleartext length in bytes 10 to 13, payload is
+ * padded to AES block size and encrypted with initialization vector made of
+ * nonce twice.
+ *
+ * @param	plain		cleartext
+ * @param	size		size of cleartext
+ * @param	pcp_size	cleartext bytes per PCP
+ * @param	stream_size	returned size of stream
+ *
+ * @return	encrypted stream
+ */
+static guint8 *
+bench_encrypt (const guint8 * plain, gsize size, gsize pcp_size,
+    gsize * stream_size)
+{
+  GstDlnaSrcAesKey key;
+  guint8 iv[GST_DLNA_SRC_AES_BLOCK_SIZE];
+  guint8 *stream = NULL;
+  guint8 *pcp = NULL;
+  gsize done = 0;
+  gsize len = 0;
+  gsize padded = 0;
+  guint i = 0;
+
+  gst_dlna_src_aes_set_key (&key, bench_key);
+  stream = g_malloc (size + (size / pcp_size + 1) *
+      (DTCP_PCP_HEADER_SIZE + GST_DLNA_SRC_AES_BLOCK_SIZE));
+  *stream_size = 0;
+
+  while (done < size) {
+    len = MIN (pcp_size, size - done);
+    padded = (len + 15) & ~(gsize) 15;
+    pcp = stream + *stream_size;
+
+    memset (pcp, 0, DTCP_PCP_HEADER_SIZE + padded);
+    for (i = 2; i < 10; i++)
+      pcp[i] = g_random_int () & 0xff;
+    GST_WRITE_UINT32_BE (&pcp[10], len);
+    memcpy (&pcp[DTCP_PCP_HEADER_SIZE], plain + done, len);
+
+    memcpy (iv, &pcp[2], 8);
+    memcpy (&iv[8], &pcp[2], 8);
+    gst_dlna_src_aes_cbc_encrypt (&key, iv, &pcp[DTCP_PCP_HEADER_SIZE],
+        padded);
+
+    *stream_size += DTCP_PCP_HEADER_SIZE + padded;
+    done += len;
+  }
+
+  return stream;
+}
+
+/**
+ * Pushes encrypted stream through a decrypter and waits for it to come out.
+ *
+ * @param	key_provider	key_provider property value
+ * @param	kernel			aes_kernel property value
+ * @param	workers			workers property value
+ * @param	stream			encrypted stream
+ * @param	stream_size		size of stream
+ * @param	sink			receiving end, reset by this function
+ *
+ * @return	throughput in MB/s of cleartext, negative on failure
+ */
+static gdouble
+bench_run (const gchar * key_provider, const gchar * kernel, guint workers,
+    const guint8 * stream, gsize stream_size, BenchSink * sink)
+{
+  GstElement *decrypter = NULL;
+  GstPad *src_pad = NULL;
+  GstPad *sink_pad = NULL;
+  GstPad *pad = NULL;
+  GstBuffer **bufs = NULL;
+  GstSegment segment;
+  guint cnt = (stream_size + NETWORK_BUFFER_SIZE - 1) / NETWORK_BUFFER_SIZE;
+  gsize len = 0;
+  gint64 start = 0;
+  gint64 elapsed = 0;
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint i = 0;
+
+  sink->received = 0;
+  sink->ok = TRUE;
+  sink->eos = FALSE;
+
+  decrypter = gst_element_factory_make (GST_DLNA_DECRYPTER_FACTORY, NULL);
+  g_object_set (decrypter, "key_provider", key_provider, "aes_kernel", kernel,
+      "workers", workers, NULL);
+
+  src_pad = gst_pad_new ("src", GST_PAD_SRC);
+  sink_pad = gst_pad_new ("sink", GST_PAD_SINK);
+  gst_pad_set_element_private (sink_pad, sink);
+  gst_pad_set_chain_function (sink_pad, bench_sink_chain);
+  gst_pad_set_event_function (sink_pad, bench_sink_event);
+
+  pad = gst_element_get_static_pad (decrypter, "sink");
+  gst_pad_link (src_pad, pad);
+  gst_object_unref (pad);
+  pad = gst_element_get_static_pad (decrypter, "src");
+  gst_pad_link (pad, sink_pad);
+  gst_object_unref (pad);
+
+  gst_pad_set_active (sink_pad, TRUE);
+  gst_pad_set_active (src_pad, TRUE);
+  if (gst_element_set_state (decrypter,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+    g_printerr ("Unable to start decrypter\n");
+    ret = GST_FLOW_ERROR;
+    goto done;
+  }
+
+  // Buffers are prepared up front since they are decrypted in place
+  bufs = g_new (GstBuffer *, cnt);
+  for (i = 0; i < cnt; i++) {
+    len = MIN (NETWORK_BUFFER_SIZE, stream_size - i * NETWORK_BUFFER_SIZE);
+    bufs[i] = gst_buffer_new_allocate (NULL, len, NULL);
+    gst_buffer_fill (bufs[i], 0, stream + i * NETWORK_BUFFER_SIZE, len);
+  }
+
+  gst_pad_push_event (src_pad, gst_event_new_stream_start ("pcp-bench"));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (src_pad, gst_event_new_segment (&segment));
+
+  start = g_get_monotonic_time ();
+  for (i = 0; (i < cnt) && (ret == GST_FLOW_OK); i++)
+    ret = gst_pad_push (src_pad, bufs[i]);
+  for (; i < cnt; i++)
+    gst_buffer_unref (bufs[i]);
+  g_free (bufs);
+
+  gst_pad_push_event (src_pad, gst_event_new_eos ());
+  g_mutex_lock (&sink->mutex);
+  while (!sink->eos)
+    g_cond_wait (&sink->cond, &sink->mutex);
+  g_mutex_unlock (&sink->mutex);
+  elapsed = g_get_monotonic_time () - start;
+
+done:
+  gst_element_set_state (decrypter, GST_STATE_NULL);
+  gst_pad_set_active (src_pad, FALSE);
+  gst_pad_set_active (sink_pad, FALSE);
+  gst_object_unref (decrypter);
+  gst_object_unref (src_pad);
+  gst_object_unref (sink_pad);
+
+  if ((ret != GST_FLOW_OK) || !sink->ok ||
+      (sink->received != sink->plain_size)) {
+    g_printerr ("workers %u: output mismatch, %" G_GSIZE_FORMAT " of %"
+        G_GSIZE_FORMAT " bytes, flow %s\n", workers, sink->received,
+        sink->plain_size, gst_flow_get_name (ret));
+    return -1.0;
+  }
+
+  return (gdouble) sink->received / MAX (elapsed, 1);
+}
+
+int
+main (int argc, char **argv)
+{
+  BenchSink sink;
+  GError *error = NULL;
+  guint8 *plain = NULL;
+  guint8 *stream = NULL;
+  gchar *key_file = NULL;
+  gchar *contents = NULL;
+  gchar *key_provider = NULL;
+  const gchar *kernel = DEFAULT_AES_KERNEL;
+  gsize size = DEFAULT_STREAM_MB * 1024 * 1024;
+  gsize pcp_size = DEFAULT_PCP_KB * 1024;
+  gsize stream_size = 0;
+  guint workers[] = { 1, 2, 4, 0 };
+  gdouble single = 0;
+  gdouble rate = 0;
+  gboolean ok = TRUE;
+  gint fd = -1;
+  guint i = 0;
+
+  gst_init (&argc, &argv);
+  if (argc > 1)
+    size = g_ascii_strtoull (argv[1], NULL, 10) * 1024 * 1024;
+  if (argc > 2)
+    pcp_size = g_ascii_strtoull (argv[2], NULL, 10) * 1024;
+  if (argc > 3)
+    kernel = argv[3];
+  if ((size == 0) || (pcp_size == 0)) {
+    g_printerr ("Usage: %s [stream MB] [PCP KB] [aes kernel]\n", argv[0]);
+    return 2;
+  }
+
+  gst_element_register (NULL, GST_DLNA_DECRYPTER_FACTORY, GST_RANK_NONE,
+      GST_TYPE_DLNA_DECRYPTER);
+
+  // Key file of test key provider
+  fd = g_file_open_tmp ("pcp-bench-XXXXXX.ini", &key_file, &error);
+  if (fd < 0) {
+    g_printerr ("Unable to create key file: %s\n", error->message);
+    g_error_free (error);
+    return 1;
+  }
+  close (fd);
+  contents = g_strdup_printf ("[test]\nkey=%s\n",
+      "2b7e151628aed2a6abf7158809cf4f3c");
+  g_file_set_contents (key_file, contents, -1, NULL);
+  g_free (contents);
+  key_provider = g_strdup_printf ("test:%s", key_file);
+
+  plain = g_malloc (size);
+  for (i = 0; i < size; i++)
+    plain[i] = g_random_int () & 0xff;
+  stream = bench_encrypt (plain, size, pcp_size, &stream_size);
+
+  memset (&sink, 0, sizeof (sink));
+  sink.plain = plain;
+  sink.plain_size = size;
+  g_mutex_init (&sink.mutex);
+  g_cond_init (&sink.cond);
+
+  workers[G_N_ELEMENTS (workers) - 1] = g_get_num_processors ();
+  g_print ("Decrypting %" G_GSIZE_FORMAT " MB in %" G_GSIZE_FORMAT
+      " KB PCPs, %u processors\n", size / (1024 * 1024), pcp_size / 1024,
+      g_get_num_processors ());
+
+  for (i = 0; i < G_N_ELEMENTS (workers); i++) {
+    if ((i > 0) && (workers[i] <= workers[i - 1]))
+      continue;
+
+    sink.verify = TRUE;
+    if (bench_run (key_provider, kernel, workers[i], stream, stream_size,
+            &sink) < 0) {
+      ok = FALSE;
+      continue;
+    }
+    sink.verify = FALSE;
+    rate = bench_run (key_provider, kernel, workers[i], stream, stream_size,
+        &sink);
+    if (workers[i] == 1)
+      single = rate;
+    g_print ("  %2u worker%s %8.1f MB/s  %.2fx\n", workers[i],
+        (workers[i] == 1) ? " " : "s", rate, (single > 0) ? rate / single : 0);
+  }
+
+  g_unlink (key_file);
+  g_free (key_file);
+  g_free (key_provider);
+  g_free (plain);
+  g_free (stream);
+  g_mutex_clear (&sink.mutex);
+  g_cond_clear (&sink.cond);
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,272 @@
+/* Copyright (C) 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Compares ways of finding the first transport stream packet of a transfer
+ * which starts anywhere within a packet: a byte at a time, memchr as used by
+ * dlnasrc, and SSE2 where the CPU has it.  Candidates must recur at packet
+ * size for SYNC_CONFIRM_CNT packets, as in dlnasrc.
+ *
+ * Usage: tssync-bench [buffer size in KB]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define DEFAULT_BUFFER_KB 1024
+#define BENCH_USECS (G_USEC_PER_SEC / 2)
+#define TS_PACKET_SIZE 188
+#define SYNC_BYTE 0x47
+#define SYNC_CONFIRM_CNT 4
+#define CHECK_ROUNDS 2000
+
+typedef const guint8 *(*FindByteFunc) (const guint8 * data, gsize size);
+
+/**
+ * Finds first sync byte a byte at a time.
+ *
+ * @param	data	data to search
+ * @param	size	size of data
+ *
+ * @return	first sync byte, NULL if there is none
+ */
+static const guint8 *
+find_byte_naive (const guint8 * data, gsize size)
+{
+  gsize i = 0;
+
+  for (i = 0; i < size; i++)
+    if (data[i] == SYNC_BYTE)
+      return data + i;
+  return NULL;
+}
+
+/**
+ * Finds first sync byte with memchr, which C libraries vectorize.
+ *
+ * @param	data	data to search
+ * @param	size	size of data
+ *
+ * @return	first sync byte, NULL if there is none
+ */
+static const guint8 *
+find_byte_memchr (const guint8 * data, gsize size)
+{
+  return memchr (data, SYNC_BYTE, size);
+}
+
+#if defined(__SSE2__)
+/**
+ * Finds first sync byte comparing 16 bytes at a time.
+ *
+ * @param	data	data to search
+ * @param	size	size of data
+ *
+ * @return	first sync byte, NULL if there is none
+ */
+static const guint8 *
+find_byte_sse2 (const guint8 * data, gsize size)
+{
+  const __m128i sync = _mm_set1_epi8 (SYNC_BYTE);
+  gsize i = 0;
+  gint mask = 0;
+
+  for (i = 0; i + 16 <= size; i += 16) {
+    mask = _mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i
+                    *) (data + i)), sync));
+    if (mask != 0)
+      return data + i + __builtin_ctz (mask);
+  }
+  return find_byte_naive (data + i, size - i);
+}
+#endif
+
+/**
+ * Finds start of first packet in data using supplied way of locating
+ * candidate sync bytes, a candidate which data ends before confirming is
+ * not trusted.
+ *
+ * @param	find_byte	way of locating candidates
+ * @param	data		data to search
+ * @param	size		size of data
+ * @param	packet_size	size of packets
+ *
+ * @return	offset of first packet, -1 if none was found
+ */
+static gssize
+find_sync (FindByteFunc find_byte, const guint8 * data, gsize size,
+    guint packet_size)
+{
+  const guint8 *candidate = NULL;
+  gsize sync = packet_size - TS_PACKET_SIZE;
+  gsize from = sync;
+  gsize pos = 0;
+  guint i = 0;
+
+  while (from < size) {
+    candidate = find_byte (data + from, size - from);
+    if (candidate == NULL)
+      break;
+
+    pos = candidate - data;
+    for (i = 1; (i < SYNC_CONFIRM_CNT) && (pos + i * packet_size < size); i++)
+      if (data[pos + i * packet_size] != SYNC_BYTE)
+        break;
+    if (i == SYNC_CONFIRM_CNT)
+      return pos - sync;
+    if (pos + i * packet_size >= size)
+      return -1;
+
+    from = pos + 1;
+  }
+  return -1;
+}
+
+/**
+ * Fills buffer with random data holding a run of packets from supplied
+ * offset on, or no packets if offset is beyond buffer.
+ *
+ * @param	buf			buffer to fill
+ * @param	size		size of buffer
+ * @param	start		offset of first packet
+ * @param	packet_size	size of packets
+ */
+static void
+fill_stream (guint8 * buf, gsize size, gsize start, guint packet_size)
+{
+  gsize i = 0;
+
+  for (i = 0; i < size; i++)
+    buf[i] = g_random_int () & 0xff;
+  for (i = start + packet_size - TS_PACKET_SIZE; i < size; i += packet_size)
+    buf[i] = SYNC_BYTE;
+}
+
+/**
+ * Measures throughput of searching supplied buffer.
+ *
+ * @param	find_byte	way of locating candidates
+ * @param	buf			buffer to search repeatedly
+ * @param	size		size of buffer
+ *
+ * @return	throughput in MB/s
+ */
+static gdouble
+bench_find (FindByteFunc find_byte, const guint8 * buf, gsize size)
+{
+  volatile gssize found = 0;
+  gint64 start = 0;
+  gint64 elapsed = 0;
+  guint64 bytes = 0;
+
+  start = g_get_monotonic_time ();
+  do {
+    found = find_sync (find_byte, buf, size, TS_PACKET_SIZE);
+    bytes += size;
+    elapsed = g_get_monotonic_time () - start;
+  } while (elapsed < BENCH_USECS);
+  (void) found;
+
+  return (gdouble) bytes / elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const guint packet_sizes[] = { 188, 192 };
+  FindByteFunc finds[] = { find_byte_naive, find_byte_memchr,
+#if defined(__SSE2__)
+    find_byte_sse2,
+#endif
+  };
+  static const gchar *names[] = { "naive", "memchr", "sse2" };
+  guint8 check[4096];
+  guint8 *buf = NULL;
+  gsize size = DEFAULT_BUFFER_KB * 1024;
+  gssize expected = 0;
+  gssize found = 0;
+  gsize start = 0;
+  gboolean ok = TRUE;
+  guint round = 0;
+  guint i = 0;
+  guint j = 0;
+
+  if (argc > 1)
+    size = g_ascii_strtoull (argv[1], NULL, 10) * 1024;
+  if (size == 0)
+    size = DEFAULT_BUFFER_KB * 1024;
+
+  // All ways must agree, on data with and without packets of either size
+  for (round = 0; round < CHECK_ROUNDS; round++) {
+    j = round % G_N_ELEMENTS (packet_sizes);
+    start = g_random_int () % (sizeof (check) + 1);
+    fill_stream (check, sizeof (check), start, packet_sizes[j]);
+    expected = find_sync (find_byte_naive, check, sizeof (check),
+        packet_sizes[j]);
+    for (i = 1; i < G_N_ELEMENTS (finds); i++) {
+      found = find_sync (finds[i], check, sizeof (check), packet_sizes[j]);
+      if (found != expected) {
+        g_printerr ("%s: found %ld instead of %ld\n", names[i], (glong) found,
+            (glong) expected);
+        ok = FALSE;
+      }
+    }
+  }
+  if (!ok)
+    return 1;
+
+  buf = g_malloc (size);
+
+  g_print ("Transport stream sync search of %" G_GSIZE_FORMAT
+      " KB buffers\n", size / 1024);
+
+  // Random data without packets has a candidate every 256 bytes on average,
+  // each of which is rejected, which is the worst case
+  fill_stream (buf, size, size, TS_PACKET_SIZE);
+  g_print ("  no packets:\n");
+  for (i = 0; i < G_N_ELEMENTS (finds); i++)
+    g_print ("    %-8s %8.1f MB/s\n", names[i],
+        bench_find (finds[i], buf, size));
+
+  // Data without any sync byte leaves only the scan itself
+  memset (buf, 0, size);
+  g_print ("  no sync bytes:\n");
+  for (i = 0; i < G_N_ELEMENTS (finds); i++)
+    g_print ("    %-8s %8.1f MB/s\n", names[i],
+        bench_find (finds[i], buf, size));
+#if !defined(__SSE2__)
+  g_print ("    %-8s not available on this CPU\n", names[2]);
+#endif
+
+  g_free (buf);
+
+  return 0;
+}
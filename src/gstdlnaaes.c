@@ -0,0 +1,575 @@
+/* Copyright (C) 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * AES-128 CBC used by DTCP-IP to encrypt content of protected content
+ * packets.  Data is decrypted in place by one of several kernels, chosen at
+ * runtime from the instructions the CPU supports: a table based one in C
+ * which runs everywhere, one using AES-NI on x86 and one using the ARMv8
+ * cryptography extension.  All kernels share the key schedule computed in C.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gstdlnaaes.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AES_NI 1
+#include <cpuid.h>
+#include <wmmintrin.h>
+#define AES_NI_TARGET __attribute__ ((target ("aes,sse2")))
+#endif
+
+#if defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+#define HAVE_AES_ARMV8 1
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_AES
+#define HWCAP_AES (1 << 3)
+#endif
+#if defined(__clang__)
+#define AES_ARMV8_TARGET __attribute__ ((target ("aes")))
+#else
+#define AES_ARMV8_TARGET __attribute__ ((target ("+crypto")))
+#endif
+#endif
+
+#define GETU32(p) (((guint32) (p)[0] << 24) | ((guint32) (p)[1] << 16) | \
+    ((guint32) (p)[2] << 8) | ((guint32) (p)[3]))
+#define PUTU32(p, v) G_STMT_START { (p)[0] = (guint8) ((v) >> 24); \
+    (p)[1] = (guint8) ((v) >> 16); (p)[2] = (guint8) ((v) >> 8); \
+    (p)[3] = (guint8) (v); } G_STMT_END
+#define ROTR8(v) (((v) >> 8) | ((v) << 24))
+
+typedef void (*GstDlnaSrcAesCbcFunc) (const GstDlnaSrcAesKey * key,
+    guint8 * iv, guint8 * data, gsize len);
+
+// Tables are computed once, S-box and inverse S-box plus the four tables of
+// the inverse cipher round which combine inverse S-box and InvMixColumns
+static guint8 sbox[256];
+static guint8 inv_sbox[256];
+static guint32 td[4][256];
+static gboolean impl_available[GST_DLNA_SRC_AES_IMPL_CNT];
+
+static void aes_cbc_decrypt_generic (const GstDlnaSrcAesKey * key,
+    guint8 * iv, guint8 * data, gsize len);
+
+#ifdef HAVE_AES_NI
+static void aes_cbc_decrypt_ni (const GstDlnaSrcAesKey * key, guint8 * iv,
+    guint8 * data, gsize len);
+#endif
+
+#ifdef HAVE_AES_ARMV8
+static void aes_cbc_decrypt_armv8 (const GstDlnaSrcAesKey * key, guint8 * iv,
+    guint8 * data, gsize len);
+#endif
+
+static const GstDlnaSrcAesCbcFunc cbc_decrypt_funcs[GST_DLNA_SRC_AES_IMPL_CNT]
+    = {
+  aes_cbc_decrypt_generic,
+#ifdef HAVE_AES_NI
+  aes_cbc_decrypt_ni,
+#else
+  NULL,
+#endif
+#ifdef HAVE_AES_ARMV8
+  aes_cbc_decrypt_armv8,
+#else
+  NULL,
+#endif
+};
+
+static const gchar *impl_names[GST_DLNA_SRC_AES_IMPL_CNT] = {
+  "generic", "aes-ni", "armv8-ce"
+};
+
+/**
+ * Multiplies supplied elements of GF(2^8) using AES polynomial.
+ *
+ * @param	a	first factor
+ * @param	b	second factor
+ *
+ * @return	product
+ */
+static guint8
+aes_gf_mul (guint8 a, guint8 b)
+{
+  guint8 product = 0;
+
+  while (b != 0) {
+    if (b & 1)
+      product ^= a;
+    a = (a << 1) ^ ((a & 0x80) ? 0x1b : 0);
+    b >>= 1;
+  }
+
+  return product;
+}
+
+/**
+ * Computes tables and detects which kernels the CPU supports.  Called once
+ * when plugin is loaded, safe to call again.
+ */
+void
+gst_dlna_src_aes_init (void)
+{
+  static gsize initialized = 0;
+  guint8 p = 1;
+  guint8 q = 1;
+  guint8 x = 0;
+  guint8 s = 0;
+  guint i = 0;
+
+  if (!g_once_init_enter (&initialized))
+    return;
+
+  // Walk multiplicative group using generator 3, q is inverse of p
+  do {
+    p = p ^ (p << 1) ^ ((p & 0x80) ? 0x1b : 0);
+    q ^= q << 1;
+    q ^= q << 2;
+    q ^= q << 4;
+    if (q & 0x80)
+      q ^= 0x09;
+    x = q ^ ((q << 1) | (q >> 7)) ^ ((q << 2) | (q >> 6)) ^
+        ((q << 3) | (q >> 5)) ^ ((q << 4) | (q >> 4));
+    sbox[p] = x ^ 0x63;
+  } while (p != 1);
+  sbox[0] = 0x63;
+
+  for (i = 0; i < 256; i++)
+    inv_sbox[sbox[i]] = i;
+
+  for (i = 0; i < 256; i++) {
+    s = inv_sbox[i];
+    td[0][i] = ((guint32) aes_gf_mul (s, 0x0e) << 24) |
+        ((guint32) aes_gf_mul (s, 0x09) << 16) |
+        ((guint32) aes_gf_mul (s, 0x0d) << 8) | aes_gf_mul (s, 0x0b);
+    td[1][i] = ROTR8 (td[0][i]);
+    td[2][i] = ROTR8 (td[1][i]);
+    td[3][i] = ROTR8 (td[2][i]);
+  }
+
+  impl_available[GST_DLNA_SRC_AES_GENERIC] = TRUE;
+#ifdef HAVE_AES_NI
+  {
+    guint eax = 0, ebx = 0, ecx = 0, edx = 0;
+    impl_available[GST_DLNA_SRC_AES_NI] =
+        __get_cpuid (1, &eax, &ebx, &ecx, &edx) && (ecx & bit_AES) &&
+        (edx & bit_SSE2);
+  }
+#endif
+#ifdef HAVE_AES_ARMV8
+  impl_available[GST_DLNA_SRC_AES_ARMV8] =
+      (getauxval (AT_HWCAP) & HWCAP_AES) != 0;
+#endif
+
+  g_once_init_leave (&initialized, 1);
+}
+
+/**
+ * Determines if supplied kernel can be used on this CPU.
+ *
+ * @param	impl	kernel
+ *
+ * @return	true if kernel is available, false otherwise
+ */
+gboolean
+gst_dlna_src_aes_impl_available (GstDlnaSrcAesImpl impl)
+{
+  gst_dlna_src_aes_init ();
+
+  return (impl < GST_DLNA_SRC_AES_IMPL_CNT) && impl_available[impl] &&
+      (cbc_decrypt_funcs[impl] != NULL);
+}
+
+/**
+ * Returns fastest kernel available on this CPU.
+ *
+ * @return	kernel to use by default
+ */
+GstDlnaSrcAesImpl
+gst_dlna_src_aes_impl_best (void)
+{
+  if (gst_dlna_src_aes_impl_available (GST_DLNA_SRC_AES_NI))
+    return GST_DLNA_SRC_AES_NI;
+  if (gst_dlna_src_aes_impl_available (GST_DLNA_SRC_AES_ARMV8))
+    return GST_DLNA_SRC_AES_ARMV8;
+
+  return GST_DLNA_SRC_AES_GENERIC;
+}
+
+/**
+ * Returns name of supplied kernel for logging.
+ *
+ * @param	impl	kernel
+ *
+ * @return	name of kernel
+ */
+const gchar *
+gst_dlna_src_aes_impl_name (GstDlnaSrcAesImpl impl)
+{
+  return (impl < GST_DLNA_SRC_AES_IMPL_CNT) ? impl_names[impl] : "unknown";
+}
+
+/**
+ * Expands supplied AES-128 key into encryption round keys and round keys of
+ * the equivalent inverse cipher.
+ *
+ * @param	key		expanded key
+ * @param	raw		16 byte key
+ */
+void
+gst_dlna_src_aes_set_key (GstDlnaSrcAesKey * key, const guint8 * raw)
+{
+  guint32 *ek = key->enc;
+  guint32 *dk = key->dec;
+  guint32 rcon = 0x01;
+  guint32 temp = 0;
+  guint32 w = 0;
+  guint i = 0;
+  guint round = 0;
+
+  gst_dlna_src_aes_init ();
+
+  for (i = 0; i < 4; i++)
+    ek[i] = GETU32 (raw + 4 * i);
+
+  for (i = 4; i < 4 * (GST_DLNA_SRC_AES_ROUNDS + 1); i++) {
+    temp = ek[i - 1];
+    if (i % 4 == 0) {
+      temp = ((guint32) sbox[(temp >> 16) & 0xff] << 24) |
+          ((guint32) sbox[(temp >> 8) & 0xff] << 16) |
+          ((guint32) sbox[temp & 0xff] << 8) | sbox[temp >> 24];
+      temp ^= rcon << 24;
+      rcon = aes_gf_mul (rcon, 0x02);
+    }
+    ek[i] = ek[i - 4] ^ temp;
+  }
+
+  // Inverse cipher uses round keys in reverse order, InvMixColumns applied
+  // to all but first and last, which tables do when S-box is undone first
+  for (round = 0; round <= GST_DLNA_SRC_AES_ROUNDS; round++) {
+    for (i = 0; i < 4; i++) {
+      w = ek[4 * (GST_DLNA_SRC_AES_ROUNDS - round) + i];
+      if ((round > 0) && (round < GST_DLNA_SRC_AES_ROUNDS))
+        w = td[0][sbox[w >> 24]] ^ td[1][sbox[(w >> 16) & 0xff]] ^
+            td[2][sbox[(w >> 8) & 0xff]] ^ td[3][sbox[w & 0xff]];
+      dk[4 * round + i] = w;
+      PUTU32 (key->dec_bytes + 16 * round + 4 * i, w);
+    }
+  }
+}
+
+/**
+ * Decrypts whole blocks of supplied data in place using AES-128 CBC with
+ * supplied kernel.
+ *
+ * @param	impl	kernel to use, generic one is used if it is unavailable
+ * @param	key		expanded key
+ * @param	iv		initialization vector, updated to last ciphertext block
+ *					so decryption can continue with data following
+ * @param	data	data to decrypt
+ * @param	len		number of bytes to decrypt, multiple of block size
+ */
+void
+gst_dlna_src_aes_cbc_decrypt (GstDlnaSrcAesImpl impl,
+    const GstDlnaSrcAesKey * key, guint8 * iv, guint8 * data, gsize len)
+{
+  if (!gst_dlna_src_aes_impl_available (impl))
+    impl = GST_DLNA_SRC_AES_GENERIC;
+
+  cbc_decrypt_funcs[impl] (key, iv, data, len & ~(gsize) 15);
+}
+
+/**
+ * Generic kernel decrypting using tables.
+ *
+ * @param	key		expanded key
+ * @param	iv		initialization vector, updated to last ciphertext block
+ * @param	data	data to decrypt
+ * @param	len		number of bytes to decrypt, multiple of block size
+ */
+static void
+aes_cbc_decrypt_generic (const GstDlnaSrcAesKey * key, guint8 * iv,
+    guint8 * data, gsize len)
+{
+  const guint32 *rk = NULL;
+  guint8 prev[GST_DLNA_SRC_AES_BLOCK_SIZE];
+  guint8 cipher[GST_DLNA_SRC_AES_BLOCK_SIZE];
+  guint32 s0, s1, s2, s3, t0, t1, t2, t3;
+  guint round = 0;
+  guint i = 0;
+
+  memcpy (prev, iv, sizeof (prev));
+
+  for (; len >= GST_DLNA_SRC_AES_BLOCK_SIZE;
+      len -= GST_DLNA_SRC_AES_BLOCK_SIZE, data += GST_DLNA_SRC_AES_BLOCK_SIZE) {
+    memcpy (cipher, data, sizeof (cipher));
+    rk = key->dec;
+
+    s0 = GETU32 (data) ^ rk[0];
+    s1 = GETU32 (data + 4) ^ rk[1];
+    s2 = GETU32 (data + 8) ^ rk[2];
+    s3 = GETU32 (data + 12) ^ rk[3];
+
+    for (round = 1; round < GST_DLNA_SRC_AES_ROUNDS; round++) {
+      rk += 4;
+      t0 = td[0][s0 >> 24] ^ td[1][(s3 >> 16) & 0xff] ^
+          td[2][(s2 >> 8) & 0xff] ^ td[3][s1 & 0xff] ^ rk[0];
+      t1 = td[0][s1 >> 24] ^ td[1][(s0 >> 16) & 0xff] ^
+          td[2][(s3 >> 8) & 0xff] ^ td[3][s2 & 0xff] ^ rk[1];
+      t2 = td[0][s2 >> 24] ^ td[1][(s1 >> 16) & 0xff] ^
+          td[2][(s0 >> 8) & 0xff] ^ td[3][s3 & 0xff] ^ rk[2];
+      t3 = td[0][s3 >> 24] ^ td[1][(s2 >> 16) & 0xff] ^
+          td[2][(s1 >> 8) & 0xff] ^ td[3][s0 & 0xff] ^ rk[3];
+      s0 = t0;
+      s1 = t1;
+      s2 = t2;
+      s3 = t3;
+    }
+    rk += 4;
+
+    t0 = ((guint32) inv_sbox[s0 >> 24] << 24) |
+        ((guint32) inv_sbox[(s3 >> 16) & 0xff] << 16) |
+        ((guint32) inv_sbox[(s2 >> 8) & 0xff] << 8) | inv_sbox[s1 & 0xff];
+    t1 = ((guint32) inv_sbox[s1 >> 24] << 24) |
+        ((guint32) inv_sbox[(s0 >> 16) & 0xff] << 16) |
+        ((guint32) inv_sbox[(s3 >> 8) & 0xff] << 8) | inv_sbox[s2 & 0xff];
+    t2 = ((guint32) inv_sbox[s2 >> 24] << 24) |
+        ((guint32) inv_sbox[(s1 >> 16) & 0xff] << 16) |
+        ((guint32) inv_sbox[(s0 >> 8) & 0xff] << 8) | inv_sbox[s3 & 0xff];
+    t3 = ((guint32) inv_sbox[s3 >> 24] << 24) |
+        ((guint32) inv_sbox[(s2 >> 16) & 0xff] << 16) |
+        ((guint32) inv_sbox[(s1 >> 8) & 0xff] << 8) | inv_sbox[s0 & 0xff];
+
+    PUTU32 (data, t0 ^ rk[0]);
+    PUTU32 (data + 4, t1 ^ rk[1]);
+    PUTU32 (data + 8, t2 ^ rk[2]);
+    PUTU32 (data + 12, t3 ^ rk[3]);
+
+    for (i = 0; i < GST_DLNA_SRC_AES_BLOCK_SIZE; i++)
+      data[i] ^= prev[i];
+    memcpy (prev, cipher, sizeof (prev));
+  }
+
+  memcpy (iv, prev, sizeof (prev));
+}
+
+#ifdef HAVE_AES_NI
+/**
+ * Kernel using AES-NI, four blocks are decrypted at once to keep the
+ * pipelined AES unit busy since CBC decryption has no dependency between
+ * blocks.
+ *
+ * @param	key		expanded key
+ * @param	iv		initialization vector, updated to last ciphertext block
+ * @param	data	data to decrypt
+ * @param	len		number of bytes to decrypt, multiple of block size
+ */
+static AES_NI_TARGET void
+aes_cbc_decrypt_ni (const GstDlnaSrcAesKey * key, guint8 * iv,
+    guint8 * data, gsize len)
+{
+  __m128i rk[GST_DLNA_SRC_AES_ROUNDS + 1];
+  __m128i prev = _mm_loadu_si128 ((const __m128i *) iv);
+  __m128i c0, c1, c2, c3, b0, b1, b2, b3;
+  guint round = 0;
+
+  for (round = 0; round <= GST_DLNA_SRC_AES_ROUNDS; round++)
+    rk[round] = _mm_loadu_si128 ((const __m128i *) (key->dec_bytes +
+            16 * round));
+
+  for (; len >= 4 * GST_DLNA_SRC_AES_BLOCK_SIZE;
+      len -= 4 * GST_DLNA_SRC_AES_BLOCK_SIZE,
+      data += 4 * GST_DLNA_SRC_AES_BLOCK_SIZE) {
+    c0 = _mm_loadu_si128 ((const __m128i *) data);
+    c1 = _mm_loadu_si128 ((const __m128i *) (data + 16));
+    c2 = _mm_loadu_si128 ((const __m128i *) (data + 32));
+    c3 = _mm_loadu_si128 ((const __m128i *) (data + 48));
+
+    b0 = _mm_xor_si128 (c0, rk[0]);
+    b1 = _mm_xor_si128 (c1, rk[0]);
+    b2 = _mm_xor_si128 (c2, rk[0]);
+    b3 = _mm_xor_si128 (c3, rk[0]);
+    for (round = 1; round < GST_DLNA_SRC_AES_ROUNDS; round++) {
+      b0 = _mm_aesdec_si128 (b0, rk[round]);
+      b1 = _mm_aesdec_si128 (b1, rk[round]);
+      b2 = _mm_aesdec_si128 (b2, rk[round]);
+      b3 = _mm_aesdec_si128 (b3, rk[round]);
+    }
+    b0 = _mm_aesdeclast_si128 (b0, rk[GST_DLNA_SRC_AES_ROUNDS]);
+    b1 = _mm_aesdeclast_si128 (b1, rk[GST_DLNA_SRC_AES_ROUNDS]);
+    b2 = _mm_aesdeclast_si128 (b2, rk[GST_DLNA_SRC_AES_ROUNDS]);
+    b3 = _mm_aesdeclast_si128 (b3, rk[GST_DLNA_SRC_AES_ROUNDS]);
+
+    _mm_storeu_si128 ((__m128i *) data, _mm_xor_si128 (b0, prev));
+    _mm_storeu_si128 ((__m128i *) (data + 16), _mm_xor_si128 (b1, c0));
+    _mm_storeu_si128 ((__m128i *) (data + 32), _mm_xor_si128 (b2, c1));
+    _mm_storeu_si128 ((__m128i *) (data + 48), _mm_xor_si128 (b3, c2));
+    prev = c3;
+  }
+
+  for (; len >= GST_DLNA_SRC_AES_BLOCK_SIZE;
+      len -= GST_DLNA_SRC_AES_BLOCK_SIZE, data += GST_DLNA_SRC_AES_BLOCK_SIZE) {
+    c0 = _mm_loadu_si128 ((const __m128i *) data);
+    b0 = _mm_xor_si128 (c0, rk[0]);
+    for (round = 1; round < GST_DLNA_SRC_AES_ROUNDS; round++)
+      b0 = _mm_aesdec_si128 (b0, rk[round]);
+    b0 = _mm_aesdeclast_si128 (b0, rk[GST_DLNA_SRC_AES_ROUNDS]);
+    _mm_storeu_si128 ((__m128i *) data, _mm_xor_si128 (b0, prev));
+    prev = c0;
+  }
+
+  _mm_storeu_si128 ((__m128i *) iv, prev);
+}
+#endif
+
+#ifdef HAVE_AES_ARMV8
+/**
+ * Kernel using ARMv8 cryptography extension.  AESD adds round key before
+ * undoing ShiftRows and SubBytes, so each round key is applied one step
+ * earlier than with AES-NI and last one is added separately.
+ *
+ * @param	key		expanded key
+ * @param	iv		initialization vector, updated to last ciphertext block
+ * @param	data	data to decrypt
+ * @param	len		number of bytes to decrypt, multiple of block size
+ */
+static AES_ARMV8_TARGET void
+aes_cbc_decrypt_armv8 (const GstDlnaSrcAesKey * key, guint8 * iv,
+    guint8 * data, gsize len)
+{
+  uint8x16_t rk[GST_DLNA_SRC_AES_ROUNDS + 1];
+  uint8x16_t prev = vld1q_u8 (iv);
+  uint8x16_t c0, c1, c2, c3, b0, b1, b2, b3;
+  guint round = 0;
+
+  for (round = 0; round <= GST_DLNA_SRC_AES_ROUNDS; round++)
+    rk[round] = vld1q_u8 (key->dec_bytes + 16 * round);
+
+  for (; len >= 4 * GST_DLNA_SRC_AES_BLOCK_SIZE;
+      len -= 4 * GST_DLNA_SRC_AES_BLOCK_SIZE,
+      data += 4 * GST_DLNA_SRC_AES_BLOCK_SIZE) {
+    c0 = vld1q_u8 (data);
+    c1 = vld1q_u8 (data + 16);
+    c2 = vld1q_u8 (data + 32);
+    c3 = vld1q_u8 (data + 48);
+
+    b0 = c0;
+    b1 = c1;
+    b2 = c2;
+    b3 = c3;
+    for (round = 0; round < GST_DLNA_SRC_AES_ROUNDS - 1; round++) {
+      b0 = vaesimcq_u8 (vaesdq_u8 (b0, rk[round]));
+      b1 = vaesimcq_u8 (vaesdq_u8 (b1, rk[round]));
+      b2 = vaesimcq_u8 (vaesdq_u8 (b2, rk[round]));
+      b3 = vaesimcq_u8 (vaesdq_u8 (b3, rk[round]));
+    }
+    b0 = veorq_u8 (vaesdq_u8 (b0, rk[round]), rk[GST_DLNA_SRC_AES_ROUNDS]);
+    b1 = veorq_u8 (vaesdq_u8 (b1, rk[round]), rk[GST_DLNA_SRC_AES_ROUNDS]);
+    b2 = veorq_u8 (vaesdq_u8 (b2, rk[round]), rk[GST_DLNA_SRC_AES_ROUNDS]);
+    b3 = veorq_u8 (vaesdq_u8 (b3, rk[round]), rk[GST_DLNA_SRC_AES_ROUNDS]);
+
+    vst1q_u8 (data, veorq_u8 (b0, prev));
+    vst1q_u8 (data + 16, veorq_u8 (b1, c0));
+    vst1q_u8 (data + 32, veorq_u8 (b2, c1));
+    vst1q_u8 (data + 48, veorq_u8 (b3, c2));
+    prev = c3;
+  }
+
+  for (; len >= GST_DLNA_SRC_AES_BLOCK_SIZE;
+      len -= GST_DLNA_SRC_AES_BLOCK_SIZE, data += GST_DLNA_SRC_AES_BLOCK_SIZE) {
+    c0 = vld1q_u8 (data);
+    b0 = c0;
+    for (round = 0; round < GST_DLNA_SRC_AES_ROUNDS - 1; round++)
+      b0 = vaesimcq_u8 (vaesdq_u8 (b0, rk[round]));
+    b0 = veorq_u8 (vaesdq_u8 (b0, rk[round]), rk[GST_DLNA_SRC_AES_ROUNDS]);
+    vst1q_u8 (data, veorq_u8 (b0, prev));
+    prev = c0;
+  }
+
+  vst1q_u8 (iv, prev);
+}
+#endif
+
+/**
+ * Encrypts whole blocks of supplied data in place using AES-128 CBC.  Only
+ * used to produce content for tests and benchmarks, so it is kept simple.
+ *
+ * @param	key		expanded key
+ * @param	iv		initialization vector, updated to last ciphertext block
+ * @param	data	data to encrypt
+ * @param	len		number of bytes to encrypt, multiple of block size
+ */
+void
+gst_dlna_src_aes_cbc_encrypt (const GstDlnaSrcAesKey * key, guint8 * iv,
+    guint8 * data, gsize len)
+{
+  guint8 state[GST_DLNA_SRC_AES_BLOCK_SIZE];
+  guint8 tmp[GST_DLNA_SRC_AES_BLOCK_SIZE];
+  guint8 a0, a1, a2, a3;
+  guint round = 0;
+  guint i = 0;
+  guint c = 0;
+
+  for (; len >= GST_DLNA_SRC_AES_BLOCK_SIZE;
+      len -= GST_DLNA_SRC_AES_BLOCK_SIZE, data += GST_DLNA_SRC_AES_BLOCK_SIZE) {
+    for (i = 0; i < GST_DLNA_SRC_AES_BLOCK_SIZE; i++)
+      state[i] = data[i] ^ iv[i] ^ (guint8) (key->enc[i / 4] >>
+          (24 - 8 * (i % 4)));
+
+    for (round = 1; round <= GST_DLNA_SRC_AES_ROUNDS; round++) {
+      // SubBytes and ShiftRows, state is stored column by column
+      for (i = 0; i < GST_DLNA_SRC_AES_BLOCK_SIZE; i++)
+        tmp[i] = sbox[state[(i + 4 * (i % 4)) % 16]];
+
+      // MixColumns in all but last round
+      if (round < GST_DLNA_SRC_AES_ROUNDS) {
+        for (c = 0; c < 4; c++) {
+          a0 = tmp[4 * c];
+          a1 = tmp[4 * c + 1];
+          a2 = tmp[4 * c + 2];
+          a3 = tmp[4 * c + 3];
+          tmp[4 * c] = aes_gf_mul (a0, 2) ^ aes_gf_mul (a1, 3) ^ a2 ^ a3;
+          tmp[4 * c + 1] = a0 ^ aes_gf_mul (a1, 2) ^ aes_gf_mul (a2, 3) ^ a3;
+          tmp[4 * c + 2] = a0 ^ a1 ^ aes_gf_mul (a2, 2) ^ aes_gf_mul (a3, 3);
+          tmp[4 * c + 3] = aes_gf_mul (a0, 3) ^ a1 ^ a2 ^ aes_gf_mul (a3, 2);
+        }
+      }
+
+      for (i = 0; i < GST_DLNA_SRC_AES_BLOCK_SIZE; i++)
+        state[i] = tmp[i] ^ (guint8) (key->enc[4 * round + i / 4] >>
+            (24 - 8 * (i % 4)));
+    }
+
+    memcpy (data, state, sizeof (state));
+    memcpy (iv, state, sizeof (state));
+  }
+}
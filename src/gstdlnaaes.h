@@ -0,0 +1,84 @@
+/* Copyright (C) 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __GST_DLNA_AES_H__
+#define __GST_DLNA_AES_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define GST_DLNA_SRC_AES_BLOCK_SIZE 16
+#define GST_DLNA_SRC_AES_KEY_SIZE 16
+#define GST_DLNA_SRC_AES_ROUNDS 10
+
+/**
+ * GstDlnaSrcAesImpl:
+ *
+ * Kernels AES-128 content decryption can be run with, the generic one is
+ * always available, the others depend on the CPU found at runtime
+ */
+typedef enum
+{
+    GST_DLNA_SRC_AES_GENERIC,
+    GST_DLNA_SRC_AES_NI,
+    GST_DLNA_SRC_AES_ARMV8,
+    GST_DLNA_SRC_AES_IMPL_CNT
+} GstDlnaSrcAesImpl;
+
+/**
+ * GstDlnaSrcAesKey:
+ *
+ * Expanded AES-128 key, decryption round keys are those of the equivalent
+ * inverse cipher and are kept both as words and in memory byte order
+ */
+typedef struct _GstDlnaSrcAesKey GstDlnaSrcAesKey;
+struct _GstDlnaSrcAesKey
+{
+    guint32 enc[4 * (GST_DLNA_SRC_AES_ROUNDS + 1)];
+    guint32 dec[4 * (GST_DLNA_SRC_AES_ROUNDS + 1)];
+    guint8 dec_bytes[GST_DLNA_SRC_AES_BLOCK_SIZE *
+        (GST_DLNA_SRC_AES_ROUNDS + 1)];
+};
+
+void gst_dlna_src_aes_init (void);
+
+gboolean gst_dlna_src_aes_impl_available (GstDlnaSrcAesImpl impl);
+
+GstDlnaSrcAesImpl gst_dlna_src_aes_impl_best (void);
+
+const gchar* gst_dlna_src_aes_impl_name (GstDlnaSrcAesImpl impl);
+
+void gst_dlna_src_aes_set_key (GstDlnaSrcAesKey* key, const guint8* raw);
+
+void gst_dlna_src_aes_cbc_decrypt (GstDlnaSrcAesImpl impl,
+    const GstDlnaSrcAesKey* key, guint8* iv, guint8* data, gsize len);
+
+void gst_dlna_src_aes_cbc_encrypt (const GstDlnaSrcAesKey* key, guint8* iv,
+    guint8* data, gsize len);
+
+G_END_DECLS
+
+#endif /* __GST_DLNA_AES_H__ */
@@ -0,0 +1,1301 @@
+/* Copyright (C) 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Decrypter for DTCP protected content which runs inside dlnasrc.  Protected
+ * content packets (PCPs) are decrypted in place with AES-128 CBC using the
+ * fastest kernel of this CPU, content keys come from a key provider selected
+ * by name through the key_provider property.  Buffers are split on PCP
+ * boundaries and into parts of at most DECRYPT_JOB_SIZE bytes which a pool of
+ * worker threads decrypts in parallel, a task on the src pad pushes each
+ * buffer once all of its parts are done, so output stays in stream order.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gstdlnadecrypter.h"
+
+/* props */
+enum
+{
+  PROP_0,
+  PROP_DTCP_HOST,
+  PROP_DTCP_PORT,
+  PROP_KEY_PROVIDER,
+  PROP_AES_KERNEL,
+  PROP_WORKERS,
+  //...
+};
+
+// Name of kernel property value which selects fastest kernel
+#define AES_KERNEL_AUTO "auto"
+
+// Number of decryption workers, 0 for one per processor, 1 decrypts on
+// streaming thread without a pool
+#define DEFAULT_WORKERS 0
+#define MAX_WORKERS 64
+
+// Largest part of a buffer decrypted by one worker, CBC decryption of parts
+// is independent given ciphertext block preceding each part
+#define DECRYPT_JOB_SIZE (64 * 1024)
+
+// Buffers being decrypted or waiting to be pushed, per worker
+#define PENDING_BUFFERS_PER_WORKER 4
+
+// Group and keys of key file read by test key provider
+#define TEST_KEY_FILE_GROUP "test"
+#define TEST_KEY_FILE_KEY "key"
+#define TEST_KEY_FILE_IV "iv"
+
+static GstStaticPadTemplate gst_dlna_decrypter_sink_template =
+GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("ANY")
+    );
+
+static GstStaticPadTemplate gst_dlna_decrypter_src_template =
+GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("ANY")
+    );
+
+/**
+ * Part of output buffer, either a range of the decrypted input buffer or a
+ * block which was split across input buffers
+ */
+typedef struct _GstDlnaDecrypterPiece GstDlnaDecrypterPiece;
+struct _GstDlnaDecrypterPiece
+{
+  gsize offset;
+  gsize size;
+  GstMemory *mem;
+};
+
+/**
+ * Expanded content key, shared with workers still decrypting with it after
+ * key has changed
+ */
+struct _GstDlnaDecrypterKey
+{
+  gint ref_count;
+  GstDlnaSrcAesKey key;
+};
+
+/**
+ * Input buffer being decrypted in place, or serialized event kept in stream
+ * order with buffers when there is a worker pool
+ */
+typedef struct _GstDlnaDecrypterBatch GstDlnaDecrypterBatch;
+struct _GstDlnaDecrypterBatch
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  GArray *pieces;
+  guint jobs_pending;
+  gboolean discont;
+  GstEvent *event;
+};
+
+/**
+ * Part of buffer decrypted by a worker
+ */
+typedef struct _GstDlnaDecrypterJob GstDlnaDecrypterJob;
+struct _GstDlnaDecrypterJob
+{
+  GstDlnaDecrypterBatch *batch;
+  GstDlnaDecrypterKey *key;
+  GstDlnaSrcAesImpl impl;
+  gsize offset;
+  gsize size;
+  guint8 iv[GST_DLNA_SRC_AES_BLOCK_SIZE];
+};
+
+/**
+ * Session of test key provider, which uses fixed key read from a file
+ */
+typedef struct _GstDlnaSrcTestKeySession GstDlnaSrcTestKeySession;
+struct _GstDlnaSrcTestKeySession
+{
+  guint8 key[GST_DLNA_SRC_AES_KEY_SIZE];
+  guint8 iv[GST_DLNA_SRC_AES_BLOCK_SIZE];
+  gboolean has_iv;
+};
+
+static void gst_dlna_decrypter_finalize (GObject * object);
+
+static void gst_dlna_decrypter_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * spec);
+
+static void gst_dlna_decrypter_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * spec);
+
+static GstStateChangeReturn gst_dlna_decrypter_change_state (GstElement *
+    element, GstStateChange transition);
+
+static GstFlowReturn gst_dlna_decrypter_chain (GstPad * pad,
+    GstObject * parent, GstBuffer * buf);
+
+static gboolean gst_dlna_decrypter_sink_event (GstPad * pad,
+    GstObject * parent, GstEvent * event);
+
+static gboolean gst_dlna_decrypter_sink_query (GstPad * pad,
+    GstObject * parent, GstQuery * query);
+
+static gboolean gst_dlna_decrypter_src_activate_mode (GstPad * pad,
+    GstObject * parent, GstPadMode mode, gboolean active);
+
+static void dlna_decrypter_loop (GstPad * pad);
+
+static void dlna_decrypter_job_run (gpointer data, gpointer user_data);
+
+static void dlna_decrypter_decrypt (GstDlnaDecrypter * decrypter,
+    GstDlnaDecrypterBatch * batch, gsize offset, gsize size);
+
+static GstBuffer *dlna_decrypter_batch_output (GstDlnaDecrypter * decrypter,
+    GstDlnaDecrypterBatch * batch);
+
+static void dlna_decrypter_batch_free (GstDlnaDecrypterBatch * batch);
+
+static void dlna_decrypter_pending_clear (GstDlnaDecrypter * decrypter);
+
+static void dlna_decrypter_pool_start (GstDlnaDecrypter * decrypter);
+
+static void dlna_decrypter_pool_stop (GstDlnaDecrypter * decrypter);
+
+static void dlna_decrypter_key_unref (GstDlnaDecrypterKey * key);
+
+static gboolean dlna_decrypter_session_open (GstDlnaDecrypter * decrypter);
+
+static void dlna_decrypter_session_close (GstDlnaDecrypter * decrypter);
+
+static void dlna_decrypter_reset (GstDlnaDecrypter * decrypter);
+
+static gboolean dlna_decrypter_packet_start (GstDlnaDecrypter * decrypter);
+
+static gboolean dlna_decrypter_parse_hex (const gchar * str, guint8 * bytes,
+    gsize len);
+
+static gpointer dlna_src_test_key_open (const gchar * host, guint port,
+    const gchar * params);
+
+static gboolean dlna_src_test_key_content_key (gpointer session,
+    const guint8 * pcp_header, guint8 * key, guint8 * iv);
+
+static void dlna_src_test_key_close (gpointer session);
+
+// Provider with fixed key for testing without a DTCP source
+static const GstDlnaSrcKeyProvider test_key_provider = {
+  "test",
+  dlna_src_test_key_open,
+  dlna_src_test_key_content_key,
+  dlna_src_test_key_close
+};
+
+// Registered key providers
+static GList *key_providers = NULL;
+static GMutex key_providers_mutex;
+
+#define gst_dlna_decrypter_parent_class parent_class
+G_DEFINE_TYPE (GstDlnaDecrypter, gst_dlna_decrypter, GST_TYPE_ELEMENT);
+
+GST_DEBUG_CATEGORY_STATIC (gst_dlna_decrypter_debug);
+#define GST_CAT_DEFAULT gst_dlna_decrypter_debug
+
+static void
+gst_dlna_decrypter_class_init (GstDlnaDecrypterClass * klass)
+{
+  GObjectClass *gobject_klass = (GObjectClass *) klass;
+  GstElementClass *gstelement_klass = (GstElementClass *) klass;
+
+  GST_DEBUG_CATEGORY_INIT (gst_dlna_decrypter_debug, "dlnadecrypter", 0,
+      "DTCP content decrypter");
+
+  gst_dlna_src_aes_init ();
+  gst_dlna_src_key_provider_register (&test_key_provider);
+
+  gst_element_class_set_static_metadata (gstelement_klass,
+      "DTCP content decrypter",
+      "Filter/Decryptor/Network",
+      "Decrypts DTCP protected content with keys from a key provider",
+      "Eric Winkelman <e.winkelman@cablelabs.com>");
+
+  gst_element_class_add_pad_template (gstelement_klass,
+      gst_static_pad_template_get (&gst_dlna_decrypter_sink_template));
+  gst_element_class_add_pad_template (gstelement_klass,
+      gst_static_pad_template_get (&gst_dlna_decrypter_src_template));
+
+  gobject_klass->set_property = gst_dlna_decrypter_set_property;
+  gobject_klass->get_property = gst_dlna_decrypter_get_property;
+  gobject_klass->finalize = gst_dlna_decrypter_finalize;
+
+  g_object_class_install_property (gobject_klass, PROP_DTCP_HOST,
+      g_param_spec_string ("dtcp1host",
+          "DTCP host",
+          "Host of DTCP source content keys are obtained from",
+          NULL, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_klass, PROP_DTCP_PORT,
+      g_param_spec_uint ("dtcp1port",
+          "DTCP port",
+          "Port of DTCP source content keys are obtained from",
+          0, G_MAXUINT16, 0, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_klass, PROP_KEY_PROVIDER,
+      g_param_spec_string ("key_provider",
+          "Key provider",
+          "Key provider as name optionally followed by colon and parameters "
+          "of provider, i.e. test:/etc/dlna/test-key.ini, takes effect when "
+          "element goes to READY", NULL, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_klass, PROP_AES_KERNEL,
+      g_param_spec_string ("aes_kernel",
+          "AES kernel",
+          "AES kernel used for decryption, auto for fastest one of this CPU, "
+          "otherwise generic, aes-ni or armv8-ce",
+          AES_KERNEL_AUTO, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_klass, PROP_WORKERS,
+      g_param_spec_uint ("workers",
+          "Workers",
+          "Threads decrypting in parallel, 0 for one per processor, 1 to "
+          "decrypt on streaming thread, takes effect when element goes to "
+          "READY", 0, MAX_WORKERS, DEFAULT_WORKERS, G_PARAM_READWRITE));
+
+  gstelement_klass->change_state = gst_dlna_decrypter_change_state;
+}
+
+static void
+gst_dlna_decrypter_init (GstDlnaDecrypter * decrypter)
+{
+  decrypter->sink_pad =
+      gst_pad_new_from_static_template (&gst_dlna_decrypter_sink_template,
+      "sink");
+  gst_pad_set_chain_function (decrypter->sink_pad,
+      GST_DEBUG_FUNCPTR (gst_dlna_decrypter_chain));
+  gst_pad_set_event_function (decrypter->sink_pad,
+      GST_DEBUG_FUNCPTR (gst_dlna_decrypter_sink_event));
+  gst_pad_set_query_function (decrypter->sink_pad,
+      GST_DEBUG_FUNCPTR (gst_dlna_decrypter_sink_query));
+  GST_PAD_SET_PROXY_CAPS (decrypter->sink_pad);
+  GST_PAD_SET_PROXY_ALLOCATION (decrypter->sink_pad);
+  gst_element_add_pad (GST_ELEMENT (decrypter), decrypter->sink_pad);
+
+  decrypter->src_pad =
+      gst_pad_new_from_static_template (&gst_dlna_decrypter_src_template,
+      "src");
+  gst_pad_set_activatemode_function (decrypter->src_pad,
+      GST_DEBUG_FUNCPTR (gst_dlna_decrypter_src_activate_mode));
+  GST_PAD_SET_PROXY_CAPS (decrypter->src_pad);
+  gst_element_add_pad (GST_ELEMENT (decrypter), decrypter->src_pad);
+
+  decrypter->aes_impl = gst_dlna_src_aes_impl_best ();
+  decrypter->workers = DEFAULT_WORKERS;
+  g_mutex_init (&decrypter->pool_mutex);
+  g_cond_init (&decrypter->pool_cond);
+  g_queue_init (&decrypter->pending);
+  decrypter->src_result = GST_FLOW_FLUSHING;
+  dlna_decrypter_reset (decrypter);
+}
+
+static void
+gst_dlna_decrypter_finalize (GObject * object)
+{
+  GstDlnaDecrypter *decrypter = GST_DLNA_DECRYPTER (object);
+
+  dlna_decrypter_pool_stop (decrypter);
+  dlna_decrypter_session_close (decrypter);
+  g_free (decrypter->dtcp_host);
+  g_free (decrypter->key_provider_name);
+  g_mutex_clear (&decrypter->pool_mutex);
+  g_cond_clear (&decrypter->pool_cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_dlna_decrypter_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstDlnaDecrypter *decrypter = GST_DLNA_DECRYPTER (object);
+  const gchar *name = NULL;
+  GstDlnaSrcAesImpl impl;
+
+  switch (prop_id) {
+    case PROP_DTCP_HOST:
+      g_free (decrypter->dtcp_host);
+      decrypter->dtcp_host = g_value_dup_string (value);
+      break;
+
+    case PROP_DTCP_PORT:
+      decrypter->dtcp_port = g_value_get_uint (value);
+      break;
+
+    case PROP_KEY_PROVIDER:
+      g_free (decrypter->key_provider_name);
+      decrypter->key_provider_name = g_value_dup_string (value);
+      break;
+
+    case PROP_AES_KERNEL:
+      name = g_value_get_string (value);
+      decrypter->aes_impl = gst_dlna_src_aes_impl_best ();
+      if ((name == NULL) || (strcmp (name, AES_KERNEL_AUTO) == 0))
+        break;
+      for (impl = GST_DLNA_SRC_AES_GENERIC; impl < GST_DLNA_SRC_AES_IMPL_CNT;
+          impl++) {
+        if (strcmp (name, gst_dlna_src_aes_impl_name (impl)) == 0)
+          break;
+      }
+      if (impl == GST_DLNA_SRC_AES_IMPL_CNT)
+        GST_WARNING_OBJECT (decrypter, "Unknown AES kernel %s", name);
+      else if (!gst_dlna_src_aes_impl_available (impl))
+        GST_WARNING_OBJECT (decrypter,
+            "AES kernel %s is not supported by this CPU", name);
+      else
+        decrypter->aes_impl = impl;
+      GST_INFO_OBJECT (decrypter, "Using AES kernel %s",
+          gst_dlna_src_aes_impl_name (decrypter->aes_impl));
+      break;
+
+    case PROP_WORKERS:
+      decrypter->workers = g_value_get_uint (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_dlna_decrypter_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstDlnaDecrypter *decrypter = GST_DLNA_DECRYPTER (object);
+
+  switch (prop_id) {
+    case PROP_DTCP_HOST:
+      g_value_set_string (value, decrypter->dtcp_host);
+      break;
+
+    case PROP_DTCP_PORT:
+      g_value_set_uint (value, decrypter->dtcp_port);
+      break;
+
+    case PROP_KEY_PROVIDER:
+      g_value_set_string (value, decrypter->key_provider_name);
+      break;
+
+    case PROP_AES_KERNEL:
+      g_value_set_string (value,
+          gst_dlna_src_aes_impl_name (decrypter->aes_impl));
+      break;
+
+    case PROP_WORKERS:
+      g_value_set_uint (value, decrypter->workers);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+/**
+ * Opens key provider session and starts worker pool when going to READY and
+ * stops both when going back to NULL, so a decrypter kept in READY by dlnasrc
+ * between items keeps its authentication with the DTCP source.
+ */
+static GstStateChangeReturn
+gst_dlna_decrypter_change_state (GstElement * element,
+    GstStateChange transition)
+{
+  GstDlnaDecrypter *decrypter = GST_DLNA_DECRYPTER (element);
+  GstStateChangeReturn ret = GST_STATE_CHANGE_SUCCESS;
+
+  if (transition == GST_STATE_CHANGE_NULL_TO_READY) {
+    if (!dlna_decrypter_session_open (decrypter))
+      return GST_STATE_CHANGE_FAILURE;
+    dlna_decrypter_pool_start (decrypter);
+  }
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      dlna_decrypter_reset (decrypter);
+      break;
+
+    case GST_STATE_CHANGE_READY_TO_NULL:
+      dlna_decrypter_pool_stop (decrypter);
+      dlna_decrypter_session_close (decrypter);
+      break;
+
+    default:
+      break;
+  }
+
+  return ret;
+}
+
+/**
+ * Resets packet parsing when data no longer continues previous data.  With a
+ * worker pool, flushes also stop src pad task and discard pending buffers,
+ * and serialized events are queued behind pending buffers.
+ */
+static gboolean
+gst_dlna_decrypter_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  GstDlnaDecrypter *decrypter = GST_DLNA_DECRYPTER (parent);
+  GstDlnaDecrypterBatch *batch = NULL;
+  gboolean ret = FALSE;
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_START:
+      if (decrypter->pool == NULL)
+        break;
+      ret = gst_pad_push_event (decrypter->src_pad, event);
+      g_mutex_lock (&decrypter->pool_mutex);
+      decrypter->flushing = TRUE;
+      decrypter->src_result = GST_FLOW_FLUSHING;
+      g_cond_broadcast (&decrypter->pool_cond);
+      g_mutex_unlock (&decrypter->pool_mutex);
+      gst_pad_pause_task (decrypter->src_pad);
+      return ret;
+
+    case GST_EVENT_FLUSH_STOP:
+      dlna_decrypter_reset (decrypter);
+      if (decrypter->pool == NULL)
+        break;
+      dlna_decrypter_pending_clear (decrypter);
+      g_mutex_lock (&decrypter->pool_mutex);
+      decrypter->flushing = FALSE;
+      decrypter->src_result = GST_FLOW_OK;
+      g_mutex_unlock (&decrypter->pool_mutex);
+      ret = gst_pad_push_event (decrypter->src_pad, event);
+      if (gst_pad_is_active (decrypter->src_pad))
+        gst_pad_start_task (decrypter->src_pad,
+            (GstTaskFunction) dlna_decrypter_loop, decrypter->src_pad, NULL);
+      return ret;
+
+    case GST_EVENT_SEGMENT:
+      dlna_decrypter_reset (decrypter);
+      break;
+
+    default:
+      break;
+  }
+
+  if ((decrypter->pool == NULL) || !GST_EVENT_IS_SERIALIZED (event))
+    return gst_pad_event_default (pad, parent, event);
+
+  batch = g_slice_new0 (GstDlnaDecrypterBatch);
+  batch->event = event;
+  g_mutex_lock (&decrypter->pool_mutex);
+  if (decrypter->flushing) {
+    g_mutex_unlock (&decrypter->pool_mutex);
+    dlna_decrypter_batch_free (batch);
+    return FALSE;
+  }
+  g_queue_push_tail (&decrypter->pending, batch);
+  g_cond_broadcast (&decrypter->pool_cond);
+  g_mutex_unlock (&decrypter->pool_mutex);
+
+  return TRUE;
+}
+
+/**
+ * Lets buffers pending in worker pool be pushed before serialized queries are
+ * answered downstream.
+ */
+static gboolean
+gst_dlna_decrypter_sink_query (GstPad * pad, GstObject * parent,
+    GstQuery * query)
+{
+  GstDlnaDecrypter *decrypter = GST_DLNA_DECRYPTER (parent);
+
+  if ((decrypter->pool != NULL) && GST_QUERY_IS_SERIALIZED (query)) {
+    g_mutex_lock (&decrypter->pool_mutex);
+    while ((decrypter->src_result == GST_FLOW_OK) &&
+        !g_queue_is_empty (&decrypter->pending))
+      g_cond_wait (&decrypter->pool_cond, &decrypter->pool_mutex);
+    g_mutex_unlock (&decrypter->pool_mutex);
+  }
+
+  return gst_pad_query_default (pad, parent, query);
+}
+
+/**
+ * Starts task pushing decrypted buffers in stream order when there is a
+ * worker pool, stops it and discards pending buffers on deactivation.
+ */
+static gboolean
+gst_dlna_decrypter_src_activate_mode (GstPad * pad, GstObject * parent,
+    GstPadMode mode, gboolean active)
+{
+  GstDlnaDecrypter *decrypter = GST_DLNA_DECRYPTER (parent);
+
+  if (mode != GST_PAD_MODE_PUSH)
+    return FALSE;
+
+  g_mutex_lock (&decrypter->pool_mutex);
+  decrypter->flushing = !active;
+  decrypter->src_result = active ? GST_FLOW_OK : GST_FLOW_FLUSHING;
+  g_cond_broadcast (&decrypter->pool_cond);
+  g_mutex_unlock (&decrypter->pool_mutex);
+
+  if (decrypter->pool == NULL)
+    return TRUE;
+
+  if (active)
+    return gst_pad_start_task (pad, (GstTaskFunction) dlna_decrypter_loop,
+        pad, NULL);
+
+  gst_pad_stop_task (pad);
+  dlna_decrypter_pending_clear (decrypter);
+
+  return TRUE;
+}
+
+/**
+ * Decrypts PCPs of supplied buffer in place.  PCP headers and padding are
+ * dropped, the cleartext is pushed as ranges of the input memory so no data
+ * is copied except for AES blocks split across buffers.  With a worker pool
+ * buffer is queued for src pad task once its parts are handed to workers.
+ *
+ * @param	pad		sink pad
+ * @param	parent	this element
+ * @param	buf		encrypted data following previously received data
+ *
+ * @return	result of pushing cleartext
+ */
+static GstFlowReturn
+gst_dlna_decrypter_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
+{
+  GstDlnaDecrypter *decrypter = GST_DLNA_DECRYPTER (parent);
+  GstDlnaDecrypterBatch *batch = NULL;
+  GstDlnaDecrypterPiece piece;
+  GstBuffer *out = NULL;
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint8 *data = NULL;
+  gsize size = 0;
+  gsize pos = 0;
+  gsize len = 0;
+  gsize avail = 0;
+  gsize clear = 0;
+  gboolean failed = FALSE;
+
+  // Wait for room among pending buffers so memory held stays bounded
+  if (decrypter->pool != NULL) {
+    g_mutex_lock (&decrypter->pool_mutex);
+    while ((decrypter->src_result == GST_FLOW_OK) &&
+        (g_queue_get_length (&decrypter->pending) >=
+            decrypter->pool_size * PENDING_BUFFERS_PER_WORKER))
+      g_cond_wait (&decrypter->pool_cond, &decrypter->pool_mutex);
+    ret = decrypter->src_result;
+    g_mutex_unlock (&decrypter->pool_mutex);
+    if (ret != GST_FLOW_OK) {
+      gst_buffer_unref (buf);
+      return ret;
+    }
+  }
+
+  batch = g_slice_new0 (GstDlnaDecrypterBatch);
+  batch->discont = decrypter->discont || GST_BUFFER_IS_DISCONT (buf);
+  decrypter->discont = FALSE;
+  batch->buf = gst_buffer_make_writable (buf);
+  if (!gst_buffer_map (batch->buf, &batch->map, GST_MAP_READWRITE)) {
+    GST_ELEMENT_ERROR (decrypter, RESOURCE, FAILED, (NULL),
+        ("Unable to map buffer for decryption"));
+    dlna_decrypter_batch_free (batch);
+    return GST_FLOW_ERROR;
+  }
+  batch->pieces = g_array_new (FALSE, FALSE, sizeof (GstDlnaDecrypterPiece));
+  data = batch->map.data;
+  size = batch->map.size;
+
+  while ((pos < size) && !failed) {
+    // Header of next packet, possibly split across buffers
+    if (decrypter->payload_remaining == 0) {
+      len = MIN (size - pos, DTCP_PCP_HEADER_SIZE - decrypter->pcp_header_fill);
+      memcpy (&decrypter->pcp_header[decrypter->pcp_header_fill], &data[pos],
+          len);
+      decrypter->pcp_header_fill += len;
+      pos += len;
+      if (decrypter->pcp_header_fill == DTCP_PCP_HEADER_SIZE) {
+        decrypter->pcp_header_fill = 0;
+        failed = !dlna_decrypter_packet_start (decrypter);
+      }
+      continue;
+    }
+
+    avail = MIN (size - pos, decrypter->payload_remaining);
+
+    // Block split across buffers is completed and decrypted on its own
+    if ((decrypter->carry_fill > 0) ||
+        (avail < GST_DLNA_SRC_AES_BLOCK_SIZE)) {
+      len = MIN (avail, GST_DLNA_SRC_AES_BLOCK_SIZE - decrypter->carry_fill);
+      memcpy (&decrypter->carry[decrypter->carry_fill], &data[pos], len);
+      decrypter->carry_fill += len;
+      decrypter->payload_remaining -= len;
+      pos += len;
+      if (decrypter->carry_fill < GST_DLNA_SRC_AES_BLOCK_SIZE)
+        continue;
+
+      decrypter->carry_fill = 0;
+      gst_dlna_src_aes_cbc_decrypt (decrypter->aes_impl, &decrypter->key->key,
+          decrypter->iv, decrypter->carry, GST_DLNA_SRC_AES_BLOCK_SIZE);
+      clear = MIN (GST_DLNA_SRC_AES_BLOCK_SIZE, decrypter->clear_remaining);
+      if (clear > 0) {
+        piece.offset = 0;
+        piece.size = clear;
+        piece.mem = gst_memory_new_wrapped (0,
+            g_memdup (decrypter->carry, clear), clear, 0, clear, NULL, g_free);
+        g_array_append_val (batch->pieces, piece);
+        decrypter->clear_remaining -= clear;
+      }
+      continue;
+    }
+
+    // Whole blocks are decrypted in place, in parts when there are workers
+    len = MIN (avail, DECRYPT_JOB_SIZE) &
+        ~(gsize) (GST_DLNA_SRC_AES_BLOCK_SIZE - 1);
+    dlna_decrypter_decrypt (decrypter, batch, pos, len);
+    clear = MIN (len, decrypter->clear_remaining);
+    if (clear > 0) {
+      piece.offset = pos;
+      piece.size = clear;
+      piece.mem = NULL;
+      g_array_append_val (batch->pieces, piece);
+      decrypter->clear_remaining -= clear;
+    }
+    decrypter->payload_remaining -= len;
+    pos += len;
+  }
+
+  if (decrypter->pool == NULL) {
+    if (!failed)
+      out = dlna_decrypter_batch_output (decrypter, batch);
+    dlna_decrypter_batch_free (batch);
+    if (failed)
+      return GST_FLOW_ERROR;
+    return (out != NULL) ? gst_pad_push (decrypter->src_pad, out) : GST_FLOW_OK;
+  }
+
+  g_mutex_lock (&decrypter->pool_mutex);
+  if (failed || decrypter->flushing) {
+    while (batch->jobs_pending > 0)
+      g_cond_wait (&decrypter->pool_cond, &decrypter->pool_mutex);
+    g_mutex_unlock (&decrypter->pool_mutex);
+    dlna_decrypter_batch_free (batch);
+    return failed ? GST_FLOW_ERROR : GST_FLOW_FLUSHING;
+  }
+  g_queue_push_tail (&decrypter->pending, batch);
+  g_cond_broadcast (&decrypter->pool_cond);
+  ret = decrypter->src_result;
+  g_mutex_unlock (&decrypter->pool_mutex);
+
+  return ret;
+}
+
+/**
+ * Decrypts whole AES blocks of buffer in place, right away without a worker
+ * pool or by a worker otherwise.  Initialization vector of following blocks
+ * is taken from ciphertext before a worker overwrites it.
+ *
+ * @param	decrypter	this element
+ * @param	batch		buffer being decrypted
+ * @param	offset		offset of first block in buffer
+ * @param	size		number of bytes of whole blocks
+ */
+static void
+dlna_decrypter_decrypt (GstDlnaDecrypter * decrypter,
+    GstDlnaDecrypterBatch * batch, gsize offset, gsize size)
+{
+  GstDlnaDecrypterJob *job = NULL;
+  guint8 *data = batch->map.data + offset;
+
+  if (decrypter->pool == NULL) {
+    gst_dlna_src_aes_cbc_decrypt (decrypter->aes_impl, &decrypter->key->key,
+        decrypter->iv, data, size);
+    return;
+  }
+
+  job = g_slice_new (GstDlnaDecrypterJob);
+  job->batch = batch;
+  job->key = decrypter->key;
+  g_atomic_int_inc (&job->key->ref_count);
+  job->impl = decrypter->aes_impl;
+  job->offset = offset;
+  job->size = size;
+  memcpy (job->iv, decrypter->iv, GST_DLNA_SRC_AES_BLOCK_SIZE);
+  memcpy (decrypter->iv, data + size - GST_DLNA_SRC_AES_BLOCK_SIZE,
+      GST_DLNA_SRC_AES_BLOCK_SIZE);
+
+  g_mutex_lock (&decrypter->pool_mutex);
+  batch->jobs_pending++;
+  g_mutex_unlock (&decrypter->pool_mutex);
+
+  if (!g_thread_pool_push (decrypter->pool, job, NULL))
+    dlna_decrypter_job_run (job, decrypter);
+}
+
+/**
+ * Decrypts part of a buffer on a worker thread and wakes up src pad task once
+ * all parts of the buffer are done.
+ *
+ * @param	data		part to decrypt
+ * @param	user_data	this element
+ */
+static void
+dlna_decrypter_job_run (gpointer data, gpointer user_data)
+{
+  GstDlnaDecrypter *decrypter = GST_DLNA_DECRYPTER (user_data);
+  GstDlnaDecrypterJob *job = data;
+  GstDlnaDecrypterBatch *batch = job->batch;
+
+  gst_dlna_src_aes_cbc_decrypt (job->impl, &job->key->key, job->iv,
+      batch->map.data + job->offset, job->size);
+  dlna_decrypter_key_unref (job->key);
+  g_slice_free (GstDlnaDecrypterJob, job);
+
+  g_mutex_lock (&decrypter->pool_mutex);
+  if (--batch->jobs_pending == 0)
+    g_cond_broadcast (&decrypter->pool_cond);
+  g_mutex_unlock (&decrypter->pool_mutex);
+}
+
+/**
+ * Src pad task which pushes buffers and events in the order they were
+ * received, waiting for workers to finish each buffer.
+ *
+ * @param	pad	src pad
+ */
+static void
+dlna_decrypter_loop (GstPad * pad)
+{
+  GstDlnaDecrypter *decrypter = GST_DLNA_DECRYPTER (GST_PAD_PARENT (pad));
+  GstDlnaDecrypterBatch *batch = NULL;
+  GstBuffer *out = NULL;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  g_mutex_lock (&decrypter->pool_mutex);
+  while (!decrypter->flushing &&
+      (((batch = g_queue_peek_head (&decrypter->pending)) == NULL) ||
+          (batch->jobs_pending > 0)))
+    g_cond_wait (&decrypter->pool_cond, &decrypter->pool_mutex);
+  if (decrypter->flushing) {
+    g_mutex_unlock (&decrypter->pool_mutex);
+    gst_pad_pause_task (pad);
+    return;
+  }
+  g_mutex_unlock (&decrypter->pool_mutex);
+
+  // Batch stays queued while pushed so serialized queries wait for it
+  if (batch->event != NULL) {
+    if (GST_EVENT_TYPE (batch->event) == GST_EVENT_EOS)
+      ret = GST_FLOW_EOS;
+    gst_pad_push_event (pad, batch->event);
+    batch->event = NULL;
+  } else {
+    out = dlna_decrypter_batch_output (decrypter, batch);
+    if (out != NULL)
+      ret = gst_pad_push (pad, out);
+  }
+
+  g_mutex_lock (&decrypter->pool_mutex);
+  g_queue_pop_head (&decrypter->pending);
+  if ((ret != GST_FLOW_OK) && !decrypter->flushing)
+    decrypter->src_result = ret;
+  g_cond_broadcast (&decrypter->pool_cond);
+  g_mutex_unlock (&decrypter->pool_mutex);
+  dlna_decrypter_batch_free (batch);
+
+  if (ret == GST_FLOW_OK)
+    return;
+
+  GST_DEBUG_OBJECT (decrypter, "Pausing task, reason %s",
+      gst_flow_get_name (ret));
+  gst_pad_pause_task (pad);
+  if ((ret == GST_FLOW_NOT_LINKED) || (ret < GST_FLOW_EOS)) {
+    GST_ELEMENT_ERROR (decrypter, STREAM, FAILED,
+        ("Internal data stream error."),
+        ("streaming stopped, reason %s", gst_flow_get_name (ret)));
+    gst_pad_push_event (pad, gst_event_new_eos ());
+  }
+}
+
+/**
+ * Builds cleartext buffer of decrypted batch, sharing memory of input buffer.
+ * Discontinuity of batch without any cleartext is carried to next buffer.
+ *
+ * @param	decrypter	this element
+ * @param	batch		buffer whose blocks have all been decrypted
+ *
+ * @return	cleartext, NULL if batch has none
+ */
+static GstBuffer *
+dlna_decrypter_batch_output (GstDlnaDecrypter * decrypter,
+    GstDlnaDecrypterBatch * batch)
+{
+  GstDlnaDecrypterPiece *cur = NULL;
+  GstBuffer *out = NULL;
+  guint i = 0;
+
+  // Ranges can only be shared once buffer is no longer mapped for writing
+  gst_buffer_unmap (batch->buf, &batch->map);
+  out = gst_buffer_new ();
+  gst_buffer_copy_into (out, batch->buf, GST_BUFFER_COPY_METADATA, 0, -1);
+  for (i = 0; i < batch->pieces->len; i++) {
+    cur = &g_array_index (batch->pieces, GstDlnaDecrypterPiece, i);
+    if (cur->mem) {
+      gst_buffer_append_memory (out, cur->mem);
+      cur->mem = NULL;
+    } else {
+      gst_buffer_copy_into (out, batch->buf, GST_BUFFER_COPY_MEMORY,
+          cur->offset, cur->size);
+    }
+  }
+  g_array_free (batch->pieces, TRUE);
+  batch->pieces = NULL;
+
+  if (batch->discont)
+    decrypter->out_discont = TRUE;
+  if (gst_buffer_get_size (out) == 0) {
+    gst_buffer_unref (out);
+    return NULL;
+  }
+
+  GST_BUFFER_OFFSET (out) = GST_BUFFER_OFFSET_NONE;
+  GST_BUFFER_OFFSET_END (out) = GST_BUFFER_OFFSET_NONE;
+  if (decrypter->out_discont) {
+    GST_BUFFER_FLAG_SET (out, GST_BUFFER_FLAG_DISCONT);
+    decrypter->out_discont = FALSE;
+  } else {
+    GST_BUFFER_FLAG_UNSET (out, GST_BUFFER_FLAG_DISCONT);
+  }
+
+  return out;
+}
+
+/**
+ * Frees batch along with whatever part of it has not been pushed.
+ *
+ * @param	batch	buffer or event which is no longer needed
+ */
+static void
+dlna_decrypter_batch_free (GstDlnaDecrypterBatch * batch)
+{
+  GstDlnaDecrypterPiece *cur = NULL;
+  guint i = 0;
+
+  if (batch->pieces != NULL) {
+    gst_buffer_unmap (batch->buf, &batch->map);
+    for (i = 0; i < batch->pieces->len; i++) {
+      cur = &g_array_index (batch->pieces, GstDlnaDecrypterPiece, i);
+      if (cur->mem)
+        gst_memory_unref (cur->mem);
+    }
+    g_array_free (batch->pieces, TRUE);
+  }
+  if (batch->buf != NULL)
+    gst_buffer_unref (batch->buf);
+  if (batch->event != NULL)
+    gst_event_unref (batch->event);
+  g_slice_free (GstDlnaDecrypterBatch, batch);
+}
+
+/**
+ * Discards buffers and events not yet pushed, waiting for workers still
+ * decrypting them.  Called while src pad task is stopped.
+ *
+ * @param	decrypter	this element
+ */
+static void
+dlna_decrypter_pending_clear (GstDlnaDecrypter * decrypter)
+{
+  GstDlnaDecrypterBatch *batch = NULL;
+
+  g_mutex_lock (&decrypter->pool_mutex);
+  while ((batch = g_queue_pop_head (&decrypter->pending)) != NULL) {
+    while (batch->jobs_pending > 0)
+      g_cond_wait (&decrypter->pool_cond, &decrypter->pool_mutex);
+    dlna_decrypter_batch_free (batch);
+  }
+  g_mutex_unlock (&decrypter->pool_mutex);
+}
+
+/**
+ * Starts worker pool unless decryption is to run on streaming thread.
+ *
+ * @param	decrypter	this element
+ */
+static void
+dlna_decrypter_pool_start (GstDlnaDecrypter * decrypter)
+{
+  GError *error = NULL;
+  guint workers = decrypter->workers;
+
+  if (decrypter->pool != NULL)
+    return;
+
+  if (workers == 0)
+    workers = MIN (g_get_num_processors (), MAX_WORKERS);
+  if (workers <= 1) {
+    GST_INFO_OBJECT (decrypter, "Decrypting on streaming thread");
+    return;
+  }
+
+  decrypter->pool = g_thread_pool_new (dlna_decrypter_job_run, decrypter,
+      workers, FALSE, &error);
+  if (decrypter->pool == NULL) {
+    GST_WARNING_OBJECT (decrypter,
+        "Unable to start worker pool, decrypting on streaming thread: %s",
+        error->message);
+    g_error_free (error);
+    return;
+  }
+  decrypter->pool_size = workers;
+  GST_INFO_OBJECT (decrypter, "Decrypting with %u workers", workers);
+}
+
+/**
+ * Stops worker pool once parts handed to it have been decrypted.
+ *
+ * @param	decrypter	this element
+ */
+static void
+dlna_decrypter_pool_stop (GstDlnaDecrypter * decrypter)
+{
+  if (decrypter->pool == NULL)
+    return;
+
+  g_thread_pool_free (decrypter->pool, FALSE, TRUE);
+  decrypter->pool = NULL;
+}
+
+/**
+ * Opens session with key provider named by key_provider property.
+ *
+ * @param	decrypter	this element
+ *
+ * @return	true if session was opened, false otherwise
+ */
+static gboolean
+dlna_decrypter_session_open (GstDlnaDecrypter * decrypter)
+{
+  gchar **parts = NULL;
+
+  if (decrypter->session != NULL)
+    return TRUE;
+
+  if (decrypter->key_provider_name == NULL) {
+    GST_ELEMENT_ERROR (decrypter, RESOURCE, SETTINGS, (NULL),
+        ("No key provider has been set"));
+    return FALSE;
+  }
+
+  parts = g_strsplit (decrypter->key_provider_name, ":", 2);
+  decrypter->key_provider = gst_dlna_src_key_provider_find (parts[0]);
+  if (decrypter->key_provider == NULL) {
+    GST_ELEMENT_ERROR (decrypter, RESOURCE, SETTINGS, (NULL),
+        ("Key provider %s is not registered", parts[0]));
+    g_strfreev (parts);
+    return FALSE;
+  }
+
+  GST_INFO_OBJECT (decrypter, "Opening %s key provider session for %s:%u",
+      parts[0], decrypter->dtcp_host, decrypter->dtcp_port);
+  decrypter->session = decrypter->key_provider->open (decrypter->dtcp_host,
+      decrypter->dtcp_port, parts[1]);
+  g_strfreev (parts);
+
+  if (decrypter->session == NULL) {
+    GST_ELEMENT_ERROR (decrypter, RESOURCE, OPEN_READ, (NULL),
+        ("Unable to open key provider session for %s:%u",
+            decrypter->dtcp_host, decrypter->dtcp_port));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+ * Closes session with key provider, if open.
+ *
+ * @param	decrypter	this element
+ */
+static void
+dlna_decrypter_session_close (GstDlnaDecrypter * decrypter)
+{
+  if (decrypter->session == NULL)
+    return;
+
+  decrypter->key_provider->close (decrypter->session);
+  decrypter->session = NULL;
+  if (decrypter->key != NULL) {
+    dlna_decrypter_key_unref (decrypter->key);
+    decrypter->key = NULL;
+  }
+}
+
+/**
+ * Discards state of partially received packet, next data is expected to
+ * start with a PCP header.
+ *
+ * @param	decrypter	this element
+ */
+static void
+dlna_decrypter_reset (GstDlnaDecrypter * decrypter)
+{
+  decrypter->pcp_header_fill = 0;
+  decrypter->payload_remaining = 0;
+  decrypter->clear_remaining = 0;
+  decrypter->carry_fill = 0;
+  decrypter->discont = TRUE;
+}
+
+/**
+ * Sets up decryption of packet whose header has been received, expanding the
+ * content key only when it differs from the key of previous packet.
+ *
+ * @param	decrypter	this element
+ *
+ * @return	true if packet can be decrypted, false otherwise
+ */
+static gboolean
+dlna_decrypter_packet_start (GstDlnaDecrypter * decrypter)
+{
+  guint8 raw_key[GST_DLNA_SRC_AES_KEY_SIZE];
+  guint32 clear_len = GST_READ_UINT32_BE (&decrypter->pcp_header[10]);
+
+  decrypter->clear_remaining = clear_len;
+  decrypter->payload_remaining = ((guint64) clear_len + 15) & ~15;
+
+  if (!decrypter->key_provider->content_key (decrypter->session,
+          decrypter->pcp_header, raw_key, decrypter->iv)) {
+    GST_ELEMENT_ERROR (decrypter, STREAM, DECRYPT, (NULL),
+        ("No content key for packet of %u bytes", clear_len));
+    return FALSE;
+  }
+
+  // Workers may still be decrypting with previous key
+  if ((decrypter->key == NULL) ||
+      (memcmp (raw_key, decrypter->raw_key, sizeof (raw_key)) != 0)) {
+    GST_DEBUG_OBJECT (decrypter, "Content key changed");
+    if (decrypter->key != NULL)
+      dlna_decrypter_key_unref (decrypter->key);
+    decrypter->key = g_slice_new (GstDlnaDecrypterKey);
+    decrypter->key->ref_count = 1;
+    gst_dlna_src_aes_set_key (&decrypter->key->key, raw_key);
+    memcpy (decrypter->raw_key, raw_key, sizeof (raw_key));
+  }
+
+  return TRUE;
+}
+
+/**
+ * Releases reference to content key.
+ *
+ * @param	key	content key
+ */
+static void
+dlna_decrypter_key_unref (GstDlnaDecrypterKey * key)
+{
+  if (g_atomic_int_dec_and_test (&key->ref_count))
+    g_slice_free (GstDlnaDecrypterKey, key);
+}
+
+/**
+ * Makes key provider available to decrypters by its name.  Provider must
+ * remain valid for life of the process.
+ *
+ * @param	provider	key provider to register
+ */
+void
+gst_dlna_src_key_provider_register (const GstDlnaSrcKeyProvider * provider)
+{
+  g_mutex_lock (&key_providers_mutex);
+  if (g_list_find (key_providers, provider) == NULL)
+    key_providers = g_list_append (key_providers, (gpointer) provider);
+  g_mutex_unlock (&key_providers_mutex);
+}
+
+/**
+ * Looks up registered key provider.
+ *
+ * @param	name	name of key provider
+ *
+ * @return	key provider, NULL if none is registered with this name
+ */
+const GstDlnaSrcKeyProvider *
+gst_dlna_src_key_provider_find (const gchar * name)
+{
+  const GstDlnaSrcKeyProvider *provider = NULL;
+  GList *item = NULL;
+
+  g_mutex_lock (&key_providers_mutex);
+  for (item = key_providers; item != NULL; item = item->next) {
+    if (g_strcmp0 (((const GstDlnaSrcKeyProvider *) item->data)->name,
+            name) == 0) {
+      provider = item->data;
+      break;
+    }
+  }
+  g_mutex_unlock (&key_providers_mutex);
+
+  return provider;
+}
+
+/**
+ * Parses string of hex digits of exactly supplied number of bytes.
+ *
+ * @param	str		hex string
+ * @param	bytes	returned bytes
+ * @param	len		number of bytes expected
+ *
+ * @return	true if string held expected number of bytes, false otherwise
+ */
+static gboolean
+dlna_decrypter_parse_hex (const gchar * str, guint8 * bytes, gsize len)
+{
+  gsize i = 0;
+  gint hi = 0;
+  gint lo = 0;
+
+  if ((str == NULL) || (strlen (str) != 2 * len))
+    return FALSE;
+
+  for (i = 0; i < len; i++) {
+    hi = g_ascii_xdigit_value (str[2 * i]);
+    lo = g_ascii_xdigit_value (str[2 * i + 1]);
+    if ((hi < 0) || (lo < 0))
+      return FALSE;
+    bytes[i] = (hi << 4) | lo;
+  }
+
+  return TRUE;
+}
+
+/**
+ * Opens session of test key provider, whose parameters are the path of a key
+ * file with a [test] group holding the content key as 32 hex digits in key
+ * and optionally a fixed initialization vector in iv.
+ *
+ * @param	host	DTCP host, not used
+ * @param	port	DTCP port, not used
+ * @param	params	path of key file
+ *
+ * @return	session, NULL if key file could not be read
+ */
+static gpointer
+dlna_src_test_key_open (const gchar * host, guint port, const gchar * params)
+{
+  GstDlnaSrcTestKeySession *session = NULL;
+  GKeyFile *key_file = NULL;
+  GError *error = NULL;
+  gchar *key = NULL;
+  gchar *iv = NULL;
+
+  if (params == NULL) {
+    GST_WARNING ("Test key provider needs path of key file");
+    return NULL;
+  }
+
+  key_file = g_key_file_new ();
+  if (!g_key_file_load_from_file (key_file, params, G_KEY_FILE_NONE, &error)) {
+    GST_WARNING ("Unable to load key file %s: %s", params, error->message);
+    g_error_free (error);
+    g_key_file_free (key_file);
+    return NULL;
+  }
+
+  session = g_slice_new0 (GstDlnaSrcTestKeySession);
+  key = g_key_file_get_string (key_file, TEST_KEY_FILE_GROUP,
+      TEST_KEY_FILE_KEY, NULL);
+  iv = g_key_file_get_string (key_file, TEST_KEY_FILE_GROUP,
+      TEST_KEY_FILE_IV, NULL);
+  g_key_file_free (key_file);
+
+  if (!dlna_decrypter_parse_hex (key, session->key, sizeof (session->key))) {
+    GST_WARNING ("Key file %s has no valid key", params);
+    g_slice_free (GstDlnaSrcTestKeySession, session);
+    session = NULL;
+  } else if (iv != NULL) {
+    session->has_iv = dlna_decrypter_parse_hex (iv, session->iv,
+        sizeof (session->iv));
+    if (!session->has_iv)
+      GST_WARNING ("Ignoring invalid iv of key file %s", params);
+  }
+  g_free (key);
+  g_free (iv);
+
+  return session;
+}
+
+/**
+ * Returns fixed key of test session.  Without a fixed initialization vector
+ * the nonce of the PCP header (bytes 2 to 9) is used twice.
+ *
+ * @param	session		test session
+ * @param	pcp_header	header of packet
+ * @param	key			returned content key
+ * @param	iv			returned initialization vector
+ *
+ * @return	true always
+ */
+static gboolean
+dlna_src_test_key_content_key (gpointer session, const guint8 * pcp_header,
+    guint8 * key, guint8 * iv)
+{
+  GstDlnaSrcTestKeySession *test = session;
+
+  memcpy (key, test->key, GST_DLNA_SRC_AES_KEY_SIZE);
+  if (test->has_iv) {
+    memcpy (iv, test->iv, GST_DLNA_SRC_AES_BLOCK_SIZE);
+  } else {
+    memcpy (iv, &pcp_header[2], 8);
+    memcpy (&iv[8], &pcp_header[2], 8);
+  }
+
+  return TRUE;
+}
+
+/**
+ * Closes test session.
+ *
+ * @param	session	test session
+ */
+static void
+dlna_src_test_key_close (gpointer session)
+{
+  g_slice_free (GstDlnaSrcTestKeySession, session);
+}
@@ -0,0 +1,131 @@
+/* Copyright (C) 2013 Cable Television Laboratories, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS
+ * IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __GST_DLNA_DECRYPTER_H__
+#define __GST_DLNA_DECRYPTER_H__
+
+#include <gst/gst.h>
+
+#include "gstdlnaaes.h"
+#include "gstdlnasrc.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_DLNA_DECRYPTER \
+        (gst_dlna_decrypter_get_type())
+#define GST_DLNA_DECRYPTER(obj) \
+        (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_DLNA_DECRYPTER,GstDlnaDecrypter))
+#define GST_IS_DLNA_DECRYPTER(obj) \
+        (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_DLNA_DECRYPTER))
+
+// Name decrypter is registered under, usable as dtcp_decrypter_factory
+#define GST_DLNA_DECRYPTER_FACTORY "dlnadecrypter"
+
+typedef struct _GstDlnaDecrypter GstDlnaDecrypter;
+typedef struct _GstDlnaDecrypterClass GstDlnaDecrypterClass;
+typedef struct _GstDlnaSrcKeyProvider GstDlnaSrcKeyProvider;
+typedef struct _GstDlnaDecrypterKey GstDlnaDecrypterKey;
+
+/**
+ * GstDlnaSrcKeyProvider:
+ *
+ * Source of content keys for the in-bin decrypter.  Authentication and key
+ * derivation of DTCP are left to the provider, the decrypter only hands it
+ * the header of each protected content packet (PCP) and decrypts payload
+ * with the AES-128 key and initialization vector it returns.
+ *
+ * open:        opens session with DTCP source at supplied host and port,
+ *              params are specific to provider, returns NULL on failure
+ * content_key: returns 16 byte content key and initialization vector of
+ *              PCP with supplied header, false if there is none
+ * close:       closes session returned by open
+ */
+struct _GstDlnaSrcKeyProvider
+{
+    const gchar* name;
+    gpointer (*open) (const gchar* host, guint port, const gchar* params);
+    gboolean (*content_key) (gpointer session, const guint8* pcp_header,
+        guint8* key, guint8* iv);
+    void (*close) (gpointer session);
+};
+
+/**
+ * GstDlnaDecrypter:
+ *
+ * Decrypts DTCP protected content in place using a key provider
+ */
+struct _GstDlnaDecrypter
+{
+    GstElement element;
+    GstPad* sink_pad;
+    GstPad* src_pad;
+
+    gchar* dtcp_host;
+    guint dtcp_port;
+    gchar* key_provider_name;
+    const GstDlnaSrcKeyProvider* key_provider;
+    gpointer session;
+    GstDlnaSrcAesImpl aes_impl;
+
+    // State of PCP being decrypted, header and last partial AES block may
+    // be split across buffers
+    guint8 pcp_header[DTCP_PCP_HEADER_SIZE];
+    guint pcp_header_fill;
+    guint64 payload_remaining;
+    guint64 clear_remaining;
+    guint8 raw_key[GST_DLNA_SRC_AES_KEY_SIZE];
+    GstDlnaDecrypterKey* key;
+    guint8 iv[GST_DLNA_SRC_AES_BLOCK_SIZE];
+    guint8 carry[GST_DLNA_SRC_AES_BLOCK_SIZE];
+    guint carry_fill;
+    gboolean discont;
+
+    // Worker pool decrypting parts of buffers in parallel, buffers and
+    // serialized events are kept in stream order until pushed by src pad task
+    guint workers;
+    GThreadPool* pool;
+    guint pool_size;
+    GMutex pool_mutex;
+    GCond pool_cond;
+    GQueue pending;
+    gboolean flushing;
+    GstFlowReturn src_result;
+    gboolean out_discont;
+};
+
+struct _GstDlnaDecrypterClass
+{
+    GstElementClass parent_class;
+};
+
+GType gst_dlna_decrypter_get_type (void);
+
+void gst_dlna_src_key_provider_register (const GstDlnaSrcKeyProvider* provider);
+
+const GstDlnaSrcKeyProvider* gst_dlna_src_key_provider_find (const gchar* name);
+
+G_END_DECLS
+
+#endif /* __GST_DLNA_DECRYPTER_H__ */
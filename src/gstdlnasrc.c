@@ -36,13 +36,26 @@
 #include <glib-object.h>
 
 #include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
 #include <unistd.h>
 #define CLOSESOCK(s) (void)close(s)
 
+// Sending on connection closed by server must fail rather than raise SIGPIPE
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
 #include "gstdlnasrc.h"
+#include "gstdlnadecrypter.h"
 
 /* props */
 enum
@@ -51,16 +64,344 @@ enum
   PROP_URI,
   PROP_CL_NAME,
   PROP_SUPPORTED_RATES,
+  PROP_CACHE_BLOCKS,
+  PROP_WARM_CONNECTION,
+  PROP_SEEK_WINDOW,
+  PROP_SEEKS_ISSUED,
+  PROP_SEEKS_DROPPED,
+  PROP_DTCP_QUEUE_SIZE,
+  PROP_DTCP_DECRYPTER_FACTORY,
+  PROP_DTCP_KEY_PROVIDER,
+  PROP_PREFETCH_SECONDS,
+  PROP_METADATA_CACHE,
+  PROP_SHARED_CACHE,
+  PROP_KEYFRAME_FILTER_RATE,
+  PROP_TRICK_MODE_EMULATION,
+  PROP_SEAMLESS_RATE_SWITCH,
+  PROP_RANGE_REFRESH_SECONDS,
+  PROP_LIVE_LATENCY,
   //...
 };
 
+/* signals */
+enum
+{
+  SIGNAL_PREFETCH_URI,
+  LAST_SIGNAL
+};
+
+
 #define DLNA_SRC_CL_NAME "dlnasrc"
 
 // Constant names for elements in this src
 #define ELEMENT_NAME_SOUP_HTTP_SRC "soup-http-source"
 #define ELEMENT_NAME_DTCP_DECRYPTER "dtcp-decrypter"
+#define ELEMENT_NAME_DTCP_QUEUE "dtcp-queue"
 
 #define MAX_HTTP_BUF_SIZE 2048
+
+// Requests issued by this element on its own connections give up on a
+// server which stalls for this long
+#define SOCKET_TIMEOUT_SECONDS 10
+
+// Block cache used when src pad operates in pull mode
+#define CACHE_BLOCK_SIZE (256 * 1024)
+#define DEFAULT_CACHE_BLOCKS 64
+#define MAX_CACHE_BLOCKS 4096
+#define CACHE_READAHEAD_BLOCKS 3
+
+#define DEFAULT_WARM_CONNECTION TRUE
+
+// Seek coalescing is opt-in, seeks are issued synchronously by default
+#define DEFAULT_SEEK_WINDOW_MS 0
+#define MAX_SEEK_WINDOW_MS 5000
+
+#define DEFAULT_DTCP_QUEUE_SIZE (2 * 1024 * 1024)
+
+// Any element with this factory's dtcp1host and dtcp1port properties and a
+// single sink and src pad can be used to decrypt protected content
+#define DEFAULT_DTCP_DECRYPTER_FACTORY "dtcpip"
+
+// DTCP exchange keys expire once unused for two hours, discard authenticated
+// decrypters a little before that
+#define DTCP_DECRYPTER_EXPIRY_SECS (110 * 60)
+
+// Data of a prefetched item is kept for a limited time for a few items
+#define DEFAULT_PREFETCH_SECONDS 5
+#define MAX_PREFETCH_SECONDS 60
+#define MAX_PREFETCH_BYTES (32 * 1024 * 1024)
+#define PREFETCH_FALLBACK_BYTE_RATE (1024 * 1024)
+#define PREFETCH_EXPIRY_SECS 120
+#define MAX_PREFETCHED_ITEMS 4
+#define PREFETCH_PUSH_BYTES (256 * 1024)
+
+// Persistent store of HEAD response essentials and seek index per uri,
+// records have a fixed layout in native byte order followed by the uri and
+// the seek index
+#define DEFAULT_METADATA_CACHE FALSE
+#define STORE_MAGIC 0x534e4c44
+#define STORE_VERSION 2
+#define STORE_STRING_SIZE 128
+#define STORE_PLAYSPEED_SIZE 16
+#define STORE_URI_SIZE(len) (((len) + 7) & ~7)
+#define MAX_SEEK_INDEX_ENTRIES 4096
+
+// Transport streams flowing through src pad are scanned for PCRs which are
+// added to seek index at most once per interval of media time
+#define TS_SYNC_BYTE 0x47
+#define PCR_INDEX_INTERVAL (2 * GST_SECOND)
+#define PCR_WRAP ((G_GUINT64_CONSTANT (1) << 33) * 300)
+
+// Sync byte must recur at packet size for this many packets to be trusted
+// when looking for first packet of a restarted transfer, data ending before
+// that is held back until next buffer
+#define TS_SYNC_CONFIRM_CNT 4
+
+// Video stream types of PMT which key frame filter can look into
+#define STREAM_TYPE_MPEG1_VIDEO 0x01
+#define STREAM_TYPE_MPEG2_VIDEO 0x02
+#define STREAM_TYPE_H264 0x1b
+
+// At high rates only packets of key frames and tables of transport streams
+// may be passed on, disabled by default
+#define DEFAULT_KEYFRAME_FILTER_RATE 0.0
+#define MAX_KEYFRAME_FILTER_RATE 1024.0
+
+// Rates server does not support may be emulated for transport streams by
+// fetching one key frame per interval through byte range requests
+#define DEFAULT_TRICK_MODE_EMULATION FALSE
+#define TRICK_FRAME_INTERVAL (GST_SECOND / 4)
+
+// Range fetched for a key frame covers a little content at its bitrate and
+// is extended until the frame ends
+#define TRICK_FETCH_DURATION (GST_SECOND / 2)
+#define MIN_TRICK_FETCH_SIZE (128 * 1024)
+#define MAX_TRICK_FETCH_SIZE (8 * 1024 * 1024)
+
+// Reverse rates server does not support are played from chunks fetched
+// backwards, one chunk is fetched while the previous one is pushed
+#define REVERSE_CHUNK_DURATION GST_SECOND
+#define REVERSE_PREFETCH_CHUNKS 2
+
+// Rate changes may open transfer of new rate while current one keeps flowing
+// and switch over at first key frame of new transfer, disabled by default
+#define DEFAULT_SEAMLESS_RATE_SWITCH FALSE
+#define RATE_SWITCH_READ_SIZE (64 * 1024)
+#define RATE_SWITCH_POLL_MS 100
+
+// Ranges of growing content are refreshed by HEAD request at this interval,
+// live edge is extrapolated from growth rates in between
+#define DEFAULT_RANGE_REFRESH_SECONDS 30
+#define MAX_RANGE_REFRESH_SECONDS 3600
+#define LIVE_EDGE_SMOOTHING 0.5
+
+// Live content may be played with a target latency behind its live edge,
+// disabled by default
+#define DEFAULT_LIVE_LATENCY_MS 0
+#define MAX_LIVE_LATENCY_MS 60000
+
+// Lag of transport streams is measured as PCRs falling behind wall clock
+// since content was joined, which needs no refreshes and also applies to
+// content paced by server.  PCRs running this far ahead of wall clock are
+// taken for a discontinuity and measuring starts over.  Growth rates of
+// other content are sampled again shortly after joining it.
+#define LIVE_PCR_MAX_LEAD (60 * GST_SECOND)
+#define LIVE_EDGE_FIRST_REFRESH_SECONDS 2
+
+// Stored records are also shared with other processes through a hash table
+// in a named shared memory segment, each slot is guarded by a sequence number
+// which is odd while slot is being written.  Writers claim a slot by storing
+// their process id in it, a slot claimed by a process which has gone is
+// taken over by the next writer.
+#define SHM_MAGIC 0x4d534c44
+#define SHM_VERSION 2
+#define SHM_SLOT_CNT 256
+#define SHM_SLOT_DATA_SIZE (16 * 1024)
+#define SHM_MAX_PROBES 8
+#define SHM_READ_ATTEMPTS 4
+#define SHM_ENTRY_EXPIRY_SECS 600
+
+// Segment is created exclusively by one process, which publishes magic once
+// layout is stamped, others wait for that a little while
+#define SHM_OPEN_ATTEMPTS 3
+#define SHM_INIT_WAIT_USECS (100 * 1000)
+#define SHM_INIT_POLL_USECS 1000
+
+// Upper bound on protected content packets remembered per uri, enough to
+// cover several hours of content using 8 MB packets
+#define MAX_PCP_MAP_ENTRIES 65536
+
+// Authenticated decrypters kept after element is disposed so AKE can be
+// skipped when another element streams from same DTCP host and port
+typedef struct
+{
+  gchar *host;
+  guint port;
+  GstElement *decrypter;
+  gint64 stashed_time;
+} GstDlnaSrcDtcpDecrypter;
+
+static GMutex dtcp_decrypters_mutex;
+static GList *dtcp_decrypters = NULL;
+
+// HEAD response and leading data of items prefetched by any element, taken
+// by the element which is next set to the same uri
+typedef struct
+{
+  gchar *uri;
+  GstDlnaSrcHeadResponse *server_info;
+  GstBuffer *data;
+  gint64 prefetch_time;
+} GstDlnaSrcPrefetch;
+
+// Prefetch performed on a thread of its own on behalf of an element
+typedef struct
+{
+  gchar *uri;
+  gchar *dtcp_decrypter_factory;
+  gchar *dtcp_key_provider;
+  guint seconds;
+} GstDlnaSrcPrefetchRequest;
+
+static GMutex prefetch_mutex;
+static GList *prefetched = NULL;
+
+// Element issuing HEAD and ranged GET requests of prefetches, created once
+// and used by one prefetch thread at a time
+static GMutex prefetch_context_mutex;
+static GstDlnaSrc *prefetch_context = NULL;
+
+static guint gst_dlna_src_signals[LAST_SIGNAL] = { 0 };
+
+typedef struct
+{
+  guint32 magic;
+  guint32 version;
+  guint32 uri_len;
+  guint32 seek_index_cnt;
+  guint32 accept_byte_ranges;
+  guint32 time_seek_response_received;
+  guint32 feature_flags;
+  guint32 dtcp_port;
+  guint32 playspeeds_cnt;
+  gint32 available_seek_mode;
+  guint32 available_seek_npt_received;
+  guint32 available_seek_bytes_received;
+  guint64 content_length;
+  guint64 time_seek_npt_start;
+  guint64 time_seek_npt_end;
+  guint64 time_seek_npt_duration;
+  guint64 byte_seek_start;
+  guint64 byte_seek_end;
+  guint64 byte_seek_total;
+  guint64 dtcp_range_start;
+  guint64 dtcp_range_end;
+  guint64 dtcp_range_total;
+  guint64 available_seek_npt_start;
+  guint64 available_seek_npt_end;
+  guint64 available_seek_byte_start;
+  guint64 available_seek_byte_end;
+  gfloat playspeeds[PLAYSPEEDS_MAX_CNT];
+  gchar playspeed_strs[PLAYSPEEDS_MAX_CNT][STORE_PLAYSPEED_SIZE];
+  gchar profile[STORE_STRING_SIZE];
+  gchar content_type[STORE_STRING_SIZE];
+  gchar dtcp_host[STORE_STRING_SIZE];
+} GstDlnaSrcStoreRecord;
+
+// Content features stored as bits of feature_flags, in bit order
+static const glong STORE_FEATURE_FLAGS[] = {
+  G_STRUCT_OFFSET (GstDlnaSrcHeadResponseContentFeatures,
+      op_time_seek_supported),
+  G_STRUCT_OFFSET (GstDlnaSrcHeadResponseContentFeatures, op_range_supported),
+  G_STRUCT_OFFSET (GstDlnaSrcHeadResponseContentFeatures,
+      flag_sender_paced_set),
+  G_STRUCT_OFFSET (GstDlnaSrcHeadResponseContentFeatures,
+      flag_limited_time_seek_set),
+  G_STRUCT_OFFSET (GstDlnaSrcHeadResponseContentFeatures,
+      flag_limited_byte_seek_set),
+  G_STRUCT_OFFSET (GstDlnaSrcHeadResponseContentFeatures,
+      flag_play_container_set),
+  G_STRUCT_OFFSET (GstDlnaSrcHeadResponseContentFeatures,
+      flag_so_increasing_set),
+  G_STRUCT_OFFSET (GstDlnaSrcHeadResponseContentFeatures,
+      flag_sn_increasing_set),
+  G_STRUCT_OFFSET (GstDlnaSrcHeadResponseContentFeatures,
+      flag_rtsp_pause_set),
+  G_STRUCT_OFFSET (GstDlnaSrcHeadResponseContentFeatures,
+      flag_streaming_mode_set),
+  G_STRUCT_OFFSET (GstDlnaSrcHeadResponseContentFeatures,
+      flag_interactive_mode_set),
+  G_STRUCT_OFFSET (GstDlnaSrcHeadResponseContentFeatures,
+      flag_background_mode_set),
+  G_STRUCT_OFFSET (GstDlnaSrcHeadResponseContentFeatures, flag_stalling_set),
+  G_STRUCT_OFFSET (GstDlnaSrcHeadResponseContentFeatures, flag_dlna_v15_set),
+  G_STRUCT_OFFSET (GstDlnaSrcHeadResponseContentFeatures,
+      flag_link_protected_set),
+  G_STRUCT_OFFSET (GstDlnaSrcHeadResponseContentFeatures,
+      flag_full_clear_text_set),
+  G_STRUCT_OFFSET (GstDlnaSrcHeadResponseContentFeatures,
+      flag_limited_clear_text_set)
+};
+
+// Chunks of reverse playback handed from fetching to pushing thread, slots
+// limit how far fetching runs ahead
+typedef struct
+{
+  GstDlnaSrc *dlna_src;
+  GAsyncQueue *chunks;
+  GAsyncQueue *slots;
+  guint64 position;
+  guint64 chunk_size;
+  gint stop;
+  gboolean failed;
+} GstDlnaSrcReverse;
+
+// Key frame extracted from range fetched for trick mode emulation, range is
+// extended until frame ends and only bytes added to it are parsed
+typedef struct
+{
+  guint8 *data;
+  gsize size;
+  gsize parsed;
+  gsize offset;
+  gboolean synced;
+  gboolean started;
+  gboolean complete;
+  gboolean pcr_found;
+  guint64 pcr;
+} GstDlnaSrcTrickFrame;
+
+// Stored HEAD response checked against server on behalf of an element
+typedef struct
+{
+  GstDlnaSrc *dlna_src;
+  gchar *uri;
+  gchar *shared_cache;
+  guint generation;
+  GstDlnaSrcStoreRecord record;
+} GstDlnaSrcStoreValidation;
+
+typedef struct
+{
+  gint seq;
+  gint key;
+  guint32 size;
+  gint writer;
+  gint64 stored_time;
+  gchar data[SHM_SLOT_DATA_SIZE];
+} GstDlnaSrcShmSlot;
+
+typedef struct
+{
+  gint magic;
+  guint32 version;
+  guint32 slot_cnt;
+  guint32 slot_size;
+  GstDlnaSrcShmSlot slots[SHM_SLOT_CNT];
+} GstDlnaSrcShmTable;
+
+static GMutex shm_mutex;
+static GHashTable *shm_tables = NULL;
 static const char CRLF[] = "\r\n";
 
 static const char COLON[] = ":";
@@ -81,7 +422,8 @@ static const char *HEAD_RESPONSE_HEADERS[] = {
   "CACHE-CONTROL",              // 11
   "CONTENT-LENGTH",             // 12
   "ACCEPT-RANGES",              // 13
-  "CONTENT-RANGE"               // 14
+  "CONTENT-RANGE",              // 14
+  "AVAILABLESEEKRANGE.DLNA.ORG" // 15
 };
 
 // Constants which represent indices in HEAD_RESPONSE_HEADERS string array
@@ -101,9 +443,10 @@ static const char *HEAD_RESPONSE_HEADERS[] = {
 #define HEADER_INDEX_CONTENT_LENGTH 12
 #define HEADER_INDEX_ACCEPT_RANGES 13
 #define HEADER_INDEX_CONTENT_RANGE 14
+#define HEADER_INDEX_AVAILABLE_SEEK_RANGE 15
 
 // Count of field headers in HEAD_RESPONSE_HEADERS along with HEADER_INDEX_* constants
-static const gint HEAD_RESPONSE_HEADERS_CNT = 15;
+static const gint HEAD_RESPONSE_HEADERS_CNT = 16;
 
 // Subfield headers within TIMESEEKRANGE.DLNA.ORG
 static const char *TIME_SEEK_HEADERS[] = {
@@ -143,6 +486,58 @@ static const char *CONTENT_TYPE_HEADERS[] = {
 #define HEADER_INDEX_CONTENT_FORMAT 2
 #define HEADER_INDEX_APP_DTCP 3
 
+// Caps of content identified by DLNA profile or mime type, so downstream can
+// autoplug without typefinding.  Transport streams get packet size from the
+// profile, ISO profiles use 188 byte packets, all others 192 byte packets
+// with timestamp prefix.
+typedef struct
+{
+  const gchar *id;
+  const gchar *caps;
+  gboolean transport_stream;
+} GstDlnaSrcCapsMapping;
+
+#define TS_PACKET_SIZE 188
+#define TTS_PACKET_SIZE 192
+
+// Profiles are matched by prefix, first match wins
+static const GstDlnaSrcCapsMapping PROFILE_CAPS[] = {
+  {"MPEG_TS_", "video/mpegts, systemstream=(boolean)true", TRUE},
+  {"AVC_TS_", "video/mpegts, systemstream=(boolean)true", TRUE},
+  {"VC1_TS_", "video/mpegts, systemstream=(boolean)true", TRUE},
+  {"MPEG_PS_",
+      "video/mpeg, mpegversion=(int)2, systemstream=(boolean)true", FALSE},
+  {"MPEG1", "video/mpeg, mpegversion=(int)1, systemstream=(boolean)true",
+      FALSE},
+  {"AVC_MP4_", "video/quicktime, variant=(string)iso", FALSE},
+  {"MPEG4_P2_MP4_", "video/quicktime, variant=(string)iso", FALSE},
+  {"AAC_ISO", "video/quicktime, variant=(string)iso", FALSE},
+  {"AAC_ADTS", "audio/mpeg, mpegversion=(int)4, stream-format=(string)adts",
+      FALSE},
+  {"MP3", "audio/mpeg, mpegversion=(int)1, layer=(int)3", FALSE},
+  {"WMV", "video/x-ms-asf", FALSE},
+  {"WMA", "video/x-ms-asf", FALSE},
+  {"JPEG_", "image/jpeg", FALSE},
+  {"PNG_", "image/png", FALSE}
+};
+
+// Mime types are used if profile is absent or unknown, matched ignoring case
+// and parameters
+static const GstDlnaSrcCapsMapping MIME_CAPS[] = {
+  {"video/vnd.dlna.mpeg-tts", "video/mpegts, systemstream=(boolean)true",
+      TRUE},
+  {"video/mp2t", "video/mpegts, systemstream=(boolean)true", TRUE},
+  {"video/mp4", "video/quicktime, variant=(string)iso", FALSE},
+  {"audio/mp4", "video/quicktime, variant=(string)iso", FALSE},
+  {"audio/mpeg", "audio/mpeg, mpegversion=(int)1, layer=(int)3", FALSE},
+  {"video/x-ms-wmv", "video/x-ms-asf", FALSE},
+  {"audio/x-ms-wma", "video/x-ms-asf", FALSE},
+  {"video/x-ms-asf", "video/x-ms-asf", FALSE},
+  {"video/x-matroska", "video/x-matroska", FALSE},
+  {"image/jpeg", "image/jpeg", FALSE},
+  {"image/png", "image/png", FALSE}
+};
+
 
 /**
  * DLNA Flag parameters defined in DLNA spec
@@ -185,6 +580,8 @@ static GstStaticPadTemplate gst_dlna_src_pad_template = GST_STATIC_PAD_TEMPLATE
 //
 static void gst_dlna_src_dispose (GObject * object);
 
+static void gst_dlna_src_finalize (GObject * object);
+
 static void gst_dlna_src_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * spec);
 
@@ -197,6 +594,14 @@ static gboolean gst_dlna_src_event (GstPad * pad, GstObject * parent,
 static gboolean gst_dlna_src_query (GstPad * pad, GstObject * parent,
     GstQuery * query);
 
+static void gst_dlna_src_handle_message (GstBin * bin, GstMessage * message);
+
+static gboolean gst_dlna_src_activate_mode (GstPad * pad, GstObject * parent,
+    GstPadMode mode, gboolean active);
+
+static GstFlowReturn gst_dlna_src_getrange (GstPad * pad, GstObject * parent,
+    guint64 offset, guint length, GstBuffer ** buffer);
+
 // **********************
 // Method declarations associated with URI handling
 //
@@ -214,6 +619,24 @@ static gboolean dlna_src_parse_uri (GstDlnaSrc * dlna_src);
 
 static gboolean dlna_src_dtcp_setup (GstDlnaSrc * dlna_src);
 
+static void dlna_src_dtcp_release (GstDlnaSrc * dlna_src, gboolean stash);
+
+static GstElement *dlna_src_dtcp_take_stashed (GstDlnaSrc * dlna_src,
+    const gchar * factory, const gchar * host, guint port);
+
+static GstElement *dlna_src_dtcp_create (GstDlnaSrc * dlna_src,
+    const gchar * factory);
+
+static gboolean dlna_src_dtcp_is_factory (GstDlnaSrc * dlna_src,
+    GstElement * decrypter, const gchar * factory);
+
+static GstStateChangeReturn gst_dlna_src_change_state (GstElement * element,
+    GstStateChange transition);
+
+static void dlna_src_reset_uri_state (GstDlnaSrc * dlna_src);
+
+static gboolean dlna_src_create_src_pad (GstDlnaSrc * dlna_src, GstPad * pad);
+
 static gboolean dlna_src_head_request (GstDlnaSrc * dlna_src,
     gint64 start_npt, gint64 start_byte, gboolean include_range_header,
     GstDlnaSrcHeadResponse ** head_response);
@@ -225,9 +648,22 @@ static gboolean dlna_src_head_request_formulate (GstDlnaSrc * dlna_src,
 static gboolean dlna_src_head_request_issue (GstDlnaSrc * dlna_src,
     gchar * head_request_str, gchar * head_response_str);
 
-static gboolean dlna_src_open_socket (GstDlnaSrc * dlna_src);
+static gboolean dlna_src_open_socket (GstDlnaSrc * dlna_src, gint * sock);
+
+static gboolean dlna_src_send_request (GstDlnaSrc * dlna_src, gint * sock,
+    const gchar * request, gsize len);
+static gboolean dlna_src_connect_socket (GstDlnaSrc * dlna_src,
+    const gchar * addr, guint port, gint * sock);
 
-static gboolean dlna_src_close_socket (GstDlnaSrc * dlna_src);
+static void dlna_src_warm_socket_prepare (GstDlnaSrc * dlna_src);
+
+static gpointer dlna_src_warm_socket_thread (gpointer data);
+
+static gboolean dlna_src_warm_socket_take (GstDlnaSrc * dlna_src, gint * sock);
+
+static void dlna_src_warm_socket_close (GstDlnaSrc * dlna_src);
+
+static gboolean dlna_src_close_socket (GstDlnaSrc * dlna_src, gint * sock);
 
 static void dlna_src_head_response_free (GstDlnaSrc * dlna_src,
     GstDlnaSrcHeadResponse * head_response);
@@ -271,6 +707,13 @@ static gboolean dlna_src_head_response_parse_dtcp_range (GstDlnaSrc *
     dlna_src, GstDlnaSrcHeadResponse * head_response, gint idx,
     gchar * field_str);
 
+static gboolean dlna_src_head_response_parse_available_seek (GstDlnaSrc *
+    dlna_src, GstDlnaSrcHeadResponse * head_response, gint idx,
+    gchar * field_str);
+
+static gboolean dlna_src_get_available_seek_range (GstDlnaSrc * dlna_src,
+    GstFormat format, guint64 * start, guint64 * end);
+
 static gboolean dlna_src_head_response_parse_content_type (GstDlnaSrc *
     dlna_src, GstDlnaSrcHeadResponse * head_response, gint idx,
     gchar * field_str);
@@ -288,6 +731,16 @@ static gboolean dlna_src_head_response_struct_to_str (GstDlnaSrc * dlna_src,
 static gboolean dlna_src_handle_event_seek (GstDlnaSrc * dlna_src,
     GstPad * pad, GstEvent * event);
 
+static gboolean dlna_src_perform_seek (GstDlnaSrc * dlna_src,
+    GstEvent * event);
+
+static gboolean dlna_src_schedule_seek (GstDlnaSrc * dlna_src,
+    GstEvent * event);
+
+static void dlna_src_seek_discard_pending (GstDlnaSrc * dlna_src);
+
+static gpointer dlna_src_seek_thread (gpointer data);
+
 static gboolean dlna_src_handle_query_duration (GstDlnaSrc * dlna_src,
     GstQuery * query);
 
@@ -300,18 +753,288 @@ static gboolean dlna_src_handle_query_segment (GstDlnaSrc * dlna_src,
 static gboolean dlna_src_handle_query_convert (GstDlnaSrc * dlna_src,
     GstQuery * query);
 
+static gboolean dlna_src_handle_query_scheduling (GstDlnaSrc * dlna_src,
+    GstQuery * query);
+
 static gboolean dlna_src_is_change_valid (GstDlnaSrc * dlna_src, gfloat rate,
     GstFormat format, guint64 start,
     GstSeekType start_type, guint64 stop, GstSeekType stop_type);
 
 static gboolean dlna_src_is_rate_supported (GstDlnaSrc * dlna_src, gfloat rate);
 
+static void dlna_src_set_range_headers (GstDlnaSrc * dlna_src,
+    GstStructure * headers);
+
 static gboolean dlna_src_formulate_extra_headers (GstDlnaSrc * dlna_src,
-    gfloat rate, GstFormat format, guint64 start, GstStructure ** headers);
+    gfloat rate, GstFormat format, guint64 start, guint64 stop,
+    GstStructure ** headers);
+
+static gboolean dlna_src_restart_transfer (GstDlnaSrc * dlna_src,
+    gdouble rate, GstFormat format, guint64 start, guint64 stop,
+    GstSeekFlags flags, guint32 seqnum);
+
+static void dlna_src_push_flush (GstDlnaSrc * dlna_src, GstEvent * event);
+
+static gboolean dlna_src_internal_event (GstPad * pad, GstObject * parent,
+    GstEvent * event);
+
+static gboolean dlna_src_handle_query_caps (GstDlnaSrc * dlna_src,
+    GstQuery * query);
+
+static const GstDlnaSrcCapsMapping *dlna_src_caps_lookup (const
+    GstDlnaSrcCapsMapping * mappings, guint cnt, const gchar * id,
+    gboolean by_prefix);
+
+static void dlna_src_update_caps (GstDlnaSrc * dlna_src);
+
+static void dlna_src_pcr_scan (GstDlnaSrc * dlna_src, GstBuffer * buf);
+
+static gboolean dlna_src_pcr_parse (const guint8 * packet, guint64 * pcr,
+    gint * pid);
+
+static gssize dlna_src_ts_find_sync (const guint8 * data, gsize size,
+    guint packet_size, gsize * keep);
+
+static void dlna_src_psi_capture (GstDlnaSrc * dlna_src,
+    const guint8 * packet, guint packet_size);
+
+static void dlna_src_psi_store (GstDlnaSrc * dlna_src, GstBuffer ** stored,
+    const guint8 * packet, guint packet_size);
+
+static GstBuffer *dlna_src_psi_copy (GstDlnaSrc * dlna_src,
+    GstBuffer * stored, guint8 * cc);
+
+static GstBuffer *dlna_src_psi_inject (GstDlnaSrc * dlna_src,
+    GstBuffer * buf);
+
+static void dlna_src_keyframe_reset (GstDlnaSrc * dlna_src);
+
+static gboolean dlna_src_is_trick_emulated (GstDlnaSrc * dlna_src,
+    gfloat rate);
+
+static gboolean dlna_src_trick_start (GstDlnaSrc * dlna_src, gdouble rate,
+    GstFormat format, gint64 start, guint32 seqnum);
+
+static gboolean dlna_src_trick_run (GstDlnaSrc * dlna_src, GThreadFunc func,
+    guint32 seqnum);
+
+static void dlna_src_trick_stop (GstDlnaSrc * dlna_src, gboolean flush);
+
+static gboolean dlna_src_is_reverse_emulated (GstDlnaSrc * dlna_src,
+    gfloat rate);
+
+static gboolean dlna_src_reverse_start (GstDlnaSrc * dlna_src, gdouble rate,
+    GstFormat format, gint64 start, guint32 seqnum);
+
+static gpointer dlna_src_reverse_thread (gpointer data);
+
+static gpointer dlna_src_reverse_fetch_thread (gpointer data);
+
+static gboolean dlna_src_is_rate_switch_seamless (GstDlnaSrc * dlna_src,
+    gdouble rate, GstSeekFlags flags, gint64 start);
+
+static gboolean dlna_src_rate_switch_start (GstDlnaSrc * dlna_src,
+    gdouble rate, GstFormat format, gint64 start, guint32 seqnum);
+
+static void dlna_src_rate_switch_stop (GstDlnaSrc * dlna_src, gboolean flush);
+
+static void dlna_src_rate_switch_free (GstDlnaSrcRateSwitch * rate_switch);
+
+static gpointer dlna_src_rate_switch_thread (gpointer data);
+
+static gboolean dlna_src_rate_switch_request (GstDlnaSrc * dlna_src,
+    GstDlnaSrcRateSwitch * rate_switch, gint * sock, guint8 * data,
+    gsize * filled);
+
+static gssize dlna_src_rate_switch_read (GstDlnaSrcRateSwitch * rate_switch,
+    gint sock, guint8 * data, gsize size);
+
+static gssize dlna_src_rate_switch_find_keyframe (GstDlnaSrc * dlna_src,
+    GstDlnaSrcRateSwitch * rate_switch, const guint8 * data, gsize size);
+
+static gboolean dlna_src_rate_switch_hand_over (GstDlnaSrc * dlna_src,
+    GstDlnaSrcRateSwitch * rate_switch);
+
+static gboolean dlna_src_rate_switch_take_over (GstDlnaSrc * dlna_src,
+    GstPadProbeInfo * info);
+
+static gboolean dlna_src_is_content_growing (GstDlnaSrcHeadResponse * info);
+
+static void dlna_src_refresh_start (GstDlnaSrc * dlna_src);
+
+static void dlna_src_refresh_stop (GstDlnaSrc * dlna_src);
+
+static gpointer dlna_src_refresh_thread (gpointer data);
+
+static void dlna_src_live_edge_update (GstDlnaSrc * dlna_src,
+    GstDlnaSrcHeadResponse * info);
+
+static gboolean dlna_src_live_edge_get (GstDlnaSrc * dlna_src,
+    guint64 * time, guint64 * bytes);
+
+static gboolean dlna_src_live_edge_extrapolate (GstDlnaSrc * dlna_src,
+    guint64 * time, guint64 * bytes);
+
+static gboolean dlna_src_is_low_latency (GstDlnaSrc * dlna_src);
+
+static gboolean dlna_src_live_start_position (GstDlnaSrc * dlna_src,
+    GstFormat * format, guint64 * start);
+
+static void dlna_src_live_start (GstDlnaSrc * dlna_src);
+
+static gboolean dlna_src_live_lag_pcr (GstDlnaSrc * dlna_src,
+    GstBuffer * buf, GstClockTime * lag);
+
+static gboolean dlna_src_live_lag_bytes (GstDlnaSrc * dlna_src,
+    GstBuffer * buf, GstClockTime * lag);
+
+static gboolean dlna_src_live_catch_up (GstDlnaSrc * dlna_src,
+    GstBuffer * buf, gboolean * caught_up);
+
+static gboolean dlna_src_handle_query_latency (GstDlnaSrc * dlna_src,
+    GstQuery * query);
+
+static gpointer dlna_src_trick_thread (gpointer data);
+
+static gboolean dlna_src_trick_extract (GstDlnaSrc * dlna_src,
+    const guint8 * data, gsize size, GstDlnaSrcTrickFrame * frame);
+
+static GstClockTime dlna_src_trick_frame_time (GstDlnaSrc * dlna_src,
+    GstDlnaSrcTrickFrame * frame, guint64 start_byte, guint64 position);
+
+static guint64 dlna_src_trick_byte_rate (GstDlnaSrc * dlna_src,
+    guint64 content_size, guint64 duration);
+
+static GstBuffer *dlna_src_keyframe_filter (GstDlnaSrc * dlna_src,
+    GstBuffer * buf);
+
+static gboolean dlna_src_keyframe_packet (GstDlnaSrc * dlna_src,
+    const guint8 * ts);
+
+static GstBuffer *dlna_src_ts_resync (GstDlnaSrc * dlna_src, GstBuffer * buf);
+
+static void dlna_src_ts_sync_reset (GstDlnaSrc * dlna_src, gboolean resync);
+
+static GstEvent *dlna_src_content_info_event (GstDlnaSrc * dlna_src);
+
+static gboolean dlna_src_convert_known (GstDlnaSrc * dlna_src,
+    GstFormat src_fmt, gint64 src_val, GstFormat dest_fmt, gint64 * dest_val);
+
+static GstPadProbeReturn dlna_src_src_pad_probe (GstPad * pad,
+    GstPadProbeInfo * info, gpointer user_data);
+
+static gboolean dlna_src_is_link_protected (GstDlnaSrc * dlna_src);
+
+static GstPadProbeReturn dlna_src_pcp_probe (GstPad * pad,
+    GstPadProbeInfo * info, gpointer user_data);
+
+static void dlna_src_pcp_parse (GstDlnaSrc * dlna_src, const guint8 * data,
+    gsize size);
+
+static void dlna_src_pcp_map_add (GstDlnaSrc * dlna_src,
+    guint64 clear_offset, guint64 encrypted_offset, guint32 clear_len);
+
+static gboolean dlna_src_pcp_map_align (GstDlnaSrc * dlna_src,
+    guint64 clear_offset, guint64 * pcp_clear_offset,
+    guint64 * pcp_encrypted_offset);
+
+static void dlna_src_pcp_reset (GstDlnaSrc * dlna_src, gboolean known,
+    guint64 clear_offset, guint64 encrypted_offset);
+
+static void dlna_src_update_clear_text_segment (GstDlnaSrc * dlna_src,
+    const gchar * value);
+
+static void dlna_src_update_time_segment (GstDlnaSrc * dlna_src,
+    const gchar * value);
+
+static gboolean dlna_src_time_to_bytes (GstDlnaSrc * dlna_src,
+    guint64 time, gboolean round_up, guint64 * bytes);
+
+static void dlna_src_nanos_to_npt (GstDlnaSrc * dlna_src,
+    guint64 media_time_nanos, gchar * npt_str, gsize npt_str_size);
 
 static gboolean dlna_src_npt_to_nanos (GstDlnaSrc * dlna_src, gchar * string,
     guint64 * media_time_nanos);
 
+static gboolean dlna_src_get_content_size (GstDlnaSrc * dlna_src,
+    guint64 * size);
+
+static gboolean dlna_src_is_pull_supported (GstDlnaSrc * dlna_src);
+
+static void dlna_src_cache_clear (GstDlnaSrc * dlna_src);
+
+static GstDlnaSrcCacheBlock *dlna_src_cache_lookup (GstDlnaSrc * dlna_src,
+    guint64 index);
+
+static gboolean dlna_src_cache_fetch (GstDlnaSrc * dlna_src,
+    guint64 first_index, guint cnt, guint64 content_size);
+
+static gboolean dlna_src_range_request (GstDlnaSrc * dlna_src, gint * sock,
+    guint64 start_byte, guint64 end_byte, guint8 * data);
+
+static gboolean gst_dlna_src_prefetch_uri (GstDlnaSrc * dlna_src,
+    const gchar * uri);
+
+static gpointer dlna_src_prefetch_thread (gpointer data);
+
+static gboolean dlna_src_prefetch_size (GstDlnaSrc * dlna_src,
+    guint seconds, guint64 * size);
+
+static gboolean dlna_src_prefetch_take (GstDlnaSrc * dlna_src,
+    const gchar * uri);
+
+static gboolean dlna_src_prefetch_push (GstDlnaSrc * dlna_src, GstPad * pad);
+
+static void dlna_src_prefetch_free (GstDlnaSrcPrefetch * entry);
+
+static void dlna_src_seek_index_add (GstDlnaSrc * dlna_src, guint64 time,
+    guint64 offset);
+
+static gboolean dlna_src_seek_index_time_to_bytes (GstDlnaSrc * dlna_src,
+    guint64 time, guint64 * bytes);
+
+static gboolean dlna_src_seek_index_bytes_to_time (GstDlnaSrc * dlna_src,
+    guint64 bytes, guint64 * time);
+
+static gchar *dlna_src_store_path (const gchar * uri);
+
+static void dlna_src_store_fill_record (GstDlnaSrcHeadResponse * info,
+    GstDlnaSrcStoreRecord * record);
+
+static gboolean dlna_src_store_load (GstDlnaSrc * dlna_src);
+
+static gboolean dlna_src_store_read (GstDlnaSrc * dlna_src,
+    const gchar * contents, gsize size);
+
+static gchar *dlna_src_store_serialize (GstDlnaSrc * dlna_src,
+    gsize max_size, gsize * size);
+
+static void dlna_src_store_save (GstDlnaSrc * dlna_src);
+
+static void dlna_src_store_validate (GstDlnaSrc * dlna_src);
+
+static void dlna_src_server_info_swap (GstDlnaSrc * dlna_src,
+    GstDlnaSrcHeadResponse * info);
+
+static void dlna_src_server_info_retired_free (GstDlnaSrc * dlna_src);
+
+static GstDlnaSrcHeadResponse *dlna_src_head_response_copy (const
+    GstDlnaSrcHeadResponse * head_response);
+
+static gpointer dlna_src_store_validate_thread (gpointer data);
+
+static GstDlnaSrcShmTable *dlna_src_shm_open (GstDlnaSrc * dlna_src,
+    const gchar * name);
+
+static gint dlna_src_shm_key (const gchar * uri);
+
+static gboolean dlna_src_shm_lookup (GstDlnaSrc * dlna_src);
+
+static gboolean dlna_src_shm_claim (GstDlnaSrcShmSlot * slot);
+
+static void dlna_src_shm_publish (GstDlnaSrc * dlna_src, const gchar * data,
+    gsize size);
+
 
 #define gst_dlna_src_parent_class parent_class
 
@@ -351,6 +1074,9 @@ gst_dlna_src_class_init (GstDlnaSrcClass * klass)
 
   GstElementClass *gstelement_klass;
   gstelement_klass = (GstElementClass *) klass;
+
+  GstBinClass *gstbin_klass;
+  gstbin_klass = (GstBinClass *) klass;
   gst_element_class_set_static_metadata (gstelement_klass,
       "HTTP/DLNA client source 2/20/13 7:37 AM",
       "Source/Network",
@@ -380,7 +1106,143 @@ gst_dlna_src_class_init (GstDlnaSrcClass * klass)
           "List of supported playspeed rates of DLNA server content",
           G_TYPE_ARRAY, G_PARAM_READABLE));
 
+  g_object_class_install_property (gobject_klass, PROP_CACHE_BLOCKS,
+      g_param_spec_uint ("cache_blocks",
+          "Cache blocks",
+          "Number of 256 KB blocks cached when operating in pull mode",
+          1, MAX_CACHE_BLOCKS, DEFAULT_CACHE_BLOCKS, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_klass, PROP_WARM_CONNECTION,
+      g_param_spec_boolean ("warm_connection",
+          "Warm connection",
+          "Keep a spare connection to server open while seeking in pull "
+          "mode, emulated trick modes or seamless rate switches",
+          DEFAULT_WARM_CONNECTION, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_klass, PROP_SEEK_WINDOW,
+      g_param_spec_uint ("seek_window",
+          "Seek window",
+          "Milliseconds within which seeks are coalesced, 0 to disable",
+          0, MAX_SEEK_WINDOW_MS, DEFAULT_SEEK_WINDOW_MS, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_klass, PROP_SEEKS_ISSUED,
+      g_param_spec_uint ("seeks_issued",
+          "Seeks issued",
+          "Number of seeks which have been issued to server",
+          0, G_MAXUINT, 0, G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_klass, PROP_SEEKS_DROPPED,
+      g_param_spec_uint ("seeks_dropped",
+          "Seeks dropped",
+          "Number of seeks superseded by a newer seek before being issued",
+          0, G_MAXUINT, 0, G_PARAM_READABLE));
+
+  g_object_class_install_property (gobject_klass, PROP_DTCP_QUEUE_SIZE,
+      g_param_spec_uint ("dtcp_queue_size",
+          "DTCP queue size",
+          "Bytes queued between network reads and decryption, 0 to decrypt "
+          "on network thread", 0, G_MAXUINT, DEFAULT_DTCP_QUEUE_SIZE,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_klass, PROP_DTCP_DECRYPTER_FACTORY,
+      g_param_spec_string ("dtcp_decrypter_factory",
+          "DTCP decrypter factory",
+          "Name of element factory used to create decrypter for protected "
+          "content, takes effect for next uri", DEFAULT_DTCP_DECRYPTER_FACTORY,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_klass, PROP_DTCP_KEY_PROVIDER,
+      g_param_spec_string ("dtcp_key_provider",
+          "DTCP key provider",
+          "Key provider of decrypters with a key_provider property such as "
+          GST_DLNA_DECRYPTER_FACTORY ", as name optionally followed by colon "
+          "and parameters of provider, takes effect for next uri",
+          NULL, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_klass, PROP_PREFETCH_SECONDS,
+      g_param_spec_uint ("prefetch_seconds",
+          "Prefetch seconds",
+          "Seconds of content buffered ahead by prefetch-uri signal",
+          0, MAX_PREFETCH_SECONDS, DEFAULT_PREFETCH_SECONDS,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_klass, PROP_METADATA_CACHE,
+      g_param_spec_boolean ("metadata_cache",
+          "Metadata cache",
+          "Keep HEAD response and seek index of content in user cache dir "
+          "across runs", DEFAULT_METADATA_CACHE, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_klass, PROP_SHARED_CACHE,
+      g_param_spec_string ("shared_cache",
+          "Shared cache",
+          "Name of shared memory segment in which HEAD responses and seek "
+          "indexes are shared with other processes, NULL to disable",
+          NULL, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_klass, PROP_KEYFRAME_FILTER_RATE,
+      g_param_spec_float ("keyframe_filter_rate",
+          "Keyframe filter rate",
+          "Absolute rate from which only key frames and tables of transport "
+          "streams are passed on, 0 to disable",
+          0.0, MAX_KEYFRAME_FILTER_RATE, DEFAULT_KEYFRAME_FILTER_RATE,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_klass, PROP_TRICK_MODE_EMULATION,
+      g_param_spec_boolean ("trick_mode_emulation",
+          "Trick mode emulation",
+          "Emulate rates not supported by server for byte seekable transport "
+          "streams by fetching key frames", DEFAULT_TRICK_MODE_EMULATION,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_klass, PROP_SEAMLESS_RATE_SWITCH,
+      g_param_spec_boolean ("seamless_rate_switch",
+          "Seamless rate switch",
+          "Keep current transfer of transport streams flowing while transfer "
+          "of new rate is opened, switching over at its first key frame",
+          DEFAULT_SEAMLESS_RATE_SWITCH, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_klass, PROP_RANGE_REFRESH_SECONDS,
+      g_param_spec_uint ("range_refresh_seconds",
+          "Range refresh seconds",
+          "Interval at which ranges of growing content are refreshed by HEAD "
+          "request, live edge is extrapolated in between, 0 to disable",
+          0, MAX_RANGE_REFRESH_SECONDS, DEFAULT_RANGE_REFRESH_SECONDS,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_klass, PROP_LIVE_LATENCY,
+      g_param_spec_uint ("live_latency",
+          "Live latency",
+          "Milliseconds behind live edge at which live content is played, "
+          "data lagging further behind is dropped, 0 to disable",
+          0, MAX_LIVE_LATENCY_MS, DEFAULT_LIVE_LATENCY_MS, G_PARAM_READWRITE));
+
+  /**
+   * GstDlnaSrc::prefetch-uri:
+   * @dlna_src: this element
+   * @uri: uri of item which is to be played next
+   *
+   * Issues HEAD request for uri and buffers its first prefetch_seconds of
+   * content in background, so an element which is set to the uri later on
+   * can start without waiting on the server.
+   *
+   * Returns: true if prefetch has been started
+   */
+  gst_dlna_src_signals[SIGNAL_PREFETCH_URI] =
+      g_signal_new ("prefetch-uri", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_STRUCT_OFFSET (GstDlnaSrcClass, prefetch_uri), NULL, NULL,
+      g_cclosure_marshal_generic, G_TYPE_BOOLEAN, 1, G_TYPE_STRING);
+
+  klass->prefetch_uri = GST_DEBUG_FUNCPTR (gst_dlna_src_prefetch_uri);
+
   gobject_klass->dispose = GST_DEBUG_FUNCPTR (gst_dlna_src_dispose);
+  gobject_klass->finalize = GST_DEBUG_FUNCPTR (gst_dlna_src_finalize);
+
+  gstbin_klass->handle_message =
+      GST_DEBUG_FUNCPTR (gst_dlna_src_handle_message);
+
+  gstelement_klass->change_state =
+      GST_DEBUG_FUNCPTR (gst_dlna_src_change_state);
 }
 
 /*
@@ -400,6 +1262,60 @@ gst_dlna_src_init (GstDlnaSrc * dlna_src)
   // Initialize play rate to 1.0
   dlna_src->rate = 1.0;
 
+  // Initialize block cache used in pull mode
+  g_mutex_init (&dlna_src->cache_mutex);
+  dlna_src->cache_blocks = g_hash_table_new (g_int64_hash, g_int64_equal);
+  g_queue_init (&dlna_src->cache_lru);
+  dlna_src->cache_max_blocks = DEFAULT_CACHE_BLOCKS;
+  dlna_src->cache_sock = -1;
+
+  g_mutex_init (&dlna_src->event_mutex);
+  gst_segment_init (&dlna_src->segment, GST_FORMAT_BYTES);
+  dlna_src->last_pushed_offset = GST_BUFFER_OFFSET_NONE;
+  dlna_src->last_pushed_time = GST_CLOCK_TIME_NONE;
+
+  g_mutex_init (&dlna_src->warm_mutex);
+  dlna_src->warm_connection = DEFAULT_WARM_CONNECTION;
+  dlna_src->warm_sock = -1;
+
+  g_mutex_init (&dlna_src->seek_mutex);
+  g_cond_init (&dlna_src->seek_cond);
+  dlna_src->seek_window = DEFAULT_SEEK_WINDOW_MS;
+
+  dlna_src->dtcp_queue_size = DEFAULT_DTCP_QUEUE_SIZE;
+  dlna_src->dtcp_decrypter_factory = g_strdup (DEFAULT_DTCP_DECRYPTER_FACTORY);
+
+  dlna_src->prefetch_seconds = DEFAULT_PREFETCH_SECONDS;
+
+  dlna_src->keyframe_filter_rate = DEFAULT_KEYFRAME_FILTER_RATE;
+  dlna_src->keyframe_pid = -1;
+
+  dlna_src->trick_mode_emulation = DEFAULT_TRICK_MODE_EMULATION;
+  dlna_src->trick_sock = -1;
+
+  dlna_src->seamless_rate_switch = DEFAULT_SEAMLESS_RATE_SWITCH;
+  g_cond_init (&dlna_src->rate_switch_cond);
+
+  g_mutex_init (&dlna_src->head_mutex);
+
+  g_mutex_init (&dlna_src->refresh_mutex);
+  g_cond_init (&dlna_src->refresh_cond);
+  dlna_src->range_refresh_seconds = DEFAULT_RANGE_REFRESH_SECONDS;
+
+  dlna_src->live_latency = DEFAULT_LIVE_LATENCY_MS;
+  dlna_src->live_pcr_pid = -1;
+
+  dlna_src->metadata_cache = DEFAULT_METADATA_CACHE;
+  dlna_src->seek_index = g_array_new (FALSE, FALSE,
+      sizeof (GstDlnaSrcSeekAnchor));
+
+  dlna_src->pcr_pid = -1;
+  dlna_src->pcr_scan_next = GST_BUFFER_OFFSET_NONE;
+  dlna_src->pcr_last_indexed = GST_CLOCK_TIME_NONE;
+  dlna_src->pmt_pid = -1;
+
+  dlna_src->pcp_map = g_array_new (FALSE, FALSE, sizeof (GstDlnaSrcPcpEntry));
+
   // Create source element
   dlna_src->http_src =
       gst_element_factory_make ("souphttpsrc", ELEMENT_NAME_SOUP_HTTP_SRC);
@@ -426,9 +1342,121 @@ gst_dlna_src_dispose (GObject * object)
 
   GST_INFO_OBJECT (dlna_src, " Disposing the dlna src");
 
+  // Stop seek scheduler, discarding any seek not yet issued
+  g_mutex_lock (&dlna_src->seek_mutex);
+  dlna_src->seek_thread_stop = TRUE;
+  g_cond_signal (&dlna_src->seek_cond);
+  g_mutex_unlock (&dlna_src->seek_mutex);
+
+  if (dlna_src->seek_thread != NULL) {
+    g_thread_join (dlna_src->seek_thread);
+    dlna_src->seek_thread = NULL;
+  }
+  dlna_src_seek_discard_pending (dlna_src);
+
+  dlna_src_trick_stop (dlna_src, FALSE);
+  dlna_src_rate_switch_stop (dlna_src, FALSE);
+  dlna_src_refresh_stop (dlna_src);
+  dlna_src_cache_clear (dlna_src);
+  dlna_src_warm_socket_close (dlna_src);
+
+  if (dlna_src->prefetch_buffer != NULL) {
+    gst_buffer_unref (dlna_src->prefetch_buffer);
+    dlna_src->prefetch_buffer = NULL;
+  }
+
+  if (dlna_src->seek_index_dirty)
+    dlna_src_store_save (dlna_src);
+
+  // Keep authenticated decrypter for other elements streaming from same host
+  dlna_src_dtcp_release (dlna_src, TRUE);
+
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
+/**
+ * Called by framework when releasing the last reference to the element
+ *
+ * @param object  element to finalize
+ */
+static void
+gst_dlna_src_finalize (GObject * object)
+{
+  GstDlnaSrc *dlna_src = GST_DLNA_SRC (object);
+
+  g_hash_table_destroy (dlna_src->cache_blocks);
+  g_array_free (dlna_src->pcp_map, TRUE);
+  g_array_free (dlna_src->seek_index, TRUE);
+  g_free (dlna_src->dtcp_decrypter_factory);
+  g_free (dlna_src->dtcp_key_provider);
+  g_free (dlna_src->shared_cache);
+  dlna_src_server_info_retired_free (dlna_src);
+  if (dlna_src->caps != NULL)
+    gst_caps_unref (dlna_src->caps);
+  if (dlna_src->pat_packet != NULL)
+    gst_buffer_unref (dlna_src->pat_packet);
+  if (dlna_src->pmt_packet != NULL)
+    gst_buffer_unref (dlna_src->pmt_packet);
+  if (dlna_src->keyframe_rest != NULL)
+    gst_buffer_unref (dlna_src->keyframe_rest);
+  if (dlna_src->ts_sync_tail != NULL)
+    gst_buffer_unref (dlna_src->ts_sync_tail);
+  g_mutex_clear (&dlna_src->cache_mutex);
+  g_mutex_clear (&dlna_src->event_mutex);
+  g_mutex_clear (&dlna_src->warm_mutex);
+  g_mutex_clear (&dlna_src->seek_mutex);
+  g_cond_clear (&dlna_src->seek_cond);
+  g_cond_clear (&dlna_src->rate_switch_cond);
+  g_mutex_clear (&dlna_src->head_mutex);
+  g_mutex_clear (&dlna_src->refresh_mutex);
+  g_cond_clear (&dlna_src->refresh_cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+/**
+ * Called by framework on state changes.  Decrypter is kept in READY when
+ * this element goes to NULL so its authenticated session survives until
+ * element is either started again or disposed.  Trick mode emulation ends
+ * when element stops streaming.
+ *
+ * @param element     this element
+ * @param transition  state change being performed
+ *
+ * @return  result of state change
+ */
+static GstStateChangeReturn
+gst_dlna_src_change_state (GstElement * element, GstStateChange transition)
+{
+  GstDlnaSrc *dlna_src = GST_DLNA_SRC (element);
+  GstStateChangeReturn ret = GST_STATE_CHANGE_SUCCESS;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_NULL_TO_READY:
+      if (dlna_src->dtcp_decrypter)
+        gst_element_set_locked_state (dlna_src->dtcp_decrypter, FALSE);
+      break;
+
+    case GST_STATE_CHANGE_READY_TO_NULL:
+      if (dlna_src->dtcp_decrypter)
+        gst_element_set_locked_state (dlna_src->dtcp_decrypter, TRUE);
+      break;
+
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+
+  // Pads are inactive now so trick mode emulation no longer blocks on push
+  if (transition == GST_STATE_CHANGE_PAUSED_TO_READY) {
+    dlna_src_trick_stop (dlna_src, FALSE);
+    dlna_src_rate_switch_stop (dlna_src, FALSE);
+  }
+
+  return ret;
+}
+
 /**
  * Method called by framework to set this element's properties
  *
@@ -456,6 +1484,80 @@ gst_dlna_src_set_property (GObject * object, guint prop_id,
       }
       break;
     }
+    case PROP_CACHE_BLOCKS:
+      g_mutex_lock (&dlna_src->cache_mutex);
+      dlna_src->cache_max_blocks = g_value_get_uint (value);
+      g_mutex_unlock (&dlna_src->cache_mutex);
+      break;
+
+    case PROP_WARM_CONNECTION:
+      dlna_src->warm_connection = g_value_get_boolean (value);
+      if (!dlna_src->warm_connection)
+        dlna_src_warm_socket_close (dlna_src);
+      break;
+
+    case PROP_SEEK_WINDOW:
+      g_mutex_lock (&dlna_src->seek_mutex);
+      dlna_src->seek_window = g_value_get_uint (value);
+      g_mutex_unlock (&dlna_src->seek_mutex);
+      break;
+
+    case PROP_DTCP_QUEUE_SIZE:
+      dlna_src->dtcp_queue_size = g_value_get_uint (value);
+      if (dlna_src->dtcp_queue != NULL)
+        g_object_set (G_OBJECT (dlna_src->dtcp_queue), "max-size-bytes",
+            dlna_src->dtcp_queue_size, NULL);
+      break;
+
+    case PROP_DTCP_DECRYPTER_FACTORY:
+      g_free (dlna_src->dtcp_decrypter_factory);
+      dlna_src->dtcp_decrypter_factory = g_value_dup_string (value);
+      if (dlna_src->dtcp_decrypter_factory == NULL)
+        dlna_src->dtcp_decrypter_factory =
+            g_strdup (DEFAULT_DTCP_DECRYPTER_FACTORY);
+      break;
+
+    case PROP_DTCP_KEY_PROVIDER:
+      g_free (dlna_src->dtcp_key_provider);
+      dlna_src->dtcp_key_provider = g_value_dup_string (value);
+      break;
+
+    case PROP_PREFETCH_SECONDS:
+      dlna_src->prefetch_seconds = g_value_get_uint (value);
+      break;
+
+    case PROP_METADATA_CACHE:
+      dlna_src->metadata_cache = g_value_get_boolean (value);
+      break;
+
+    case PROP_SHARED_CACHE:
+      g_free (dlna_src->shared_cache);
+      dlna_src->shared_cache = g_value_dup_string (value);
+      break;
+
+    case PROP_KEYFRAME_FILTER_RATE:
+      dlna_src->keyframe_filter_rate = g_value_get_float (value);
+      break;
+
+    case PROP_TRICK_MODE_EMULATION:
+      dlna_src->trick_mode_emulation = g_value_get_boolean (value);
+      break;
+
+    case PROP_SEAMLESS_RATE_SWITCH:
+      dlna_src->seamless_rate_switch = g_value_get_boolean (value);
+      break;
+
+    case PROP_LIVE_LATENCY:
+      dlna_src->live_latency = g_value_get_uint (value);
+      break;
+
+    case PROP_RANGE_REFRESH_SECONDS:
+      g_mutex_lock (&dlna_src->refresh_mutex);
+      dlna_src->range_refresh_seconds = g_value_get_uint (value);
+      g_cond_signal (&dlna_src->refresh_cond);
+      g_mutex_unlock (&dlna_src->refresh_mutex);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -523,15 +1625,83 @@ gst_dlna_src_get_property (GObject * object, guint prop_id, GValue * value,
       }
       break;
 
-    default:
-      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
-  }
-}
+    case PROP_CACHE_BLOCKS:
+      g_value_set_uint (value, dlna_src->cache_max_blocks);
+      break;
 
-/**
- * Processes the supplied event
- *
- * @param pad	    pad where event was received
+    case PROP_WARM_CONNECTION:
+      g_value_set_boolean (value, dlna_src->warm_connection);
+      break;
+
+    case PROP_SEEK_WINDOW:
+      g_value_set_uint (value, dlna_src->seek_window);
+      break;
+
+    case PROP_DTCP_QUEUE_SIZE:
+      g_value_set_uint (value, dlna_src->dtcp_queue_size);
+      break;
+
+    case PROP_DTCP_DECRYPTER_FACTORY:
+      g_value_set_string (value, dlna_src->dtcp_decrypter_factory);
+      break;
+
+    case PROP_DTCP_KEY_PROVIDER:
+      g_value_set_string (value, dlna_src->dtcp_key_provider);
+      break;
+
+    case PROP_PREFETCH_SECONDS:
+      g_value_set_uint (value, dlna_src->prefetch_seconds);
+      break;
+
+    case PROP_METADATA_CACHE:
+      g_value_set_boolean (value, dlna_src->metadata_cache);
+      break;
+
+    case PROP_SHARED_CACHE:
+      g_value_set_string (value, dlna_src->shared_cache);
+      break;
+
+    case PROP_KEYFRAME_FILTER_RATE:
+      g_value_set_float (value, dlna_src->keyframe_filter_rate);
+      break;
+
+    case PROP_TRICK_MODE_EMULATION:
+      g_value_set_boolean (value, dlna_src->trick_mode_emulation);
+      break;
+
+    case PROP_SEAMLESS_RATE_SWITCH:
+      g_value_set_boolean (value, dlna_src->seamless_rate_switch);
+      break;
+
+    case PROP_RANGE_REFRESH_SECONDS:
+      g_value_set_uint (value, dlna_src->range_refresh_seconds);
+      break;
+
+    case PROP_LIVE_LATENCY:
+      g_value_set_uint (value, dlna_src->live_latency);
+      break;
+
+    case PROP_SEEKS_ISSUED:
+      g_mutex_lock (&dlna_src->seek_mutex);
+      g_value_set_uint (value, dlna_src->seeks_issued);
+      g_mutex_unlock (&dlna_src->seek_mutex);
+      break;
+
+    case PROP_SEEKS_DROPPED:
+      g_mutex_lock (&dlna_src->seek_mutex);
+      g_value_set_uint (value, dlna_src->seeks_dropped);
+      g_mutex_unlock (&dlna_src->seek_mutex);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+  }
+}
+
+/**
+ * Processes the supplied event
+ *
+ * @param pad	    pad where event was received
  * @param parent    parent of pad
  * @param event	    received event
  *
@@ -548,6 +1718,8 @@ gst_dlna_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
       GST_INFO_OBJECT (dlna_src, "Got src event: %s",
           GST_EVENT_TYPE_NAME (event));
       ret = dlna_src_handle_event_seek (dlna_src, pad, event);
+      if (ret)
+        gst_event_unref (event);
       break;
 
     case GST_EVENT_FLUSH_START:
@@ -615,6 +1787,14 @@ gst_dlna_src_query (GstPad * pad, GstObject * parent, GstQuery * query)
       ret = dlna_src_handle_query_convert (dlna_src, query);
       break;
 
+    case GST_QUERY_SCHEDULING:
+      ret = dlna_src_handle_query_scheduling (dlna_src, query);
+      break;
+
+    case GST_QUERY_CAPS:
+      ret = dlna_src_handle_query_caps (dlna_src, query);
+      break;
+
     case GST_QUERY_URI:
       GST_INFO_OBJECT (dlna_src, "query uri");
       gst_query_set_uri (query, dlna_src->uri);
@@ -629,7 +1809,9 @@ gst_dlna_src_query (GstPad * pad, GstObject * parent, GstQuery * query)
       break;
 
     case GST_QUERY_LATENCY:
-      // Don't know latency, let some other element handle this
+      // Latency is only known for live content in low latency mode,
+      // otherwise let some other element handle this
+      ret = dlna_src_handle_query_latency (dlna_src, query);
       break;
 
     case GST_QUERY_POSITION:
@@ -651,6 +1833,53 @@ gst_dlna_src_query (GstPad * pad, GstObject * parent, GstQuery * query)
   return ret;
 }
 
+/**
+ * Handles messages posted by elements within this bin.  Response headers
+ * posted by souphttpsrc are used to stamp the segment of a time based or
+ * cleartext byte based transfer with the position the server actually
+ * started from.
+ *
+ * @param bin       this element
+ * @param message   message posted by element within bin
+ */
+static void
+gst_dlna_src_handle_message (GstBin * bin, GstMessage * message)
+{
+  GstDlnaSrc *dlna_src = GST_DLNA_SRC (bin);
+  const GstStructure *structure = NULL;
+  const GValue *value = NULL;
+  const GstStructure *headers = NULL;
+  const gchar *name = NULL;
+  gint i = 0;
+
+  if ((GST_MESSAGE_TYPE (message) == GST_MESSAGE_ELEMENT) &&
+      (GST_MESSAGE_SRC (message) == GST_OBJECT (dlna_src->http_src))) {
+    structure = gst_message_get_structure (message);
+
+    if ((structure != NULL) &&
+        gst_structure_has_name (structure, "http-headers") &&
+        ((value = gst_structure_get_value (structure,
+                    "response-headers")) != NULL) &&
+        GST_VALUE_HOLDS_STRUCTURE (value)) {
+      headers = gst_value_get_structure (value);
+
+      // Header names are as sent by server, compare ignoring case
+      for (i = 0; i < gst_structure_n_fields (headers); i++) {
+        name = gst_structure_nth_field_name (headers, i);
+        if (g_ascii_strcasecmp (name,
+                HEAD_RESPONSE_HEADERS[HEADER_INDEX_TIMESEEKRANGE]) == 0)
+          dlna_src_update_time_segment (dlna_src,
+              gst_structure_get_string (headers, name));
+        else if (g_ascii_strcasecmp (name, "Content-Range.dtcp.com") == 0)
+          dlna_src_update_clear_text_segment (dlna_src,
+              gst_structure_get_string (headers, name));
+      }
+    }
+  }
+
+  GST_BIN_CLASS (parent_class)->handle_message (bin, message);
+}
+
 /**
  * Responds to a duration query by returning the size of content/stream
  *
@@ -665,6 +1894,8 @@ dlna_src_handle_query_duration (GstDlnaSrc * dlna_src, GstQuery * query)
   gboolean ret = FALSE;
   gint64 duration = 0;
   GstFormat format;
+  guint64 edge_time = 0;
+  guint64 edge_bytes = 0;
 
   GST_LOG_OBJECT (dlna_src, "Called");
 
@@ -677,6 +1908,18 @@ dlna_src_handle_query_duration (GstDlnaSrc * dlna_src, GstQuery * query)
   // Parse query to see what format was requested
   gst_query_parse_duration (query, &format, &duration);
 
+  // Growing content ends at its extrapolated live edge
+  if (((format == GST_FORMAT_TIME) || (format == GST_FORMAT_BYTES)) &&
+      dlna_src_live_edge_get (dlna_src, &edge_time, &edge_bytes)) {
+    gst_query_set_duration (query, format,
+        (format == GST_FORMAT_TIME) ? edge_time : edge_bytes);
+
+    GST_DEBUG_OBJECT (dlna_src, "Duration in %s at live edge: %"
+        G_GUINT64_FORMAT, gst_format_get_name (format),
+        (format == GST_FORMAT_TIME) ? edge_time : edge_bytes);
+    return TRUE;
+  }
+
   if (format == GST_FORMAT_BYTES) {
     // Total duration of stream available?, report this if it is known
     if ((dlna_src->server_info->content_features != NULL) &&
@@ -746,6 +1989,8 @@ dlna_src_handle_query_seeking (GstDlnaSrc * dlna_src, GstQuery * query)
   gboolean supports_seeking = FALSE;
   gint64 seek_start = 0;
   gint64 seek_end = 0;
+  guint64 range_start = 0;
+  guint64 range_end = 0;
 
   GST_DEBUG_OBJECT (dlna_src, "Called");
 
@@ -759,6 +2004,17 @@ dlna_src_handle_query_seeking (GstDlnaSrc * dlna_src, GstQuery * query)
   gst_query_parse_seeking (query, &format, &supports_seeking, &seek_start,
       &seek_end);
 
+  // Limited operation content can only be seeked within available window
+  if (dlna_src_get_available_seek_range (dlna_src, format, &range_start,
+          &range_end)) {
+    gst_query_set_seeking (query, format, TRUE, range_start, range_end);
+
+    GST_DEBUG_OBJECT (dlna_src, "Seeks in %s limited to available range, "
+        "start %" G_GUINT64_FORMAT ", end %" G_GUINT64_FORMAT,
+        gst_format_get_name (format), range_start, range_end);
+    return TRUE;
+  }
+
   if ((format == GST_FORMAT_BYTES) || (format == GST_FORMAT_DEFAULT)) {
     // Check for DTCP encrypted content
     if ((dlna_src->server_info->content_features != NULL) &&
@@ -969,11 +2225,8 @@ dlna_src_handle_query_convert (GstDlnaSrc * dlna_src, GstQuery * query)
 
   GST_LOG_OBJECT (dlna_src, "Called");
 
-  // Make sure a URI has been set and HEAD response received and server
-  // supports time seek so conversion can be performed
-  if ((dlna_src->uri == NULL) || (dlna_src->server_info == NULL) ||
-      (dlna_src->server_info->content_features == NULL) ||
-      (!dlna_src->server_info->time_seek_response_received)) {
+  // Make sure a URI has been set and HEAD response received
+  if ((dlna_src->uri == NULL) || (dlna_src->server_info == NULL)) {
     GST_INFO_OBJECT (dlna_src, "Not enough info to handle conversion query");
     return FALSE;
   }
@@ -987,6 +2240,21 @@ dlna_src_handle_query_convert (GstDlnaSrc * dlna_src, GstQuery * query)
       gst_format_get_name (src_fmt),
       gst_format_get_name (dest_fmt), src_val, dest_val);
 
+  // Conversions which follow from HEAD response or seek index need no request
+  if (dlna_src_convert_known (dlna_src, src_fmt, src_val, dest_fmt,
+          &dest_val)) {
+    GST_DEBUG_OBJECT (dlna_src, "Converted without request into %"
+        G_GINT64_FORMAT, dest_val);
+    gst_query_set_convert (query, src_fmt, src_val, dest_fmt, dest_val);
+    return ret;
+  }
+  // Otherwise server must support time seek so it can convert
+  if ((dlna_src->server_info->content_features == NULL) ||
+      (!dlna_src->server_info->time_seek_response_received)) {
+    GST_INFO_OBJECT (dlna_src, "Not enough info to handle conversion query");
+    return FALSE;
+  }
+
   gint64 start_byte = 0;
   gint64 start_npt = 0;
   if (src_fmt == GST_FORMAT_BYTES) {
@@ -1007,9 +2275,17 @@ dlna_src_handle_query_convert (GstDlnaSrc * dlna_src, GstQuery * query)
     GST_WARNING_OBJECT (dlna_src, "Problems with HEAD request");
     return FALSE;
   }
+  // Remember where server placed time so later conversions need no request
+  if (head_response->time_seek_response_received &&
+      (head_response->byte_seek_end > 0)) {
+    g_mutex_lock (&dlna_src->event_mutex);
+    dlna_src_seek_index_add (dlna_src, head_response->time_seek_npt_start,
+        head_response->byte_seek_start);
+    g_mutex_unlock (&dlna_src->event_mutex);
+  }
   // Get time seek start positions which contain converted value
   if (dest_fmt == GST_FORMAT_BYTES) {
-    dest_val = head_response->time_seek_npt_start;
+    dest_val = head_response->byte_seek_start;
   } else if (dest_fmt == GST_FORMAT_TIME) {
     dest_val = head_response->time_seek_npt_start;
   }
@@ -1022,6 +2298,36 @@ dlna_src_handle_query_convert (GstDlnaSrc * dlna_src, GstQuery * query)
   return ret;
 }
 
+/**
+ * Responds to a scheduling query by reporting push mode and, when the content
+ * can be fetched in byte ranges, pull mode which is served from block cache.
+ *
+ * @param	dlna_src	this element
+ * @param	query		received query to respond to
+ *
+ * @return	true if responded to query, false otherwise
+ */
+static gboolean
+dlna_src_handle_query_scheduling (GstDlnaSrc * dlna_src, GstQuery * query)
+{
+  gboolean pull_supported = dlna_src_is_pull_supported (dlna_src);
+
+  GST_LOG_OBJECT (dlna_src, "Called");
+
+  gst_query_set_scheduling (query,
+      pull_supported ? GST_SCHEDULING_FLAG_SEEKABLE : 0, 1, -1, 0);
+  gst_query_add_scheduling_mode (query, GST_PAD_MODE_PUSH);
+
+  if (pull_supported) {
+    gst_query_add_scheduling_mode (query, GST_PAD_MODE_PULL);
+    GST_DEBUG_OBJECT (dlna_src, "Pull mode supported for this content item");
+  } else {
+    GST_DEBUG_OBJECT (dlna_src, "Only push mode supported for content item");
+  }
+
+  return TRUE;
+}
+
 /**
  * Perform action necessary when seek event is received
  *
@@ -1070,39 +2376,310 @@ dlna_src_handle_event_seek (GstDlnaSrc * dlna_src, GstPad * pad,
 
     return TRUE;
   }
+  // More seeks are likely to follow, have connection ready for them if they
+  // are served over connections of this element.  Souphttpsrc can't be
+  // handed a connection, it connects on its own for push mode transfers
+  if (dlna_src->pull_mode || ((rate < 0) &&
+          dlna_src_is_reverse_emulated (dlna_src, rate)) ||
+      ((rate != 1.0) && dlna_src_is_trick_emulated (dlna_src, rate)) ||
+      dlna_src_is_rate_switch_seamless (dlna_src, rate, flags, start))
+    dlna_src_warm_socket_prepare (dlna_src);
+
+  // Seeks are issued right away unless scheduler coalesces them
+  if (dlna_src->seek_window == 0)
+    return dlna_src_perform_seek (dlna_src, event);
+
+  return dlna_src_schedule_seek (dlna_src, event);
+}
+
+/**
+ * Issues the request necessary to move to the position and rate of supplied
+ * seek event, which has already been validated.
+ *
+ * @param dlna_src		this element
+ * @param seek_event	seek event to perform
+ *
+ * @return	true if seek was performed, false if it needs to be passed on to
+ *          souphttpsrc
+ */
+static gboolean
+dlna_src_perform_seek (GstDlnaSrc * dlna_src, GstEvent * event)
+{
+  gdouble rate;
+  GstFormat format;
+  GstSeekFlags flags;
+  GstSeekType start_type;
+  gint64 start;
+  GstSeekType stop_type;
+  gint64 stop;
+
+  gst_event_parse_seek (event, &rate, &format, &flags, &start_type, &start,
+      &stop_type, &stop);
+
+  GST_INFO_OBJECT (dlna_src, "Performing seek: rate: %3.1f, format: %s, "
+      "start: %" G_GINT64_FORMAT ", stop: %" G_GINT64_FORMAT, rate,
+      gst_format_get_name (format), start, stop);
+
+  g_mutex_lock (&dlna_src->seek_mutex);
+  dlna_src->seeks_issued++;
+  g_mutex_unlock (&dlna_src->seek_mutex);
+
+  // Rate change keeps current transfer flowing until new one is ready
+  if (dlna_src_is_rate_switch_seamless (dlna_src, rate, flags, start) &&
+      dlna_src_rate_switch_start (dlna_src, rate, format, start,
+          gst_event_get_seqnum (event))) {
+    dlna_src->requested_rate = rate;
+    dlna_src->requested_format = format;
+    dlna_src->requested_start = start;
+    dlna_src->requested_stop = -1;
+    return TRUE;
+  }
+  // Any other seek ends key frames being fetched for an emulated rate and
+  // transfers opened for a rate switch
+  dlna_src_trick_stop (dlna_src, TRUE);
+  dlna_src_rate_switch_stop (dlna_src, TRUE);
+
   // *TODO* - is this needed here??? Assign play rate to supplied rate
   dlna_src->rate = rate;
 
+  if ((stop_type == GST_SEEK_TYPE_NONE) || (stop < 0))
+    stop = -1;
+
   // Set up new requested values
   dlna_src->requested_rate = rate;
   dlna_src->requested_format = format;
   dlna_src->requested_start = start;
   dlna_src->requested_stop = stop;
 
-  if (dlna_src->requested_rate != 1.0) {
-    // Create necessary extra headers for http src so change can be requested
-    GstStructure *extra_headers_struct = NULL;
+  // Ranges are served from cache when downstream pulls
+  if (dlna_src->pull_mode) {
+    GST_DEBUG_OBJECT (dlna_src, "In pull mode, passing seek on");
+    return FALSE;
+  }
+  // Let souphttpsrc perform open ended byte seeks at normal rate, time seeks
+  // are always issued by this element using TimeSeekRange and byte seeks
+  // into protected content using Range.dtcp.com.  Once this element has set
+  // range headers of its own it issues all seeks so ranges do not conflict
+  if ((stop == -1) && (rate == 1.0) && (format == GST_FORMAT_BYTES) &&
+      !dlna_src_is_link_protected (dlna_src) && !dlna_src->range_headers_set) {
+    g_mutex_lock (&dlna_src->event_mutex);
+    dlna_src->segment_pending = FALSE;
+    dlna_src->byte_offset = 0;
+    dlna_src->offsets_known = TRUE;
+    dlna_src_ts_sync_reset (dlna_src, TRUE);
+    g_mutex_unlock (&dlna_src->event_mutex);
 
-    if (!dlna_src_formulate_extra_headers (dlna_src, dlna_src->requested_rate,
-            dlna_src->requested_format,
-            dlna_src->requested_start, &extra_headers_struct)) {
-      GST_ERROR_OBJECT (dlna_src, "Problem formulating extra headers");
-      // Returning true to prevent further processing
-      return TRUE;
+    GST_DEBUG_OBJECT (dlna_src,
+        "returning false to make sure souphttpsrc gets chance to process");
+    return FALSE;
+  }
+  // Rates server does not support are emulated from key frames
+  if ((rate != 1.0) && dlna_src_is_trick_emulated (dlna_src, rate)) {
+    if (!dlna_src_trick_start (dlna_src, rate, format, start,
+            gst_event_get_seqnum (event)))
+      GST_ERROR_OBJECT (dlna_src, "Problem starting trick mode emulation");
+    return TRUE;
+  }
+  // and reverse rates by fetching chunks backwards
+  if ((rate < 0) && dlna_src_is_reverse_emulated (dlna_src, rate)) {
+    if (!dlna_src_reverse_start (dlna_src, rate, format, start,
+            gst_event_get_seqnum (event)))
+      GST_ERROR_OBJECT (dlna_src, "Problem starting reverse playback");
+    return TRUE;
+  }
+  // Time based positions must be expressed in bytes if server has no time
+  // seek support, use byte totals from HEAD response to convert
+  if ((format == GST_FORMAT_TIME) &&
+      ((dlna_src->server_info->content_features == NULL) ||
+          (!dlna_src->server_info->content_features->op_time_seek_supported))) {
+    guint64 start_byte = 0;
+    guint64 stop_byte = -1;
+
+    if (!dlna_src_time_to_bytes (dlna_src, start, FALSE, &start_byte) ||
+        ((stop != -1) &&
+            !dlna_src_time_to_bytes (dlna_src, stop, TRUE, &stop_byte))) {
+      GST_INFO_OBJECT (dlna_src,
+          "Unable to convert time seek to bytes, passing seek on");
+      return FALSE;
+    }
+    format = GST_FORMAT_BYTES;
+    start = start_byte;
+    stop = stop_byte;
+  }
+  // Issue bounded request with range headers formulated by this element
+  if (!dlna_src_restart_transfer (dlna_src, rate, format, start, stop, flags,
+          gst_event_get_seqnum (event))) {
+    GST_ERROR_OBJECT (dlna_src, "Problem restarting transfer for seek");
+    // Returning true to prevent further processing
+    return TRUE;
+  }
+
+  return TRUE;
+}
+
+/**
+ * Issues seek right away if no other seek has been issued within seek window,
+ * so a single seek is performed synchronously.  Seeks arriving within window
+ * of the previous one are handed over to scheduler thread, replacing each
+ * other so only the latest one is issued once window expires.  Transfer of a
+ * target which has been superseded is aborted immediately by flushing, flush
+ * is stopped again by scheduler before it issues the latest seek.
+ *
+ * @param dlna_src		this element
+ * @param seek_event	validated seek event, reference is taken if scheduled
+ *
+ * @return	true if seek was performed or scheduled, false if it needs to be
+ *          passed on to souphttpsrc
+ */
+static gboolean
+dlna_src_schedule_seek (GstDlnaSrc * dlna_src, GstEvent * event)
+{
+  GstSeekFlags flags;
+  gboolean abort_transfer = FALSE;
+  GstEvent *flush_event = NULL;
+  gint64 now = g_get_monotonic_time ();
+
+  gst_event_parse_seek (event, NULL, NULL, &flags, NULL, NULL, NULL, NULL);
+
+  g_mutex_lock (&dlna_src->seek_mutex);
+
+  // Seek which does not follow another one closely starts a new window
+  if ((now >= dlna_src->seek_window_end) && (dlna_src->seek_pending == NULL)) {
+    dlna_src->seek_window_end =
+        now + dlna_src->seek_window * G_TIME_SPAN_MILLISECOND;
+    g_mutex_unlock (&dlna_src->seek_mutex);
+
+    return dlna_src_perform_seek (dlna_src, event);
+  }
+
+  if (dlna_src->seek_thread == NULL) {
+    dlna_src->seek_thread = g_thread_try_new ("dlnasrc-seek",
+        dlna_src_seek_thread, dlna_src, NULL);
+    if (dlna_src->seek_thread == NULL) {
+      g_mutex_unlock (&dlna_src->seek_mutex);
+      GST_WARNING_OBJECT (dlna_src, "Unable to start seek scheduler thread");
+      return dlna_src_perform_seek (dlna_src, event);
     }
-    // Convert structure to GValue in order to set property
-    GValue struct_value = G_VALUE_INIT;
-    g_value_init (&struct_value, GST_TYPE_STRUCTURE);
-    gst_value_set_structure (&struct_value, extra_headers_struct);
-    g_object_set_property (G_OBJECT (dlna_src->http_src), "extra-headers",
-        &struct_value);
+  }
 
-    gst_structure_free (extra_headers_struct);
+  if (dlna_src->seek_pending != NULL) {
+    GST_DEBUG_OBJECT (dlna_src, "Dropping seek superseded by newer one");
+    gst_event_unref (dlna_src->seek_pending);
+    dlna_src->seeks_dropped++;
+  }
+  // Data of seek issued within window is no longer wanted
+  if ((flags & GST_SEEK_FLAG_FLUSH) && !dlna_src->seek_flushing) {
+    dlna_src->seek_flushing = TRUE;
+    dlna_src->seek_flush_seqnum = gst_event_get_seqnum (event);
+    abort_transfer = TRUE;
   }
 
-  GST_DEBUG_OBJECT (dlna_src,
-      "returning false to make sure souphttpsrc gets chance to process");
-  return FALSE;
+  dlna_src->seek_pending = gst_event_ref (event);
+  g_cond_signal (&dlna_src->seek_cond);
+
+  g_mutex_unlock (&dlna_src->seek_mutex);
+
+  if (abort_transfer) {
+    GST_DEBUG_OBJECT (dlna_src, "Aborting transfer of superseded seek");
+    flush_event = gst_event_new_flush_start ();
+    gst_event_set_seqnum (flush_event, gst_event_get_seqnum (event));
+    dlna_src_push_flush (dlna_src, flush_event);
+  }
+
+  return TRUE;
+}
+
+/**
+ * Discards seek not yet issued by scheduler, stopping flush started when it
+ * superseded the transfer of a previous seek.
+ *
+ * @param dlna_src		this element
+ */
+static void
+dlna_src_seek_discard_pending (GstDlnaSrc * dlna_src)
+{
+  GstEvent *flush_event = NULL;
+  gboolean flushing = FALSE;
+  guint32 seqnum = 0;
+
+  g_mutex_lock (&dlna_src->seek_mutex);
+  if (dlna_src->seek_pending != NULL) {
+    gst_event_unref (dlna_src->seek_pending);
+    dlna_src->seek_pending = NULL;
+  }
+  flushing = dlna_src->seek_flushing;
+  seqnum = dlna_src->seek_flush_seqnum;
+  dlna_src->seek_flushing = FALSE;
+  g_mutex_unlock (&dlna_src->seek_mutex);
+
+  if (flushing) {
+    flush_event = gst_event_new_flush_stop (TRUE);
+    gst_event_set_seqnum (flush_event, seqnum);
+    dlna_src_push_flush (dlna_src, flush_event);
+  }
+}
+
+/**
+ * Thread which issues seeks handed over by scheduler, issuing at most one
+ * seek per seek window.
+ *
+ * @param data	this element
+ *
+ * @return	NULL
+ */
+static gpointer
+dlna_src_seek_thread (gpointer data)
+{
+  GstDlnaSrc *dlna_src = GST_DLNA_SRC (data);
+  GstEvent *event = NULL;
+  GstEvent *flush_event = NULL;
+  gboolean flushing = FALSE;
+  guint32 flush_seqnum = 0;
+  gint64 now = 0;
+
+  g_mutex_lock (&dlna_src->seek_mutex);
+
+  while (!dlna_src->seek_thread_stop) {
+    if (dlna_src->seek_pending == NULL) {
+      g_cond_wait (&dlna_src->seek_cond, &dlna_src->seek_mutex);
+      continue;
+    }
+
+    now = g_get_monotonic_time ();
+    if (now < dlna_src->seek_window_end) {
+      g_cond_wait_until (&dlna_src->seek_cond, &dlna_src->seek_mutex,
+          dlna_src->seek_window_end);
+      continue;
+    }
+
+    event = dlna_src->seek_pending;
+    dlna_src->seek_pending = NULL;
+    dlna_src->seek_window_end =
+        now + dlna_src->seek_window * G_TIME_SPAN_MILLISECOND;
+    flushing = dlna_src->seek_flushing;
+    flush_seqnum = dlna_src->seek_flush_seqnum;
+    dlna_src->seek_flushing = FALSE;
+    g_mutex_unlock (&dlna_src->seek_mutex);
+
+    // Flush of aborted transfer ends before seek is issued, whichever way
+    // it is issued flushes again on its own if requested
+    if (flushing) {
+      flush_event = gst_event_new_flush_stop (TRUE);
+      gst_event_set_seqnum (flush_event, flush_seqnum);
+      dlna_src_push_flush (dlna_src, flush_event);
+    }
+
+    if (dlna_src_perform_seek (dlna_src, event))
+      gst_event_unref (event);
+    else
+      gst_pad_event_default (dlna_src->src_pad, GST_OBJECT (dlna_src), event);
+
+    g_mutex_lock (&dlna_src->seek_mutex);
+  }
+
+  g_mutex_unlock (&dlna_src->seek_mutex);
+
+  return NULL;
 }
 
 /**
@@ -1126,16 +2703,45 @@ dlna_src_is_change_valid (GstDlnaSrc * dlna_src, gfloat rate,
     GstFormat format, guint64 start,
     GstSeekType start_type, guint64 stop, GstSeekType stop_type)
 {
+  guint64 range_start = 0;
+  guint64 range_end = 0;
+
   // Check if supplied rate is supported
   if ((rate == 1.0) || (dlna_src_is_rate_supported (dlna_src, rate))) {
     GST_INFO_OBJECT (dlna_src, "New rate of %4.1f is supported by server",
         rate);
+  } else if (dlna_src_is_trick_emulated (dlna_src, rate)) {
+    GST_INFO_OBJECT (dlna_src, "New rate of %4.1f is emulated", rate);
+  } else if (dlna_src_is_reverse_emulated (dlna_src, rate)) {
+    GST_INFO_OBJECT (dlna_src, "New rate of %4.1f is emulated", rate);
+
+    // Chunks are fetched by byte, so time must be converted
+    if ((format == GST_FORMAT_TIME) && (start_type != GST_SEEK_TYPE_NONE) &&
+        ((gint64) start >= 0) &&
+        !dlna_src_time_to_bytes (dlna_src, start, TRUE, &range_start)) {
+      GST_WARNING_OBJECT (dlna_src, "Unable to convert start %"
+          GST_TIME_FORMAT " to bytes for reverse playback",
+          GST_TIME_ARGS (start));
+      return FALSE;
+    }
   } else {
     GST_WARNING_OBJECT (dlna_src, "Rate of %4.1f is not supported by server",
         rate);
     return FALSE;
   }
 
+  // Seeks outside of window announced for limited operation content would
+  // only be refused by server, those within it are checked further below
+  if ((start_type != GST_SEEK_TYPE_NONE) &&
+      dlna_src_get_available_seek_range (dlna_src, format, &range_start,
+          &range_end) && ((start < range_start) || (start > range_end))) {
+    GST_WARNING_OBJECT (dlna_src, "Specified start %" G_GUINT64_FORMAT
+        " is outside of available %s range %" G_GUINT64_FORMAT " to %"
+        G_GUINT64_FORMAT, start, gst_format_get_name (format), range_start,
+        range_end);
+    return FALSE;
+  }
+
   // Check if supplied start is valid
   if (format == GST_FORMAT_BYTES) {
     // Check for encrypted content
@@ -1239,6 +2845,60 @@ dlna_src_is_change_valid (GstDlnaSrc * dlna_src, gfloat rate,
   return TRUE;
 }
 
+/**
+ * Returns window which can currently be seeked for limited operation content,
+ * as announced in availableSeekRange header of HEAD response for a format
+ * whose lop flag is set.  Byte window is not used for link protected content,
+ * which is seeked in cleartext bytes.
+ *
+ * @param	dlna_src	this element
+ * @param	format		format of window, either bytes or time
+ * @param	start		start of window
+ * @param	end			end of window
+ *
+ * @return	true if window is known, false otherwise
+ */
+static gboolean
+dlna_src_get_available_seek_range (GstDlnaSrc * dlna_src, GstFormat format,
+    guint64 * start, guint64 * end)
+{
+  GstDlnaSrcHeadResponse *info = dlna_src->server_info;
+  gboolean found = FALSE;
+  guint64 edge_time = 0;
+  guint64 edge_bytes = 0;
+
+  if (info == NULL)
+    return FALSE;
+
+  // Window only applies if content is flagged for limited operation in format
+  if ((format == GST_FORMAT_TIME) && info->available_seek_npt_received &&
+      (info->content_features != NULL) &&
+      info->content_features->flag_limited_time_seek_set) {
+    *start = info->available_seek_npt_start;
+    *end = info->available_seek_npt_end;
+    found = TRUE;
+  } else if ((format == GST_FORMAT_BYTES) &&
+      info->available_seek_bytes_received &&
+      (info->content_features != NULL) &&
+      info->content_features->flag_limited_byte_seek_set &&
+      !dlna_src_is_link_protected (dlna_src)) {
+    *start = info->available_seek_byte_start;
+    *end = info->available_seek_byte_end;
+    found = TRUE;
+  }
+  // Window of growing content extends to its extrapolated live edge
+  if (((format == GST_FORMAT_TIME) || !dlna_src_is_link_protected (dlna_src))
+      && dlna_src_live_edge_get (dlna_src, &edge_time, &edge_bytes)) {
+    if (!found)
+      *start = ((format == GST_FORMAT_TIME) &&
+          info->time_seek_response_received) ? info->time_seek_npt_start : 0;
+    *end = MAX (found ? *end : 0,
+        (format == GST_FORMAT_TIME) ? edge_time : edge_bytes);
+    found = TRUE;
+  }
+  return found;
+}
+
 /**
  * Determines if current rate is supported by server based on current
  * URI and HEAD response.
@@ -1276,47 +2936,30 @@ dlna_src_is_rate_supported (GstDlnaSrc * dlna_src, gfloat rate)
 
 /**
  * Create extra headers to supply to soup http src based on requested starting
- * postion and rate.
+ * and stopping postions and rate.
  *
  * @param	dlna_src 	this element
  * @param	rate		requested rate to include in playspeed header
  * @param	format		create either time or byte based seek header
  * @param	start		starting position to include, will be either bytes or time depending on format
+ * @param	stop		stopping position to include, -1 if open ended
  * @param	headers		extra headers structure to populate with results
  *
  * @return	true if extra headers were successfully created, false otherwise
  */
 static gboolean
 dlna_src_formulate_extra_headers (GstDlnaSrc * dlna_src, gfloat rate,
-    GstFormat format, guint64 start, GstStructure ** headers)
+    GstFormat format, guint64 start, guint64 stop, GstStructure ** headers)
 {
   gchar *ps_field_name = "PlaySpeed.dlna.org";
   gchar *ps_field_value_prefix = "speed=";
   gchar ps_field_value[64] = { 0 };
-
-  // Get string representation of rate
-  int i = 0;
-  char *rateStr = NULL;
-  for (i = 0; i < dlna_src->server_info->content_features->playspeeds_cnt; i++) {
-    if (dlna_src->server_info->content_features->playspeeds[i] == rate) {
-      rateStr = dlna_src->server_info->content_features->playspeed_strs[i];
-      break;
-    }
-  }
-
-  if (rateStr == NULL) {
-    GST_ERROR_OBJECT (dlna_src,
-        "Unable to get string representation of rate: %lf", rate);
-    return FALSE;
-  }
-
-  g_snprintf ((gchar *) & ps_field_value[0], 64, "%s%s", ps_field_value_prefix,
-      rateStr);
-  GST_INFO_OBJECT (dlna_src, "Set playspeed header value: %s", ps_field_value);
+  gchar range_field_value[64] = { 0 };
+  gchar start_str[32] = { 0 };
+  gchar stop_str[32] = { 0 };
 
   *headers = gst_structure_new ("extraHeadersStruct",
-      "transferMode.dlna.org", G_TYPE_STRING, "Streaming",
-      ps_field_name, G_TYPE_STRING, &ps_field_value, NULL);
+      "transferMode.dlna.org", G_TYPE_STRING, "Streaming", NULL);
 
   if (*headers == NULL) {
     GST_WARNING_OBJECT (dlna_src, "Did not create extra headers structure");
@@ -1325,25 +2968,4996 @@ dlna_src_formulate_extra_headers (GstDlnaSrc * dlna_src, gfloat rate,
     GST_LOG_OBJECT (dlna_src, "Created extra headers structure");
   }
 
+  if (rate != 1.0) {
+    // Get string representation of rate
+    int i = 0;
+    char *rateStr = NULL;
+    for (i = 0; i < dlna_src->server_info->content_features->playspeeds_cnt;
+        i++) {
+      if (dlna_src->server_info->content_features->playspeeds[i] == rate) {
+        rateStr = dlna_src->server_info->content_features->playspeed_strs[i];
+        break;
+      }
+    }
+
+    if (rateStr == NULL) {
+      GST_ERROR_OBJECT (dlna_src,
+          "Unable to get string representation of rate: %lf", rate);
+      gst_structure_free (*headers);
+      *headers = NULL;
+      return FALSE;
+    }
+
+    g_snprintf ((gchar *) & ps_field_value[0], 64, "%s%s",
+        ps_field_value_prefix, rateStr);
+    GST_INFO_OBJECT (dlna_src, "Set playspeed header value: %s",
+        ps_field_value);
+
+    gst_structure_set (*headers, ps_field_name, G_TYPE_STRING,
+        ps_field_value, NULL);
+  }
+  // Bound the request by stop position so no more than needed is sent
+  if (format == GST_FORMAT_TIME) {
+    dlna_src_nanos_to_npt (dlna_src, start, start_str, sizeof (start_str));
+    if (stop != -1)
+      dlna_src_nanos_to_npt (dlna_src, stop, stop_str, sizeof (stop_str));
+
+    g_snprintf (range_field_value, sizeof (range_field_value), "npt=%s-%s",
+        start_str, stop_str);
+    gst_structure_set (*headers, "TimeSeekRange.dlna.org", G_TYPE_STRING,
+        range_field_value, NULL);
+  } else {
+    if (stop != -1)
+      g_snprintf (stop_str, sizeof (stop_str), "%" G_GUINT64_FORMAT, stop);
+
+    g_snprintf (range_field_value, sizeof (range_field_value),
+        "bytes=%" G_GUINT64_FORMAT "-%s", start, stop_str);
+
+    // Encrypted byte positions are unknown, protected content is requested
+    // using cleartext byte positions
+    gst_structure_set (*headers, dlna_src_is_link_protected (dlna_src) ?
+        "Range.dtcp.com" : "Range", G_TYPE_STRING, range_field_value, NULL);
+  }
+  GST_INFO_OBJECT (dlna_src, "Set range header value: %s", range_field_value);
+
   return TRUE;
 }
 
-
-/*********************************************/
-/**********                         **********/
-/********** GstUriHandler INTERFACE **********/
-/**********                         **********/
-/*********************************************/
-static guint
-gst_dlna_src_uri_get_type (GType type)
+/**
+ * Sets range and playspeed headers souphttpsrc sends along with its requests,
+ * or clears them.  Headers stay in effect for every later request, so once
+ * they are set this element issues all seeks itself rather than letting
+ * souphttpsrc add its own Range header next to a stale range.
+ *
+ * @param	dlna_src	this element
+ * @param	headers		extra headers, freed once set, NULL to clear them
+ */
+static void
+dlna_src_set_range_headers (GstDlnaSrc * dlna_src, GstStructure * headers)
 {
-  return GST_URI_SRC;
+  g_object_set (G_OBJECT (dlna_src->http_src), "extra-headers", headers, NULL);
+  dlna_src->range_headers_set = (headers != NULL);
+
+  if (headers != NULL)
+    gst_structure_free (headers);
 }
 
-static const gchar *const *
-gst_dlna_src_uri_get_protocols (GType type)
-{
-  static const gchar *protocols[] = { "http", "https", NULL };
+/**
+ * Restarts transfer of content by souphttpsrc using range and playspeed
+ * headers formulated by this element.  Since souphttpsrc is restarted from
+ * READY it issues no range header of its own, the segment it sends is
+ * replaced by the requested one in src pad probe.
+ *
+ * @param	dlna_src	this element
+ * @param	rate		requested rate
+ * @param	format		format of start and stop, either bytes or time
+ * @param	start		starting position
+ * @param	stop		stopping position, -1 if open ended
+ * @param	flags		flags of seek which requested the change
+ * @param	seqnum		sequence number of seek which requested the change
+ *
+ * @return	true if transfer was restarted, false otherwise
+ */
+static gboolean
+dlna_src_restart_transfer (GstDlnaSrc * dlna_src, gdouble rate,
+    GstFormat format, guint64 start, guint64 stop, GstSeekFlags flags,
+    guint32 seqnum)
+{
+  GstStructure *extra_headers_struct = NULL;
+  GstEvent *flush_event = NULL;
+  gboolean pcp_known = FALSE;
+  guint64 pcp_clear_offset = 0;
+  guint64 pcp_encrypted_offset = G_MAXUINT64;
+  guint64 range_stop = stop;
+
+  GST_INFO_OBJECT (dlna_src, "Restarting transfer, rate: %3.1f, format: %s, "
+      "start: %" G_GUINT64_FORMAT ", stop: %" G_GINT64_FORMAT, rate,
+      gst_format_get_name (format), start, (gint64) stop);
+
+  // Server starts a cleartext byte seek at the packet containing requested
+  // byte, start there if packet is known so segment matches data sent
+  if ((format == GST_FORMAT_BYTES) && dlna_src_is_link_protected (dlna_src)) {
+    pcp_known = dlna_src_pcp_map_align (dlna_src, start, &pcp_clear_offset,
+        &pcp_encrypted_offset);
+    if (pcp_known) {
+      GST_INFO_OBJECT (dlna_src, "Aligned start byte %" G_GUINT64_FORMAT
+          " to protected content packet at %" G_GUINT64_FORMAT, start,
+          pcp_clear_offset);
+      start = pcp_clear_offset;
+    }
+  } else if ((format == GST_FORMAT_BYTES) && (dlna_src->ts_packet_size > 0) &&
+      (start % dlna_src->ts_packet_size != 0)) {
+    // Transport stream packets are aligned on packet size
+    GST_INFO_OBJECT (dlna_src, "Aligned start byte %" G_GUINT64_FORMAT
+        " to transport stream packet at %" G_GUINT64_FORMAT, start,
+        start - start % dlna_src->ts_packet_size);
+    start -= start % dlna_src->ts_packet_size;
+  }
+
+  // Segment stop is exclusive while last byte of a Range is inclusive
+  if ((format == GST_FORMAT_BYTES) && (stop != -1) && (stop > start))
+    range_stop = stop - 1;
+
+  // Create necessary extra headers for http src so change can be requested,
+  // before flushing so that failing leaves data flow untouched.  Every path
+  // after flush start below sends flush stop
+  if (!dlna_src_formulate_extra_headers (dlna_src, rate, format, start,
+          range_stop, &extra_headers_struct)) {
+    GST_ERROR_OBJECT (dlna_src, "Problem formulating extra headers");
+    return FALSE;
+  }
+
+  if (flags & GST_SEEK_FLAG_FLUSH) {
+    flush_event = gst_event_new_flush_start ();
+    gst_event_set_seqnum (flush_event, seqnum);
+    dlna_src_push_flush (dlna_src, flush_event);
+  }
+  // Stop current transfer.  Souphttpsrc drops its session when stopped, so
+  // the connection is not kept alive across restarts.  A seek event would
+  // keep it, but souphttpsrc then adds a Range header of its own and ignores
+  // seeks to its current position, neither works with TimeSeekRange
+  gst_element_set_state (dlna_src->http_src, GST_STATE_READY);
+  dlna_src_set_range_headers (dlna_src, extra_headers_struct);
+
+  // Otherwise position of first packet is learned from response headers
+  dlna_src_pcp_reset (dlna_src, pcp_known, pcp_clear_offset,
+      pcp_encrypted_offset);
+
+  // Segment which is sent along with data of new transfer
+  g_mutex_lock (&dlna_src->event_mutex);
+  gst_segment_init (&dlna_src->segment, format);
+  dlna_src->segment.rate = rate;
+  dlna_src->segment.start = start;
+  dlna_src->segment.stop = stop;
+  dlna_src->segment.time = start;
+  // Reverse playback proceeds from stop towards start
+  dlna_src->segment.position = ((rate < 0) && (stop != -1)) ? stop : start;
+  dlna_src->segment_seqnum = seqnum;
+  dlna_src->segment_pending = TRUE;
+  dlna_src->byte_offset = (format == GST_FORMAT_BYTES) ? start : 0;
+  dlna_src->offsets_known = (format == GST_FORMAT_BYTES);
+  dlna_src_ts_sync_reset (dlna_src, TRUE);
+  dlna_src->last_pushed_offset = GST_BUFFER_OFFSET_NONE;
+  dlna_src->last_pushed_time = GST_CLOCK_TIME_NONE;
+  dlna_src->live_pcr_anchored = FALSE;
+  dlna_src->live_pcr_pid = -1;
+  dlna_src->live_join_lag = 0;
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  if (flags & GST_SEEK_FLAG_FLUSH) {
+    flush_event = gst_event_new_flush_stop (TRUE);
+    gst_event_set_seqnum (flush_event, seqnum);
+    dlna_src_push_flush (dlna_src, flush_event);
+  }
+  // Start new transfer
+  if (!gst_element_sync_state_with_parent (dlna_src->http_src)) {
+    GST_ERROR_OBJECT (dlna_src, "Unable to restart http src");
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+ * Sends flush event to peer of souphttpsrc src pad so that data queued within
+ * this bin is flushed along with data downstream.  Event is sent to the peer
+ * rather than pushed since souphttpsrc pad is inactive while it is stopped.
+ *
+ * @param	dlna_src	this element
+ * @param	event		flush start or flush stop event to send
+ */
+static void
+dlna_src_push_flush (GstDlnaSrc * dlna_src, GstEvent * event)
+{
+  GstPad *pad = gst_element_get_static_pad (dlna_src->http_src, "src");
+  GstPad *peer = NULL;
+
+  if (pad != NULL) {
+    peer = gst_pad_get_peer (pad);
+    gst_object_unref (pad);
+  }
+  if (peer == NULL) {
+    GST_WARNING_OBJECT (dlna_src, "Http src pad is not linked, unable to flush");
+    gst_event_unref (event);
+    return;
+  }
+  gst_pad_send_event (peer, event);
+  gst_object_unref (peer);
+}
+
+/**
+ * Probe on src pad which replaces segment sent by souphttpsrc after transfer
+ * has been restarted by this element and offsets buffers accordingly.
+ *
+ * @param	pad			src pad of this element
+ * @param	info		buffer or event passing through pad
+ * @param	user_data	this element
+ *
+ * @return	GST_PAD_PROBE_OK, GST_PAD_PROBE_DROP for data preceding first
+ * 			transport stream packet of restarted transfer
+ */
+static GstPadProbeReturn
+dlna_src_src_pad_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  GstDlnaSrc *dlna_src = GST_DLNA_SRC (user_data);
+  GstEvent *event = NULL;
+  GstBuffer *buf = NULL;
+  gboolean resynced = FALSE;
+  gboolean caught_up = FALSE;
+
+  // Transfer switched over from by a rate switch is no longer passed on
+  if (dlna_src_rate_switch_take_over (dlna_src, info))
+    return GST_PAD_PROBE_DROP;
+
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+    buf = GST_PAD_PROBE_INFO_BUFFER (info);
+
+    // Prefetched data precedes first buffer transferred by souphttpsrc
+    if ((dlna_src->prefetch_buffer != NULL) && !dlna_src->prefetch_pushing &&
+        dlna_src_prefetch_push (dlna_src, pad)) {
+      buf = gst_buffer_make_writable (buf);
+      GST_BUFFER_FLAG_UNSET (buf, GST_BUFFER_FLAG_DISCONT);
+      GST_PAD_PROBE_INFO_DATA (info) = buf;
+    }
+
+    g_mutex_lock (&dlna_src->event_mutex);
+    if ((dlna_src->byte_offset > 0) && !dlna_src->prefetch_pushing &&
+        GST_BUFFER_OFFSET_IS_VALID (buf)) {
+      buf = gst_buffer_make_writable (buf);
+      GST_BUFFER_OFFSET (buf) += dlna_src->byte_offset;
+      if (GST_BUFFER_OFFSET_END_IS_VALID (buf))
+        GST_BUFFER_OFFSET_END (buf) += dlna_src->byte_offset;
+      GST_PAD_PROBE_INFO_DATA (info) = buf;
+    }
+    // Live content lagging too far behind live edge is skipped
+    if ((dlna_src->live_latency > 0) && (dlna_src->rate == 1.0)) {
+      if (dlna_src_live_catch_up (dlna_src, buf, &caught_up)) {
+        g_mutex_unlock (&dlna_src->event_mutex);
+        return GST_PAD_PROBE_DROP;
+      }
+      if (caught_up) {
+        buf = gst_buffer_make_writable (buf);
+        GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
+        GST_PAD_PROBE_INFO_DATA (info) = buf;
+      }
+    }
+    // Data of restarted transfer starts with first whole packet
+    if (dlna_src->ts_resync) {
+      buf = dlna_src_ts_resync (dlna_src, buf);
+      if (buf == NULL) {
+        g_mutex_unlock (&dlna_src->event_mutex);
+        return GST_PAD_PROBE_DROP;
+      }
+      resynced = !dlna_src->ts_resync;
+      GST_PAD_PROBE_INFO_DATA (info) = buf;
+    }
+    if ((dlna_src->ts_packet_size > 0) && (dlna_src->rate == 1.0))
+      dlna_src_pcr_scan (dlna_src, buf);
+    if (GST_BUFFER_OFFSET_IS_VALID (buf))
+      dlna_src->last_pushed_offset = GST_BUFFER_OFFSET (buf) +
+          gst_buffer_get_size (buf);
+
+    // Tables seen earlier let decoder start without waiting on next ones
+    if (resynced) {
+      buf = dlna_src_psi_inject (dlna_src, buf);
+      GST_PAD_PROBE_INFO_DATA (info) = buf;
+      dlna_src_keyframe_reset (dlna_src);
+    }
+    // Decoder is spared frames it would drop at high rates
+    if ((dlna_src->ts_packet_size > 0) &&
+        (dlna_src->keyframe_filter_rate > 0.0) &&
+        (ABS (dlna_src->rate) >= dlna_src->keyframe_filter_rate)) {
+      buf = dlna_src_keyframe_filter (dlna_src, buf);
+      if (buf == NULL) {
+        g_mutex_unlock (&dlna_src->event_mutex);
+        return GST_PAD_PROBE_DROP;
+      }
+      GST_PAD_PROBE_INFO_DATA (info) = buf;
+    }
+    g_mutex_unlock (&dlna_src->event_mutex);
+
+  } else if (info->type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+    event = GST_PAD_PROBE_INFO_EVENT (info);
+    if (GST_EVENT_TYPE (event) != GST_EVENT_SEGMENT)
+      return GST_PAD_PROBE_OK;
+
+    g_mutex_lock (&dlna_src->event_mutex);
+    if (dlna_src->segment_pending) {
+      GST_DEBUG_OBJECT (dlna_src, "Replacing segment of restarted transfer");
+
+      gst_event_unref (event);
+      event = gst_event_new_segment (&dlna_src->segment);
+      gst_event_set_seqnum (event, dlna_src->segment_seqnum);
+      GST_PAD_PROBE_INFO_DATA (info) = event;
+
+      dlna_src->segment_pending = FALSE;
+    }
+    g_mutex_unlock (&dlna_src->event_mutex);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+/**
+ * Event function of pad internal to ghost src pad, which forwards events of
+ * element targeted by ghost pad.  If caps of content are known from HEAD
+ * response they are sent right after stream start and replace caps sent by
+ * souphttpsrc or decrypter, so downstream does not need to typefind.
+ *
+ * @param	pad		internal pad of ghost src pad
+ * @param	parent	ghost src pad
+ * @param	event	event sent by targeted element
+ *
+ * @return	true if event was forwarded, false otherwise
+ */
+static gboolean
+dlna_src_internal_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  GstDlnaSrc *dlna_src = GST_DLNA_SRC (GST_OBJECT_PARENT (parent));
+  GstEventType type = GST_EVENT_TYPE (event);
+  GstCaps *caps = NULL;
+  gboolean ret = FALSE;
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  if (dlna_src->caps != NULL)
+    caps = gst_caps_ref (dlna_src->caps);
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  if ((type == GST_EVENT_CAPS) && (caps != NULL)) {
+    gst_event_unref (event);
+    event = gst_event_new_caps (caps);
+  }
+
+  ret = gst_proxy_pad_event_default (pad, parent, event);
+
+  if (ret && (type == GST_EVENT_STREAM_START) && (caps != NULL)) {
+    GST_DEBUG_OBJECT (dlna_src, "Sending caps %" GST_PTR_FORMAT, caps);
+    ret = gst_pad_push_event (GST_PAD (parent), gst_event_new_caps (caps));
+  }
+  // Duration and seek index let demuxers skip probing end of content
+  if (ret && (type == GST_EVENT_STREAM_START)) {
+    event = dlna_src_content_info_event (dlna_src);
+    if (event != NULL)
+      gst_pad_push_event (GST_PAD (parent), event);
+  }
+
+  if (caps != NULL)
+    gst_caps_unref (caps);
+
+  return ret;
+}
+
+/**
+ * Responds to caps query with caps of content if they are known from HEAD
+ * response.
+ *
+ * @param	dlna_src	this element
+ * @param	query		caps query
+ *
+ * @return	true if query was answered, false if caps are unknown
+ */
+static gboolean
+dlna_src_handle_query_caps (GstDlnaSrc * dlna_src, GstQuery * query)
+{
+  GstCaps *filter = NULL;
+  GstCaps *result = NULL;
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  if (dlna_src->caps != NULL)
+    result = gst_caps_ref (dlna_src->caps);
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  if (result == NULL)
+    return FALSE;
+
+  gst_query_parse_caps (query, &filter);
+  if (filter != NULL) {
+    GstCaps *intersection = gst_caps_intersect_full (filter, result,
+        GST_CAPS_INTERSECT_FIRST);
+    gst_caps_unref (result);
+    result = intersection;
+  }
+  gst_query_set_caps_result (query, result);
+  gst_caps_unref (result);
+
+  return TRUE;
+}
+
+/**
+ * Looks up caps mapped to supplied DLNA profile or mime type.
+ *
+ * @param	mappings	table of caps mappings
+ * @param	cnt			number of mappings in table
+ * @param	id			DLNA profile or mime type of content
+ * @param	by_prefix	true if id only needs to start with mapped id
+ *
+ * @return	mapping of id, NULL if id is unknown
+ */
+static const GstDlnaSrcCapsMapping *
+dlna_src_caps_lookup (const GstDlnaSrcCapsMapping * mappings, guint cnt,
+    const gchar * id, gboolean by_prefix)
+{
+  guint i = 0;
+  gsize len = 0;
+
+  if (id == NULL)
+    return NULL;
+
+  // Mime type parameters are not part of mapping
+  len = by_prefix ? strlen (id) : strcspn (id, "; ");
+  for (i = 0; i < cnt; i++) {
+    if (by_prefix && g_str_has_prefix (id, mappings[i].id))
+      return &mappings[i];
+    if (!by_prefix && (strlen (mappings[i].id) == len) &&
+        (g_ascii_strncasecmp (id, mappings[i].id, len) == 0))
+      return &mappings[i];
+  }
+  return NULL;
+}
+
+/**
+ * Determines caps of content from DLNA profile or mime type returned in HEAD
+ * response of current uri.
+ *
+ * @param	dlna_src	this element
+ */
+static void
+dlna_src_update_caps (GstDlnaSrc * dlna_src)
+{
+  const GstDlnaSrcCapsMapping *mapping = NULL;
+  const gchar *profile = NULL;
+  GstCaps *caps = NULL;
+  gint packet_size = TTS_PACKET_SIZE;
+
+  if (dlna_src->server_info != NULL) {
+    if (dlna_src->server_info->content_features != NULL)
+      profile = dlna_src->server_info->content_features->profile;
+    mapping = dlna_src_caps_lookup (PROFILE_CAPS, G_N_ELEMENTS (PROFILE_CAPS),
+        profile, TRUE);
+    if (mapping == NULL)
+      mapping = dlna_src_caps_lookup (MIME_CAPS, G_N_ELEMENTS (MIME_CAPS),
+          dlna_src->server_info->content_type, FALSE);
+  }
+
+  if (mapping != NULL) {
+    caps = gst_caps_from_string (mapping->caps);
+    if (mapping->transport_stream) {
+      if ((profile != NULL) ? g_str_has_suffix (profile, "_ISO") :
+          (g_ascii_strncasecmp (mapping->id, "video/mp2t", 10) == 0))
+        packet_size = TS_PACKET_SIZE;
+      gst_caps_set_simple (caps, "packetsize", G_TYPE_INT, packet_size, NULL);
+    }
+    GST_INFO_OBJECT (dlna_src, "Caps of content: %" GST_PTR_FORMAT, caps);
+  } else {
+    GST_INFO_OBJECT (dlna_src, "Caps of content unknown, needs typefinding");
+  }
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  if (dlna_src->caps != NULL)
+    gst_caps_unref (dlna_src->caps);
+  dlna_src->caps = caps;
+
+  // PCR scan starts over for content of new uri
+  dlna_src->ts_packet_size = ((mapping != NULL) &&
+      mapping->transport_stream) ? packet_size : 0;
+  dlna_src->ts_phase = 0;
+  dlna_src_ts_sync_reset (dlna_src, FALSE);
+  dlna_src->pmt_pid = -1;
+  dlna_src->video_stream_type = 0;
+  dlna_src_keyframe_reset (dlna_src);
+  if (dlna_src->pat_packet != NULL) {
+    gst_buffer_unref (dlna_src->pat_packet);
+    dlna_src->pat_packet = NULL;
+  }
+  if (dlna_src->pmt_packet != NULL) {
+    gst_buffer_unref (dlna_src->pmt_packet);
+    dlna_src->pmt_packet = NULL;
+  }
+  dlna_src->pcr_pid = -1;
+  dlna_src->pcr_base_known = FALSE;
+  dlna_src->pcr_from_start = FALSE;
+  dlna_src->pcr_scan_next = GST_BUFFER_OFFSET_NONE;
+  dlna_src->pcr_last_indexed = GST_CLOCK_TIME_NONE;
+  g_mutex_unlock (&dlna_src->event_mutex);
+}
+
+/**
+ * Creates sticky event which carries duration, size and seek index of
+ * content known from HEAD response downstream.  Demuxers which understand it
+ * can skip probing the end of content for its duration, which costs a
+ * request to the server per probe.
+ *
+ * @param	dlna_src	this element
+ *
+ * @return	newly created event, NULL if nothing is known about content
+ */
+static GstEvent *
+dlna_src_content_info_event (GstDlnaSrc * dlna_src)
+{
+  GstDlnaSrcHeadResponse *info = dlna_src->server_info;
+  GstDlnaSrcSeekAnchor *anchor = NULL;
+  GstStructure *structure = NULL;
+  GValue times = G_VALUE_INIT;
+  GValue offsets = G_VALUE_INIT;
+  GValue value = G_VALUE_INIT;
+  guint i = 0;
+
+  if (info == NULL)
+    return NULL;
+
+  structure = gst_structure_new_empty (GST_DLNA_SRC_CONTENT_INFO);
+  if (info->time_seek_response_received &&
+      (info->time_seek_npt_duration > 0))
+    gst_structure_set (structure, "duration", G_TYPE_UINT64,
+        info->time_seek_npt_duration, NULL);
+  if (info->time_seek_response_received && (info->byte_seek_total > 0))
+    gst_structure_set (structure, "size", G_TYPE_UINT64,
+        info->byte_seek_total, NULL);
+  else if (info->content_length > 0)
+    gst_structure_set (structure, "size", G_TYPE_UINT64,
+        info->content_length, NULL);
+
+  // Seek index as parallel arrays of times and byte offsets
+  g_value_init (&times, GST_TYPE_ARRAY);
+  g_value_init (&offsets, GST_TYPE_ARRAY);
+  g_value_init (&value, G_TYPE_UINT64);
+  g_mutex_lock (&dlna_src->event_mutex);
+  for (i = 0; i < dlna_src->seek_index->len; i++) {
+    anchor = &g_array_index (dlna_src->seek_index, GstDlnaSrcSeekAnchor, i);
+    g_value_set_uint64 (&value, anchor->time);
+    gst_value_array_append_value (&times, &value);
+    g_value_set_uint64 (&value, anchor->offset);
+    gst_value_array_append_value (&offsets, &value);
+  }
+  g_mutex_unlock (&dlna_src->event_mutex);
+  gst_structure_take_value (structure, "index-times", &times);
+  gst_structure_take_value (structure, "index-offsets", &offsets);
+  g_value_unset (&value);
+
+  GST_DEBUG_OBJECT (dlna_src, "Sending content info %" GST_PTR_FORMAT,
+      structure);
+
+  return gst_event_new_custom (GST_EVENT_CUSTOM_DOWNSTREAM_STICKY, structure);
+}
+
+/**
+ * Converts between time and byte positions without asking the server, using
+ * the totals of HEAD response for the end of content and the seek index for
+ * positions in between.
+ *
+ * @param	dlna_src	this element
+ * @param	src_fmt		format of position to convert
+ * @param	src_val		position to convert
+ * @param	dest_fmt	format to convert into
+ * @param	dest_val	returned converted position
+ *
+ * @return	true if position was converted, false if server must be asked
+ */
+static gboolean
+dlna_src_convert_known (GstDlnaSrc * dlna_src, GstFormat src_fmt,
+    gint64 src_val, GstFormat dest_fmt, gint64 * dest_val)
+{
+  GstDlnaSrcHeadResponse *info = dlna_src->server_info;
+  guint64 converted = 0;
+
+  if (src_fmt == dest_fmt) {
+    *dest_val = src_val;
+    return TRUE;
+  }
+  if (src_val < 0)
+    return FALSE;
+
+  if ((src_fmt == GST_FORMAT_TIME) && (dest_fmt == GST_FORMAT_BYTES)) {
+    if ((info->time_seek_npt_duration > 0) && (info->byte_seek_total > 0) &&
+        (src_val >= info->time_seek_npt_duration)) {
+      *dest_val = info->byte_seek_total;
+      return TRUE;
+    }
+    if (dlna_src_seek_index_time_to_bytes (dlna_src, src_val, &converted)) {
+      *dest_val = converted;
+      return TRUE;
+    }
+  } else if ((src_fmt == GST_FORMAT_BYTES) && (dest_fmt == GST_FORMAT_TIME)) {
+    if ((info->time_seek_npt_duration > 0) && (info->byte_seek_total > 0) &&
+        (src_val >= info->byte_seek_total)) {
+      *dest_val = info->time_seek_npt_duration;
+      return TRUE;
+    }
+    if (dlna_src_seek_index_bytes_to_time (dlna_src, src_val, &converted)) {
+      *dest_val = converted;
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/**
+ * Scans transport stream packets of buffer passing src pad for PCRs of a
+ * single program and adds their media time and byte position to the seek
+ * index, so time positions can be converted without asking the server.
+ * Only packets which start and end within buffer are scanned and media time
+ * is counted from the first PCR of content.  PAT and PMT packets are kept
+ * along the way.  Called with event mutex held.
+ *
+ * @param	dlna_src	this element
+ * @param	buf			buffer passing src pad
+ */
+static void
+dlna_src_pcr_scan (GstDlnaSrc * dlna_src, GstBuffer * buf)
+{
+  GstMapInfo map;
+  guint64 offset = GST_BUFFER_OFFSET (buf);
+  guint64 packet_offset = 0;
+  guint64 pcr = 0;
+  GstClockTime time = 0;
+  guint packet_size = dlna_src->ts_packet_size;
+  guint sync = packet_size - TS_PACKET_SIZE;
+  gboolean index_pcr = FALSE;
+  gsize pos = 0;
+  gint pid = -1;
+
+  // Offsets of a transfer started at a time position whose byte is unknown
+  // start at 0 as well, content start can not be told and nothing is indexed
+  if (!dlna_src->offsets_known) {
+    dlna_src->pcr_base_known = FALSE;
+    dlna_src->pcr_from_start = FALSE;
+    dlna_src->pcr_last_indexed = GST_CLOCK_TIME_NONE;
+    dlna_src->pcr_scan_next = GST_BUFFER_OFFSET_NONE;
+    return;
+  }
+  if (!GST_BUFFER_OFFSET_IS_VALID (buf))
+    return;
+
+  // Time of content start is only known if scan has covered it
+  if (offset == 0) {
+    dlna_src->pcr_base_known = FALSE;
+    dlna_src->pcr_from_start = TRUE;
+    dlna_src->pcr_pid = -1;
+  } else if (offset != dlna_src->pcr_scan_next) {
+    dlna_src->pcr_from_start = FALSE;
+    dlna_src->pcr_last_indexed = GST_CLOCK_TIME_NONE;
+  }
+  index_pcr = dlna_src->pcr_base_known || dlna_src->pcr_from_start;
+
+  if (!gst_buffer_map (buf, &map, GST_MAP_READ))
+    return;
+  dlna_src->pcr_scan_next = index_pcr ? offset + map.size :
+      GST_BUFFER_OFFSET_NONE;
+
+  // Packets are aligned on packet size, offset by phase found on resync
+  pos = (packet_size + dlna_src->ts_phase - (offset % packet_size)) %
+      packet_size;
+  for (; pos + packet_size <= map.size; pos += packet_size) {
+    if (map.data[pos + sync] != TS_SYNC_BYTE) {
+      GST_LOG_OBJECT (dlna_src, "Lost packet sync at byte %" G_GUINT64_FORMAT,
+          offset + pos);
+      break;
+    }
+    dlna_src_psi_capture (dlna_src, map.data + pos, packet_size);
+
+    if (!index_pcr || !dlna_src_pcr_parse (map.data + pos + sync, &pcr, &pid))
+      continue;
+    if (dlna_src->pcr_pid == -1)
+      dlna_src->pcr_pid = pid;
+    else if (pid != dlna_src->pcr_pid)
+      continue;
+
+    packet_offset = offset + pos;
+    if (!dlna_src->pcr_base_known) {
+      dlna_src->pcr_base = pcr;
+      dlna_src->pcr_base_known = TRUE;
+    }
+
+    if (pcr < dlna_src->pcr_base)
+      pcr += PCR_WRAP;
+    time = gst_util_uint64_scale (pcr - dlna_src->pcr_base, 1000, 27);
+    dlna_src->last_pushed_time = time;
+
+    if (GST_CLOCK_TIME_IS_VALID (dlna_src->pcr_last_indexed) &&
+        (time >= dlna_src->pcr_last_indexed) &&
+        (time - dlna_src->pcr_last_indexed < PCR_INDEX_INTERVAL))
+      continue;
+
+    GST_LOG_OBJECT (dlna_src, "PCR at byte %" G_GUINT64_FORMAT ", time %"
+        GST_TIME_FORMAT, packet_offset, GST_TIME_ARGS (time));
+    dlna_src_seek_index_add (dlna_src, time, packet_offset);
+    dlna_src->pcr_last_indexed = time;
+  }
+  gst_buffer_unmap (buf, &map);
+}
+
+/**
+ * Extracts PCR from adaptation field of transport stream packet.
+ *
+ * @param	packet	transport stream packet starting with sync byte
+ * @param	pcr		returned PCR in units of 27 MHz
+ * @param	pid		returned PID of packet
+ *
+ * @return	true if packet carries PCR, false otherwise
+ */
+static gboolean
+dlna_src_pcr_parse (const guint8 * packet, guint64 * pcr, gint * pid)
+{
+  guint64 base = 0;
+  guint ext = 0;
+
+  // Adaptation field must be present and long enough to hold PCR
+  if (((packet[3] & 0x20) == 0) || (packet[4] < 7) ||
+      ((packet[5] & 0x10) == 0))
+    return FALSE;
+
+  base = ((guint64) packet[6] << 25) | ((guint64) packet[7] << 17) |
+      ((guint64) packet[8] << 9) | ((guint64) packet[9] << 1) |
+      ((guint64) packet[10] >> 7);
+  ext = ((packet[10] & 0x01) << 8) | packet[11];
+
+  *pcr = base * 300 + ext;
+  *pid = ((packet[1] & 0x1f) << 8) | packet[2];
+
+  return TRUE;
+}
+
+/**
+ * Finds start of first transport stream packet in data.  Candidate sync
+ * bytes are located with memchr, which C libraries vectorize, and must recur
+ * at packet size for TS_SYNC_CONFIRM_CNT packets.  A candidate which data
+ * ends before confirming is not trusted, caller is told where data is to be
+ * kept so it can be searched again along with more data.
+ *
+ * @param	data		data to search
+ * @param	size		size of data
+ * @param	packet_size	size of transport stream packets, sync byte is
+ * 						preceded by timestamp in 192 byte packets
+ * @param	keep		returned offset of data to keep for next search if
+ * 						no packet was found, may be NULL
+ *
+ * @return	offset of first packet, -1 if none was found
+ */
+static gssize
+dlna_src_ts_find_sync (const guint8 * data, gsize size, guint packet_size,
+    gsize * keep)
+{
+  const guint8 *candidate = NULL;
+  gsize sync = packet_size - TS_PACKET_SIZE;
+  gsize from = sync;
+  gsize pos = 0;
+  guint i = 0;
+
+  while (from < size) {
+    candidate = memchr (data + from, TS_SYNC_BYTE, size - from);
+    if (candidate == NULL)
+      break;
+
+    pos = candidate - data;
+    for (i = 1; (i < TS_SYNC_CONFIRM_CNT) && (pos + i * packet_size < size);
+        i++)
+      if (data[pos + i * packet_size] != TS_SYNC_BYTE)
+        break;
+    if (i == TS_SYNC_CONFIRM_CNT)
+      return pos - sync;
+
+    // Later candidates would run out of data as well
+    if (pos + i * packet_size >= size) {
+      if (keep != NULL)
+        *keep = pos - sync;
+      return -1;
+    }
+    from = pos + 1;
+  }
+
+  // Timestamp of a packet whose sync byte is yet to come may end data
+  if (keep != NULL)
+    *keep = (size > sync) ? size - sync : 0;
+  return -1;
+}
+
+/**
+ * Discards tail of data held back while looking for first packet, so that
+ * data of an earlier transfer is not joined to data of a new one.  Called
+ * with event mutex held.
+ *
+ * @param	dlna_src	this element
+ * @param	resync		true if data which follows is to be resynced
+ */
+static void
+dlna_src_ts_sync_reset (GstDlnaSrc * dlna_src, gboolean resync)
+{
+  if (dlna_src->ts_sync_tail != NULL) {
+    gst_buffer_unref (dlna_src->ts_sync_tail);
+    dlna_src->ts_sync_tail = NULL;
+  }
+  dlna_src->ts_resync = resync && (dlna_src->ts_packet_size > 0);
+}
+
+/**
+ * Trims data preceding first transport stream packet from first buffer of a
+ * restarted transfer, since server may start a transfer anywhere within a
+ * packet.  Called with event mutex held.
+ *
+ * @param	dlna_src	this element
+ * @param	buf			buffer passing src pad
+ *
+ * @return	buffer starting with whole packet, NULL if buffer holds no
+ * 			confirmed packet start and is to be dropped by caller, its tail
+ * 			being held back for next buffer
+ */
+static GstBuffer *
+dlna_src_ts_resync (GstDlnaSrc * dlna_src, GstBuffer * buf)
+{
+  GstBuffer *data = gst_buffer_ref (buf);
+  GstBuffer *tail = dlna_src->ts_sync_tail;
+  GstBuffer *trimmed = NULL;
+  GstMapInfo map;
+  gssize skip = -1;
+  gsize keep = 0;
+  gsize size = 0;
+
+  // Data held back from previous buffer is searched along with this one
+  // if it directly precedes it
+  dlna_src->ts_sync_tail = NULL;
+  if (tail != NULL) {
+    if (GST_BUFFER_OFFSET_IS_VALID (buf) &&
+        GST_BUFFER_OFFSET_END_IS_VALID (tail) &&
+        (GST_BUFFER_OFFSET_END (tail) == GST_BUFFER_OFFSET (buf))) {
+      data = gst_buffer_append (tail, data);
+      GST_BUFFER_OFFSET_END (data) = GST_BUFFER_OFFSET_END (buf);
+    } else {
+      gst_buffer_unref (tail);
+    }
+  }
+
+  if (!gst_buffer_map (data, &map, GST_MAP_READ)) {
+    gst_buffer_unref (data);
+    return buf;
+  }
+  skip = dlna_src_ts_find_sync (map.data, map.size, dlna_src->ts_packet_size,
+      &keep);
+  size = map.size;
+  gst_buffer_unmap (data, &map);
+
+  if (skip < 0) {
+    GST_DEBUG_OBJECT (dlna_src, "Holding back %" G_GSIZE_FORMAT " of %"
+        G_GSIZE_FORMAT " bytes without confirmed packet start", size - keep,
+        size);
+    if (keep < size) {
+      tail = gst_buffer_copy_region (data, GST_BUFFER_COPY_MEMORY, keep,
+          size - keep);
+      if (GST_BUFFER_OFFSET_IS_VALID (data)) {
+        GST_BUFFER_OFFSET (tail) = GST_BUFFER_OFFSET (data) + keep;
+        GST_BUFFER_OFFSET_END (tail) = GST_BUFFER_OFFSET (data) + size;
+      }
+      dlna_src->ts_sync_tail = tail;
+    }
+    gst_buffer_unref (data);
+    return NULL;
+  }
+
+  gst_buffer_unref (buf);
+  dlna_src->ts_resync = FALSE;
+  if (GST_BUFFER_OFFSET_IS_VALID (data))
+    dlna_src->ts_phase = (GST_BUFFER_OFFSET (data) + skip) %
+        dlna_src->ts_packet_size;
+  if (skip == 0)
+    return data;
+
+  GST_DEBUG_OBJECT (dlna_src, "Trimmed %" G_GSSIZE_FORMAT
+      " bytes preceding first packet", skip);
+  trimmed = gst_buffer_copy_region (data, GST_BUFFER_COPY_ALL, skip,
+      size - skip);
+  if (GST_BUFFER_OFFSET_IS_VALID (data))
+    GST_BUFFER_OFFSET (trimmed) = GST_BUFFER_OFFSET (data) + skip;
+  if (GST_BUFFER_OFFSET_END_IS_VALID (data))
+    GST_BUFFER_OFFSET_END (trimmed) = GST_BUFFER_OFFSET_END (data);
+  gst_buffer_unref (data);
+
+  return trimmed;
+}
+
+/**
+ * Keeps transport stream packet if it starts a PAT or the PMT of program
+ * announced by PAT.  Only tables which fit into a single packet are kept.
+ * Called with event mutex held.
+ *
+ * @param	dlna_src	this element
+ * @param	packet		packet including timestamp of 192 byte packets
+ * @param	packet_size	size of packet
+ */
+static void
+dlna_src_psi_capture (GstDlnaSrc * dlna_src, const guint8 * packet,
+    guint packet_size)
+{
+  const guint8 *ts = packet + packet_size - TS_PACKET_SIZE;
+  const guint8 *section = NULL;
+  const guint8 *end = ts + TS_PACKET_SIZE;
+  guint section_len = 0;
+  gint pid = ((ts[1] & 0x1f) << 8) | ts[2];
+
+  // Injected tables continue counting from last packet of their PID
+  if ((pid == 0) && (ts[3] & 0x10))
+    dlna_src->pat_cc = ts[3] & 0x0f;
+  else if ((pid == dlna_src->pmt_pid) && (ts[3] & 0x10))
+    dlna_src->pmt_cc = ts[3] & 0x0f;
+
+  // Section must start in this packet which must carry payload
+  if (((ts[1] & 0x40) == 0) || ((ts[3] & 0x10) == 0))
+    return;
+  if ((pid != 0) && (pid != dlna_src->pmt_pid))
+    return;
+
+  section = ts + 4;
+  if (ts[3] & 0x20)
+    section += 1 + ts[4];
+  if (section >= end)
+    return;
+  section += 1 + section[0];
+  if (section + 3 > end)
+    return;
+  section_len = ((section[1] & 0x0f) << 8) | section[2];
+  if (section + 3 + section_len > end)
+    return;
+
+  if ((pid == 0) && (section[0] == 0x00)) {
+    const guint8 *program = section + 8;
+    const guint8 *programs_end = section + 3 + section_len - 4;
+
+    // First program other than network information carries the PMT PID
+    for (; program + 4 <= programs_end; program += 4) {
+      if ((program[0] == 0) && (program[1] == 0))
+        continue;
+      dlna_src->pmt_pid = ((program[2] & 0x1f) << 8) | program[3];
+      break;
+    }
+    dlna_src_psi_store (dlna_src, &dlna_src->pat_packet, packet, packet_size);
+  } else if ((pid == dlna_src->pmt_pid) && (section[0] == 0x02)) {
+    const guint8 *stream = NULL;
+    const guint8 *streams_end = section + 3 + section_len - 4;
+
+    if (section + 12 > streams_end)
+      return;
+
+    // Type of first video stream tells key frame filter what to look for
+    stream = section + 12 + (((section[10] & 0x0f) << 8) | section[11]);
+    for (; stream + 5 <= streams_end;
+        stream += 5 + (((stream[3] & 0x0f) << 8) | stream[4])) {
+      if ((stream[0] == STREAM_TYPE_MPEG1_VIDEO) ||
+          (stream[0] == STREAM_TYPE_MPEG2_VIDEO) ||
+          (stream[0] == STREAM_TYPE_H264)) {
+        dlna_src->video_stream_type = stream[0];
+        break;
+      }
+    }
+    dlna_src_psi_store (dlna_src, &dlna_src->pmt_packet, packet, packet_size);
+  }
+}
+
+/**
+ * Replaces kept table packet unless it is unchanged.
+ *
+ * @param	dlna_src	this element
+ * @param	stored		kept packet to replace
+ * @param	packet		packet to keep
+ * @param	packet_size	size of packet
+ */
+static void
+dlna_src_psi_store (GstDlnaSrc * dlna_src, GstBuffer ** stored,
+    const guint8 * packet, guint packet_size)
+{
+  if ((*stored != NULL) &&
+      (gst_buffer_memcmp (*stored, 0, packet, packet_size) == 0))
+    return;
+
+  GST_DEBUG_OBJECT (dlna_src, "Keeping %s packet",
+      (stored == &dlna_src->pat_packet) ? "PAT" : "PMT");
+  if (*stored != NULL)
+    gst_buffer_unref (*stored);
+  *stored = gst_buffer_new_allocate (NULL, packet_size, NULL);
+  gst_buffer_fill (*stored, 0, packet, packet_size);
+}
+
+/**
+ * Copies kept table packet for injection.  Continuity counter of copy
+ * follows last packet seen on its PID, so repeated injections are not taken
+ * for duplicates.  The first table of restarted transfer may still be
+ * discontinuous, so discontinuity indicator is set where packet has an
+ * adaptation field, and demuxers lose nothing by resyncing since only
+ * tables fitting into a single packet are kept.  Called with event mutex
+ * held.
+ *
+ * @param	dlna_src	this element
+ * @param	stored		kept packet
+ * @param	cc			continuity counter of last packet of PID, updated
+ *
+ * @return	copy of packet to inject
+ */
+static GstBuffer *
+dlna_src_psi_copy (GstDlnaSrc * dlna_src, GstBuffer * stored, guint8 * cc)
+{
+  GstBuffer *packet = NULL;
+  GstMapInfo map;
+  guint8 *ts = NULL;
+
+  packet = gst_buffer_new_allocate (NULL, gst_buffer_get_size (stored), NULL);
+  if (!gst_buffer_map (packet, &map, GST_MAP_WRITE)) {
+    gst_buffer_unref (packet);
+    return gst_buffer_ref (stored);
+  }
+  gst_buffer_extract (stored, 0, map.data, map.size);
+
+  ts = map.data + map.size - TS_PACKET_SIZE;
+  *cc = (*cc + 1) & 0x0f;
+  ts[3] = (ts[3] & 0xf0) | *cc;
+  if ((ts[3] & 0x20) && (ts[4] > 0))
+    ts[5] |= 0x80;
+  gst_buffer_unmap (packet, &map);
+
+  return packet;
+}
+
+/**
+ * Prepends kept PAT and PMT packets to first buffer of a restarted transfer
+ * of transport stream, so decoder need not wait for tables to be repeated.
+ * Copied tables lie nowhere in the content, so buffer has no offset, its end
+ * offset is kept.  Called with event mutex held.
+ *
+ * @param	dlna_src	this element
+ * @param	buf			first buffer of restarted transfer
+ *
+ * @return	buffer starting with tables, supplied buffer if none were kept
+ */
+static GstBuffer *
+dlna_src_psi_inject (GstDlnaSrc * dlna_src, GstBuffer * buf)
+{
+  GstBuffer *tables = NULL;
+
+  if ((dlna_src->pat_packet == NULL) || (dlna_src->pmt_packet == NULL))
+    return buf;
+
+  tables = gst_buffer_append (dlna_src_psi_copy (dlna_src,
+          dlna_src->pat_packet, &dlna_src->pat_cc),
+      dlna_src_psi_copy (dlna_src, dlna_src->pmt_packet, &dlna_src->pmt_cc));
+
+  GST_DEBUG_OBJECT (dlna_src, "Injecting PAT and PMT ahead of restarted "
+      "transfer");
+  gst_buffer_copy_into (tables, buf, GST_BUFFER_COPY_METADATA, 0, -1);
+  GST_BUFFER_OFFSET (tables) = GST_BUFFER_OFFSET_NONE;
+  tables = gst_buffer_append (tables, buf);
+
+  return tables;
+}
+
+/**
+ * Discards state of key frame filter, so filtering starts over at a packet
+ * boundary.  Called with event mutex held.
+ *
+ * @param	dlna_src	this element
+ */
+static void
+dlna_src_keyframe_reset (GstDlnaSrc * dlna_src)
+{
+  if (dlna_src->keyframe_rest != NULL) {
+    gst_buffer_unref (dlna_src->keyframe_rest);
+    dlna_src->keyframe_rest = NULL;
+  }
+  dlna_src->keyframe_pid = -1;
+  dlna_src->keyframe_passing = FALSE;
+}
+
+/**
+ * Passes on only PAT, PMT and packets of video frames which start with a key
+ * frame.  Partial packet at end of buffer is kept and completed by the next
+ * buffer.  Called with event mutex held.
+ *
+ * @param	dlna_src	this element
+ * @param	buf			buffer passing src pad, starting on packet boundary
+ *
+ * @return	buffer of packets to pass on, NULL if none is to be passed on
+ */
+static GstBuffer *
+dlna_src_keyframe_filter (GstDlnaSrc * dlna_src, GstBuffer * buf)
+{
+  GstBuffer *filtered = NULL;
+  GstMapInfo in;
+  GstMapInfo out;
+  guint packet_size = dlna_src->ts_packet_size;
+  guint sync = packet_size - TS_PACKET_SIZE;
+  GstBuffer *rest = dlna_src->keyframe_rest;
+  guint64 offset = GST_BUFFER_OFFSET (buf);
+  gsize kept = 0;
+  gsize size = 0;
+  gsize pos = 0;
+
+  // Partial packet kept from previous buffer is completed by this one
+  // unless data is discontinuous, buffer keeps its flags and timestamps
+  dlna_src->keyframe_rest = NULL;
+  if ((rest != NULL) && GST_BUFFER_IS_DISCONT (buf)) {
+    GST_DEBUG_OBJECT (dlna_src, "Dropping partial packet preceding "
+        "discontinuity");
+    gst_buffer_unref (rest);
+  } else if (rest != NULL) {
+    size = gst_buffer_get_size (rest);
+    gst_buffer_copy_into (rest, buf, GST_BUFFER_COPY_METADATA, 0, -1);
+    buf = gst_buffer_append (rest, buf);
+    GST_BUFFER_OFFSET (buf) = ((offset != GST_BUFFER_OFFSET_NONE) &&
+        (offset >= size)) ? offset - size : GST_BUFFER_OFFSET_NONE;
+  }
+  if (!gst_buffer_map (buf, &in, GST_MAP_READ))
+    return buf;
+
+  filtered = gst_buffer_new_allocate (NULL, in.size, NULL);
+  gst_buffer_map (filtered, &out, GST_MAP_WRITE);
+  for (pos = 0; pos + packet_size <= in.size; pos += packet_size) {
+    if (in.data[pos + sync] != TS_SYNC_BYTE) {
+      // Pass rest on unfiltered rather than lose sync of demuxer
+      GST_DEBUG_OBJECT (dlna_src, "Lost packet sync, filtering stopped");
+      memcpy (out.data + kept, in.data + pos, in.size - pos);
+      kept += in.size - pos;
+      pos = in.size;
+      break;
+    }
+    // Tables are looked into here as well, since PCR scan which otherwise
+    // does so only runs at normal rate
+    dlna_src_psi_capture (dlna_src, in.data + pos, packet_size);
+    if (dlna_src_keyframe_packet (dlna_src, in.data + pos + sync)) {
+      memcpy (out.data + kept, in.data + pos, packet_size);
+      kept += packet_size;
+    }
+  }
+  size = in.size;
+  gst_buffer_unmap (filtered, &out);
+  gst_buffer_unmap (buf, &in);
+
+  if (pos < size)
+    dlna_src->keyframe_rest = gst_buffer_copy_region (buf,
+        GST_BUFFER_COPY_MEMORY, pos, size - pos);
+
+  gst_buffer_set_size (filtered, kept);
+  gst_buffer_copy_into (filtered, buf, GST_BUFFER_COPY_METADATA, 0, -1);
+  GST_BUFFER_OFFSET_END (filtered) = GST_BUFFER_OFFSET_NONE;
+  gst_buffer_unref (buf);
+
+  if (kept == 0) {
+    gst_buffer_unref (filtered);
+    return NULL;
+  }
+  return filtered;
+}
+
+/**
+ * Decides whether transport stream packet passes key frame filter.  Video
+ * PES packets are recognized by their stream id, a PES packet is passed on
+ * along with the packets continuing it if its first packet has the random
+ * access indicator set or, once the PMT told the video stream type, starts
+ * an MPEG-2 sequence header or I picture or an H.264 IDR slice or sequence
+ * parameter set.
+ *
+ * @param	dlna_src	this element
+ * @param	ts			packet starting with sync byte
+ *
+ * @return	true if packet is to be passed on, false otherwise
+ */
+static gboolean
+dlna_src_keyframe_packet (GstDlnaSrc * dlna_src, const guint8 * ts)
+{
+  const guint8 *payload = ts + 4;
+  const guint8 *end = ts + TS_PACKET_SIZE;
+  const guint8 *es = NULL;
+  gint pid = ((ts[1] & 0x1f) << 8) | ts[2];
+  gboolean random_access = FALSE;
+
+  if ((pid == 0) || (pid == dlna_src->pmt_pid))
+    return TRUE;
+  if ((dlna_src->keyframe_pid != -1) && (pid != dlna_src->keyframe_pid))
+    return FALSE;
+
+  if (ts[3] & 0x20) {
+    random_access = (ts[4] > 0) && (ts[5] & 0x40);
+    payload += 1 + ts[4];
+  }
+  // Packets continuing a PES packet follow decision of its first packet
+  if ((ts[1] & 0x40) == 0)
+    return (pid == dlna_src->keyframe_pid) && dlna_src->keyframe_passing;
+
+  if ((payload + 9 > end) || (payload[0] != 0) || (payload[1] != 0) ||
+      (payload[2] != 1) || ((payload[3] & 0xf0) != 0xe0))
+    return FALSE;
+
+  // Video stream of first video PES packet is filtered from now on
+  dlna_src->keyframe_pid = pid;
+
+  es = payload + 9 + payload[8];
+  for (; !random_access && (es + 5 < end); es++) {
+    if ((es[0] != 0) || (es[1] != 0) || (es[2] != 1))
+      continue;
+    if (dlna_src->video_stream_type == STREAM_TYPE_H264) {
+      // IDR slice or sequence parameter set
+      random_access = ((es[3] & 0x1f) == 5) || ((es[3] & 0x1f) == 7);
+    } else if (dlna_src->video_stream_type != 0) {
+      // Sequence header or picture header with I picture coding type
+      random_access = (es[3] == 0xb3) ||
+          ((es[3] == 0x00) && (((es[5] >> 3) & 0x07) == 1));
+    }
+  }
+  dlna_src->keyframe_passing = random_access;
+
+  return random_access;
+}
+
+/**
+ * Updates pending time based segment using TimeSeekRange header returned in
+ * response to transfer restarted by this element, since server may start at
+ * a different position than requested.  Byte position is used to offset
+ * buffers.
+ *
+ * @param	dlna_src	this element
+ * @param	value		value of TimeSeekRange response header
+ */
+static void
+dlna_src_update_time_segment (GstDlnaSrc * dlna_src, const gchar * value)
+{
+  GstDlnaSrcHeadResponse *response = NULL;
+  gchar *field_str = NULL;
+
+  if (value == NULL)
+    return;
+
+  GST_DEBUG_OBJECT (dlna_src, "Time seek range in response: %s", value);
+
+  // Parse as HEAD response field since format is identical
+  if (!dlna_src_head_response_init_struct (dlna_src, &response))
+    return;
+
+  field_str = g_ascii_strup (value, -1);
+  if (strstr (field_str, TIME_SEEK_HEADERS[HEADER_INDEX_NPT]) != NULL)
+    dlna_src_head_response_parse_time_seek (dlna_src, response,
+        HEADER_INDEX_TIMESEEKRANGE, field_str);
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  if (response->time_seek_response_received && (response->byte_seek_end > 0))
+    dlna_src_seek_index_add (dlna_src, response->time_seek_npt_start,
+        response->byte_seek_start);
+  if (response->time_seek_response_received && dlna_src->segment_pending &&
+      (dlna_src->segment.format == GST_FORMAT_TIME)) {
+    GST_INFO_OBJECT (dlna_src, "Server started at %" GST_TIME_FORMAT
+        ", byte %" G_GUINT64_FORMAT, GST_TIME_ARGS
+        (response->time_seek_npt_start), response->byte_seek_start);
+
+    dlna_src->segment.start = response->time_seek_npt_start;
+    dlna_src->segment.time = response->time_seek_npt_start;
+    dlna_src->segment.position = response->time_seek_npt_start;
+
+    // Offsets of data are only known if server told its start byte
+    if (response->byte_seek_end > 0) {
+      dlna_src->byte_offset = response->byte_seek_start;
+      dlna_src->offsets_known = TRUE;
+    }
+  }
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  dlna_src_head_response_free (dlna_src, response);
+  g_free (field_str);
+}
+
+/**
+ * Converts media time into byte position using the byte and time totals
+ * reported in HEAD response, assuming a constant bitrate.
+ *
+ * @param	dlna_src	this element
+ * @param	time		media time in nanoseconds
+ * @param	round_up	true to round up, used for stop positions
+ * @param	bytes		returned byte position
+ *
+ * @return	true if conversion was possible, false otherwise
+ */
+static gboolean
+dlna_src_time_to_bytes (GstDlnaSrc * dlna_src, guint64 time,
+    gboolean round_up, guint64 * bytes)
+{
+  guint64 total_bytes = 0;
+  guint64 duration = 0;
+
+  // Positions reported by server are more accurate than constant bitrate
+  if (dlna_src_seek_index_time_to_bytes (dlna_src, time, bytes)) {
+    GST_DEBUG_OBJECT (dlna_src, "Converted time %" GST_TIME_FORMAT
+        " into byte %" G_GUINT64_FORMAT " using seek index",
+        GST_TIME_ARGS (time), *bytes);
+    return TRUE;
+  }
+
+  if ((dlna_src->server_info == NULL) ||
+      (!dlna_src->server_info->time_seek_response_received) ||
+      (!dlna_src_get_content_size (dlna_src, &total_bytes))) {
+    GST_DEBUG_OBJECT (dlna_src, "No byte and time totals to convert with");
+    return FALSE;
+  }
+
+  duration = dlna_src->server_info->time_seek_npt_duration;
+  if (duration == 0)
+    return FALSE;
+
+  if (time >= duration) {
+    *bytes = total_bytes - 1;
+  } else if (round_up) {
+    *bytes = gst_util_uint64_scale_ceil (time, total_bytes, duration);
+  } else {
+    *bytes = gst_util_uint64_scale (time, total_bytes, duration);
+  }
+
+  GST_DEBUG_OBJECT (dlna_src, "Converted time %" GST_TIME_FORMAT
+      " into byte %" G_GUINT64_FORMAT, GST_TIME_ARGS (time), *bytes);
+
+  return TRUE;
+}
+
+/*********************************************/
+/**********                         **********/
+/********** TRICK MODE EMULATION    **********/
+/**********                         **********/
+/*********************************************/
+
+/**
+ * Determines if rate which server does not support can be emulated, which
+ * requires a transport stream whose ranges can be fetched.
+ *
+ * @param	dlna_src	this element
+ * @param	rate		requested rate
+ *
+ * @return	true if rate is emulated, false otherwise
+ */
+static gboolean
+dlna_src_is_trick_emulated (GstDlnaSrc * dlna_src, gfloat rate)
+{
+  if (!dlna_src->trick_mode_emulation || (rate == 0.0) || (rate == 1.0))
+    return FALSE;
+
+  if ((dlna_src->ts_packet_size == 0) || !dlna_src_is_pull_supported (dlna_src))
+    return FALSE;
+
+  return !dlna_src_is_rate_supported (dlna_src, rate);
+}
+
+/**
+ * Starts emulating rate by stopping transfer of souphttpsrc and fetching key
+ * frames from a thread of this element.
+ *
+ * @param	dlna_src	this element
+ * @param	rate		rate to emulate
+ * @param	format		format of start position
+ * @param	start		position to start at, negative if unchanged
+ * @param	seqnum		sequence number of seek
+ *
+ * @return	true if emulation was started, false otherwise
+ */
+static gboolean
+dlna_src_trick_start (GstDlnaSrc * dlna_src, gdouble rate, GstFormat format,
+    gint64 start, guint32 seqnum)
+{
+  guint64 time = 0;
+
+  // Key frames are located by time
+  if ((format == GST_FORMAT_BYTES) && (start >= 0)) {
+    if (!dlna_src_seek_index_bytes_to_time (dlna_src, start, &time))
+      time = 0;
+  } else if ((format == GST_FORMAT_TIME) && (start >= 0)) {
+    time = start;
+  }
+
+  GST_INFO_OBJECT (dlna_src, "Emulating rate %3.1f from %" GST_TIME_FORMAT,
+      rate, GST_TIME_ARGS (time));
+
+  dlna_src->trick_rate = rate;
+  dlna_src->trick_format = GST_FORMAT_TIME;
+  dlna_src->trick_position = time;
+
+  return dlna_src_trick_run (dlna_src, dlna_src_trick_thread, seqnum);
+}
+
+/**
+ * Stops transfer of souphttpsrc, flushing downstream, and starts thread
+ * which pushes data of emulated rate in its place.
+ *
+ * @param	dlna_src	this element
+ * @param	func		thread function
+ * @param	seqnum		sequence number of seek
+ *
+ * @return	true if thread was started, false otherwise
+ */
+static gboolean
+dlna_src_trick_run (GstDlnaSrc * dlna_src, GThreadFunc func, guint32 seqnum)
+{
+  GstEvent *flush_event = NULL;
+
+  flush_event = gst_event_new_flush_start ();
+  gst_event_set_seqnum (flush_event, seqnum);
+  dlna_src_push_flush (dlna_src, flush_event);
+
+  gst_element_set_state (dlna_src->http_src, GST_STATE_READY);
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  dlna_src->segment_pending = FALSE;
+  dlna_src->byte_offset = 0;
+  dlna_src->offsets_known = FALSE;
+  dlna_src_ts_sync_reset (dlna_src, FALSE);
+  dlna_src_keyframe_reset (dlna_src);
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  flush_event = gst_event_new_flush_stop (TRUE);
+  gst_event_set_seqnum (flush_event, seqnum);
+  dlna_src_push_flush (dlna_src, flush_event);
+
+  // Transfer restarted after emulation must not reuse range of previous one
+  dlna_src->range_headers_set = TRUE;
+
+  dlna_src->trick_seqnum = seqnum;
+  g_atomic_int_set (&dlna_src->trick_running, TRUE);
+
+  dlna_src->trick_thread = g_thread_try_new ("dlnasrc-trick", func, dlna_src,
+      NULL);
+  if (dlna_src->trick_thread == NULL) {
+    g_atomic_int_set (&dlna_src->trick_running, FALSE);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/**
+ * Stops trick mode emulation if running.
+ *
+ * @param	dlna_src	this element
+ * @param	flush		true to flush downstream so a blocked push returns,
+ * 						false if pads are inactive already
+ */
+static void
+dlna_src_trick_stop (GstDlnaSrc * dlna_src, gboolean flush)
+{
+  if (dlna_src->trick_thread == NULL)
+    return;
+
+  GST_INFO_OBJECT (dlna_src, "Stopping trick mode emulation");
+
+  g_atomic_int_set (&dlna_src->trick_running, FALSE);
+  if (flush)
+    gst_pad_push_event (dlna_src->src_pad, gst_event_new_flush_start ());
+
+  g_thread_join (dlna_src->trick_thread);
+  dlna_src->trick_thread = NULL;
+
+  if (flush)
+    gst_pad_push_event (dlna_src->src_pad, gst_event_new_flush_stop (TRUE));
+}
+
+/**
+ * Fetches a range at the position of every key frame to show and pushes the
+ * key frame found in it along with a segment of the emulated rate.  Position
+ * advances by rate times TRICK_FRAME_INTERVAL per frame, so data fetched
+ * depends on number of frames shown rather than on bitrate of content.  Each
+ * frame is stamped with its media time and lasts the media time its interval
+ * covers at the emulated rate.
+ * Positions beyond the seek index and HEAD response are estimated from the
+ * last position located and bitrate of content.
+ *
+ * @param	data	this element
+ *
+ * @return	NULL
+ */
+static gpointer
+dlna_src_trick_thread (gpointer data)
+{
+  GstDlnaSrc *dlna_src = GST_DLNA_SRC (data);
+  GstSegment segment;
+  GstEvent *event = NULL;
+  GstBuffer *buf = NULL;
+  GstDlnaSrcTrickFrame frame;
+  GstFlowReturn flow = GST_FLOW_OK;
+  GstClockTime time = 0;
+  guint8 *chunk = NULL;
+  guint8 *frame_data = NULL;
+  gdouble rate = dlna_src->trick_rate;
+  gint64 position = dlna_src->trick_position;
+  gint64 step = ABS (rate) * TRICK_FRAME_INTERVAL;
+  gint64 located_position = -1;
+  guint64 located_byte = 0;
+  guint64 duration = 0;
+  guint64 content_size = 0;
+  guint64 byte_rate = 0;
+  guint64 start_byte = 0;
+  guint64 end_byte = 0;
+  gsize fetch_size = 0;
+  gsize fetched = 0;
+  gboolean started = FALSE;
+  gboolean ended = FALSE;
+
+  if (dlna_src->server_info->time_seek_response_received)
+    duration = dlna_src->server_info->time_seek_npt_duration;
+  dlna_src_get_content_size (dlna_src, &content_size);
+
+  byte_rate = dlna_src_trick_byte_rate (dlna_src, content_size, duration);
+  fetch_size = CLAMP (gst_util_uint64_scale (byte_rate, TRICK_FETCH_DURATION,
+          GST_SECOND), MIN_TRICK_FETCH_SIZE, MAX_TRICK_FETCH_SIZE);
+  GST_DEBUG_OBJECT (dlna_src, "Fetching %" G_GSIZE_FORMAT " bytes per key "
+      "frame at %" G_GUINT64_FORMAT " bytes/s", fetch_size, byte_rate);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  segment.rate = rate;
+  if (rate > 0) {
+    segment.start = position;
+    segment.stop = (duration > 0) ? duration : -1;
+  } else {
+    segment.start = 0;
+    segment.stop = position;
+  }
+  segment.time = segment.start;
+  segment.position = position;
+#if GST_CHECK_VERSION (1, 6, 0)
+  segment.flags |= GST_SEGMENT_FLAG_TRICKMODE |
+      GST_SEGMENT_FLAG_TRICKMODE_KEY_UNITS;
+#else
+  segment.flags |= GST_SEGMENT_FLAG_SKIP;
+#endif
+  event = gst_event_new_segment (&segment);
+  gst_event_set_seqnum (event, dlna_src->trick_seqnum);
+  gst_pad_push_event (dlna_src->src_pad, event);
+
+  chunk = g_malloc (MAX_TRICK_FETCH_SIZE);
+  frame_data = g_malloc (MAX_TRICK_FETCH_SIZE);
+  while (g_atomic_int_get (&dlna_src->trick_running) &&
+      (flow == GST_FLOW_OK)) {
+    if ((position < 0) || ((duration > 0) && (position >= duration))) {
+      ended = TRUE;
+      break;
+    }
+    // Past last anchor of seek index, position is estimated from last one
+    // located, which is itself either converted or estimated
+    if (dlna_src_time_to_bytes (dlna_src, position, FALSE, &start_byte)) {
+      located_position = position;
+      located_byte = start_byte;
+    } else if (located_position >= 0) {
+      if (position >= located_position)
+        start_byte = located_byte + gst_util_uint64_scale (position -
+            located_position, byte_rate, GST_SECOND);
+      else
+        start_byte = located_byte - MIN (located_byte,
+            gst_util_uint64_scale (located_position - position, byte_rate,
+                GST_SECOND));
+    } else {
+      start_byte = gst_util_uint64_scale (position, byte_rate, GST_SECOND);
+    }
+    if (start_byte >= content_size) {
+      ended = TRUE;
+      break;
+    }
+
+    // Range is extended while key frame found in it continues past its end
+    memset (&frame, 0, sizeof (frame));
+    frame.data = frame_data;
+    fetched = 0;
+    do {
+      end_byte = MIN (start_byte + fetched + MIN (fetch_size,
+              MAX_TRICK_FETCH_SIZE - fetched), content_size) - 1;
+      if (!dlna_src_range_request (dlna_src, &dlna_src->trick_sock,
+              start_byte + fetched, end_byte, chunk + fetched) &&
+          !dlna_src_range_request (dlna_src, &dlna_src->trick_sock,
+              start_byte + fetched, end_byte, chunk + fetched)) {
+        GST_ELEMENT_ERROR (dlna_src, RESOURCE, READ, (NULL),
+            ("Unable to fetch key frame at byte %" G_GUINT64_FORMAT,
+                start_byte + fetched));
+        flow = GST_FLOW_ERROR;
+        break;
+      }
+      fetched = end_byte - start_byte + 1;
+
+      g_mutex_lock (&dlna_src->event_mutex);
+      started = dlna_src_trick_extract (dlna_src, chunk, fetched, &frame);
+      g_mutex_unlock (&dlna_src->event_mutex);
+    } while (started && !frame.complete &&
+        (start_byte + fetched < content_size) &&
+        (fetched < MAX_TRICK_FETCH_SIZE) &&
+        g_atomic_int_get (&dlna_src->trick_running));
+
+    if (started && (flow == GST_FLOW_OK)) {
+      buf = gst_buffer_new_allocate (NULL, frame.size, NULL);
+      gst_buffer_fill (buf, 0, frame.data, frame.size);
+
+      // Frames keep within segment even if their time is off a little
+      time = dlna_src_trick_frame_time (dlna_src, &frame, start_byte,
+          position);
+      if (rate > 0)
+        time = MAX (time, segment.start);
+      if (GST_CLOCK_TIME_IS_VALID (segment.stop))
+        time = MIN (time, segment.stop);
+      GST_BUFFER_PTS (buf) = time;
+      GST_BUFFER_DTS (buf) = time;
+      GST_BUFFER_DURATION (buf) = step;
+
+      g_mutex_lock (&dlna_src->event_mutex);
+      buf = dlna_src_psi_inject (dlna_src, buf);
+      g_mutex_unlock (&dlna_src->event_mutex);
+
+      GST_LOG_OBJECT (dlna_src, "Pushing key frame at %" GST_TIME_FORMAT
+          " from %" G_GSIZE_FORMAT " bytes fetched", GST_TIME_ARGS (time),
+          fetched);
+      GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
+      flow = gst_pad_push (dlna_src->src_pad, buf);
+    }
+    position += (rate > 0) ? step : -step;
+  }
+  g_free (chunk);
+  g_free (frame_data);
+
+  if (dlna_src->trick_sock >= 0)
+    dlna_src_close_socket (dlna_src, &dlna_src->trick_sock);
+
+  if (ended && g_atomic_int_get (&dlna_src->trick_running)) {
+    GST_INFO_OBJECT (dlna_src, "Trick mode emulation reached end of content");
+    event = gst_event_new_eos ();
+    gst_event_set_seqnum (event, dlna_src->trick_seqnum);
+    gst_pad_push_event (dlna_src->src_pad, event);
+  }
+
+  return NULL;
+}
+
+/**
+ * Determines bitrate of content for locating key frames and sizing ranges
+ * fetched for them, from byte and time totals of HEAD response, else from
+ * first and last anchors of seek index.
+ *
+ * @param	dlna_src		this element
+ * @param	content_size	size of content, 0 if unknown
+ * @param	duration		duration of content, 0 if unknown
+ *
+ * @return	bytes per second of content
+ */
+static guint64
+dlna_src_trick_byte_rate (GstDlnaSrc * dlna_src, guint64 content_size,
+    guint64 duration)
+{
+  GstDlnaSrcSeekAnchor *first = NULL;
+  GstDlnaSrcSeekAnchor *last = NULL;
+  guint64 byte_rate = 0;
+
+  if ((content_size > 0) && (duration > 0))
+    return gst_util_uint64_scale (content_size, GST_SECOND, duration);
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  if (dlna_src->seek_index->len >= 2) {
+    first = &g_array_index (dlna_src->seek_index, GstDlnaSrcSeekAnchor, 0);
+    last = &g_array_index (dlna_src->seek_index, GstDlnaSrcSeekAnchor,
+        dlna_src->seek_index->len - 1);
+    if ((last->time > first->time) && (last->offset > first->offset))
+      byte_rate = gst_util_uint64_scale (last->offset - first->offset,
+          GST_SECOND, last->time - first->time);
+  }
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  return (byte_rate > 0) ? byte_rate : PREFETCH_FALLBACK_BYTE_RATE;
+}
+
+/**
+ * Extracts packets of first key frame in fetched range, keeping PAT and PMT
+ * for caller to send ahead of it.  Range may have been extended since last
+ * call, parsing continues where it left off.  PCR last seen ahead of frame,
+ * else first one after its start, is kept to date frame by.  Called with
+ * event mutex held.
+ *
+ * @param	dlna_src	this element
+ * @param	data		fetched range
+ * @param	size		size of range fetched so far
+ * @param	frame		key frame extracted so far, zeroed apart from its data
+ * 						before first call on range
+ *
+ * @return	true if key frame has started within range, false otherwise
+ */
+static gboolean
+dlna_src_trick_extract (GstDlnaSrc * dlna_src, const guint8 * data,
+    gsize size, GstDlnaSrcTrickFrame * frame)
+{
+  const guint8 *ts = NULL;
+  guint packet_size = dlna_src->ts_packet_size;
+  guint sync = packet_size - TS_PACKET_SIZE;
+  gssize first = 0;
+  guint64 pcr = 0;
+  gint pcr_pid = 0;
+  gint pid = 0;
+
+  // Range need not start on a packet
+  if (!frame->synced) {
+    first = dlna_src_ts_find_sync (data, size, packet_size, NULL);
+    if (first < 0)
+      return FALSE;
+    frame->parsed = first;
+    frame->synced = TRUE;
+    dlna_src->keyframe_passing = FALSE;
+  }
+
+  for (; frame->parsed + packet_size <= size; frame->parsed += packet_size) {
+    ts = data + frame->parsed + sync;
+
+    // Frame can not be followed past lost sync
+    if (ts[0] != TS_SYNC_BYTE) {
+      frame->complete = TRUE;
+      break;
+    }
+
+    if ((!frame->started || !frame->pcr_found) &&
+        dlna_src_pcr_parse (ts, &pcr, &pcr_pid) &&
+        ((dlna_src->pcr_pid == -1) || (pcr_pid == dlna_src->pcr_pid))) {
+      frame->pcr = pcr;
+      frame->pcr_found = TRUE;
+    }
+    // Tables are kept and sent ahead of frame
+    dlna_src_psi_capture (dlna_src, data + frame->parsed, packet_size);
+    pid = ((ts[1] & 0x1f) << 8) | ts[2];
+    if ((pid == 0) || (pid == dlna_src->pmt_pid))
+      continue;
+
+    // Frame ends where next PES packet of video stream starts
+    if (frame->started && (pid == dlna_src->keyframe_pid) && (ts[1] & 0x40)) {
+      frame->complete = TRUE;
+      break;
+    }
+
+    if (dlna_src_keyframe_packet (dlna_src, ts) &&
+        (pid == dlna_src->keyframe_pid)) {
+      if (!frame->started)
+        frame->offset = frame->parsed;
+      memcpy (frame->data + frame->size, data + frame->parsed, packet_size);
+      frame->size += packet_size;
+      frame->started = TRUE;
+    }
+  }
+
+  return frame->started;
+}
+
+/**
+ * Determines media time of key frame extracted for trick mode emulation, from
+ * its PCR if time of content start is known, else from seek index, else from
+ * position it was looked for at.
+ *
+ * @param	dlna_src	this element
+ * @param	frame		extracted key frame
+ * @param	start_byte	first byte of range frame was extracted from
+ * @param	position	media time frame was looked for at
+ *
+ * @return	media time of frame
+ */
+static GstClockTime
+dlna_src_trick_frame_time (GstDlnaSrc * dlna_src,
+    GstDlnaSrcTrickFrame * frame, guint64 start_byte, guint64 position)
+{
+  guint64 pcr = frame->pcr;
+  guint64 time = 0;
+  gboolean known = FALSE;
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  if (frame->pcr_found && dlna_src->pcr_base_known) {
+    if (pcr < dlna_src->pcr_base)
+      pcr += PCR_WRAP;
+    time = gst_util_uint64_scale (pcr - dlna_src->pcr_base, 1000, 27);
+    known = TRUE;
+  }
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  if (!known && !dlna_src_seek_index_bytes_to_time (dlna_src,
+          start_byte + frame->offset, &time))
+    time = position;
+
+  return time;
+}
+
+/**
+ * Determines if reverse rate which server does not support can be played by
+ * fetching chunks backwards, which requires content whose ranges can be
+ * fetched.
+ *
+ * @param	dlna_src	this element
+ * @param	rate		requested rate
+ *
+ * @return	true if rate is played from chunks, false otherwise
+ */
+static gboolean
+dlna_src_is_reverse_emulated (GstDlnaSrc * dlna_src, gfloat rate)
+{
+  if ((rate >= 0.0) || !dlna_src_is_pull_supported (dlna_src))
+    return FALSE;
+
+  return !dlna_src_is_rate_supported (dlna_src, rate);
+}
+
+/**
+ * Starts reverse playback from chunks fetched backwards from start position.
+ *
+ * @param	dlna_src	this element
+ * @param	rate		negative rate
+ * @param	format		format of start position
+ * @param	start		position to play backwards from, negative for end
+ * @param	seqnum		sequence number of seek
+ *
+ * @return	true if reverse playback was started, false if it was not, such
+ * 			as when start time can not be converted to bytes
+ */
+static gboolean
+dlna_src_reverse_start (GstDlnaSrc * dlna_src, gdouble rate,
+    GstFormat format, gint64 start, guint32 seqnum)
+{
+  guint64 content_size = 0;
+  guint64 position = 0;
+
+  dlna_src_get_content_size (dlna_src, &content_size);
+  if ((format == GST_FORMAT_TIME) && (start >= 0)) {
+    if (!dlna_src_time_to_bytes (dlna_src, start, TRUE, &position)) {
+      GST_WARNING_OBJECT (dlna_src, "Unable to convert start %"
+          GST_TIME_FORMAT " to bytes", GST_TIME_ARGS (start));
+      return FALSE;
+    }
+    dlna_src->trick_format = GST_FORMAT_TIME;
+    dlna_src->trick_segment_stop = start;
+  } else {
+    position = ((format == GST_FORMAT_BYTES) && (start >= 0)) ? start :
+        content_size;
+    dlna_src->trick_format = GST_FORMAT_BYTES;
+    dlna_src->trick_segment_stop = position;
+  }
+
+  GST_INFO_OBJECT (dlna_src, "Playing rate %3.1f backwards from byte %"
+      G_GUINT64_FORMAT, rate, position);
+
+  dlna_src->trick_rate = rate;
+  dlna_src->trick_position = MIN (position, content_size);
+
+  return dlna_src_trick_run (dlna_src, dlna_src_reverse_thread, seqnum);
+}
+
+/**
+ * Pushes chunks fetched backwards by fetching thread, each flagged as
+ * discontinuous, along with a segment of the reverse rate.
+ *
+ * @param	data	this element
+ *
+ * @return	NULL
+ */
+static gpointer
+dlna_src_reverse_thread (gpointer data)
+{
+  GstDlnaSrc *dlna_src = GST_DLNA_SRC (data);
+  GstDlnaSrcReverse reverse;
+  GstSegment segment;
+  GstEvent *event = NULL;
+  GThread *fetch_thread = NULL;
+  GstFlowReturn flow = GST_FLOW_OK;
+  gpointer chunk = NULL;
+  gboolean ended = FALSE;
+  guint64 content_size = 0;
+  guint64 duration = 0;
+  guint64 chunk_size = 0;
+  guint packet_size = dlna_src->ts_packet_size;
+  guint phase = 0;
+  guint i = 0;
+
+  // Chunks span a fixed duration at bitrate of content
+  if (dlna_src->server_info->time_seek_response_received)
+    duration = dlna_src->server_info->time_seek_npt_duration;
+  dlna_src_get_content_size (dlna_src, &content_size);
+  chunk_size = gst_util_uint64_scale (dlna_src_trick_byte_rate (dlna_src,
+          content_size, duration), REVERSE_CHUNK_DURATION, GST_SECOND);
+  reverse.position = dlna_src->trick_position;
+
+  // Chunks of transport streams hold whole packets, which start at phase of
+  // packets in content
+  if (packet_size > 0) {
+    g_mutex_lock (&dlna_src->event_mutex);
+    phase = dlna_src->ts_phase % packet_size;
+    g_mutex_unlock (&dlna_src->event_mutex);
+
+    chunk_size -= chunk_size % packet_size;
+    chunk_size = MAX (chunk_size, packet_size);
+    if (reverse.position > phase)
+      reverse.position -= (reverse.position - phase) % packet_size;
+  }
+
+  reverse.dlna_src = dlna_src;
+  reverse.chunks = g_async_queue_new ();
+  reverse.slots = g_async_queue_new ();
+  reverse.chunk_size = chunk_size;
+  reverse.stop = FALSE;
+  reverse.failed = FALSE;
+  for (i = 0; i < REVERSE_PREFETCH_CHUNKS; i++)
+    g_async_queue_push (reverse.slots, GINT_TO_POINTER (1));
+
+  gst_segment_init (&segment, dlna_src->trick_format);
+  segment.rate = dlna_src->trick_rate;
+  segment.start = 0;
+  segment.stop = dlna_src->trick_segment_stop;
+  segment.time = 0;
+  segment.position = dlna_src->trick_segment_stop;
+  event = gst_event_new_segment (&segment);
+  gst_event_set_seqnum (event, dlna_src->trick_seqnum);
+  gst_pad_push_event (dlna_src->src_pad, event);
+
+  fetch_thread = g_thread_try_new ("dlnasrc-reverse",
+      dlna_src_reverse_fetch_thread, &reverse, NULL);
+  if (fetch_thread == NULL) {
+    GST_ERROR_OBJECT (dlna_src, "Unable to start fetching reverse chunks");
+    reverse.failed = TRUE;
+  }
+
+  while ((fetch_thread != NULL) && g_atomic_int_get (&dlna_src->trick_running)
+      && (flow == GST_FLOW_OK)) {
+    // Wake up regularly to notice emulation being stopped
+    chunk = g_async_queue_timeout_pop (reverse.chunks, G_USEC_PER_SEC / 10);
+    if (chunk == NULL)
+      continue;
+
+    // Fetching thread queues itself once it has nothing more to fetch
+    if (chunk == &reverse) {
+      ended = !reverse.failed;
+      break;
+    }
+    flow = gst_pad_push (dlna_src->src_pad, GST_BUFFER (chunk));
+    g_async_queue_push (reverse.slots, GINT_TO_POINTER (1));
+  }
+
+  if (fetch_thread != NULL) {
+    g_atomic_int_set (&reverse.stop, TRUE);
+    g_async_queue_push (reverse.slots, GINT_TO_POINTER (1));
+    g_thread_join (fetch_thread);
+  }
+  while ((chunk = g_async_queue_try_pop (reverse.chunks)) != NULL)
+    if (chunk != &reverse)
+      gst_buffer_unref (GST_BUFFER (chunk));
+  g_async_queue_unref (reverse.chunks);
+  g_async_queue_unref (reverse.slots);
+
+  if (reverse.failed)
+    GST_ELEMENT_ERROR (dlna_src, RESOURCE, READ, (NULL),
+        ("Unable to fetch chunk for reverse playback"));
+
+  if (ended && g_atomic_int_get (&dlna_src->trick_running)) {
+    GST_INFO_OBJECT (dlna_src, "Reverse playback reached start of content");
+    event = gst_event_new_eos ();
+    gst_event_set_seqnum (event, dlna_src->trick_seqnum);
+    gst_pad_push_event (dlna_src->src_pad, event);
+  }
+
+  return NULL;
+}
+
+/**
+ * Fetches chunks backwards from position of reverse playback, running ahead
+ * of the pushing thread by as many chunks as there are slots.
+ *
+ * @param	data	reverse playback state
+ *
+ * @return	NULL
+ */
+static gpointer
+dlna_src_reverse_fetch_thread (gpointer data)
+{
+  GstDlnaSrcReverse *reverse = data;
+  GstDlnaSrc *dlna_src = reverse->dlna_src;
+  GstBuffer *chunk = NULL;
+  guint8 *chunk_data = NULL;
+  guint64 start_byte = 0;
+  guint64 end_byte = reverse->position;
+  gint sock = -1;
+
+  while (end_byte > 0) {
+    g_async_queue_pop (reverse->slots);
+    if (g_atomic_int_get (&reverse->stop))
+      break;
+
+    start_byte = (end_byte > reverse->chunk_size) ?
+        end_byte - reverse->chunk_size : 0;
+
+    chunk_data = g_try_malloc (end_byte - start_byte);
+    if ((chunk_data == NULL) ||
+        (!dlna_src_range_request (dlna_src, &sock, start_byte, end_byte - 1,
+                chunk_data) &&
+            !dlna_src_range_request (dlna_src, &sock, start_byte,
+                end_byte - 1, chunk_data))) {
+      g_free (chunk_data);
+      reverse->failed = TRUE;
+      break;
+    }
+    GST_LOG_OBJECT (dlna_src, "Fetched reverse chunk %" G_GUINT64_FORMAT
+        "-%" G_GUINT64_FORMAT, start_byte, end_byte - 1);
+
+    chunk = gst_buffer_new_wrapped (chunk_data, end_byte - start_byte);
+    GST_BUFFER_OFFSET (chunk) = start_byte;
+    GST_BUFFER_OFFSET_END (chunk) = end_byte;
+    GST_BUFFER_FLAG_SET (chunk, GST_BUFFER_FLAG_DISCONT);
+    g_async_queue_push (reverse->chunks, chunk);
+
+    end_byte = start_byte;
+  }
+
+  if (sock >= 0)
+    dlna_src_close_socket (dlna_src, &sock);
+
+  // Marks end of chunks for pushing thread
+  g_async_queue_push (reverse->chunks, reverse);
+
+  return NULL;
+}
+
+/*********************************************/
+/**********                         **********/
+/********** SEAMLESS RATE SWITCHING **********/
+/**********                         **********/
+/*********************************************/
+
+/**
+ * Determines if change to supplied rate can be made by opening transfer of
+ * new rate alongside current one.  Transfer of new rate is read directly so
+ * this is limited to transport streams which are not link protected, whose
+ * key frames can be located.  Flushing seeks discard data which is flowing
+ * so they are never seamless.
+ *
+ * @param	dlna_src	this element
+ * @param	rate		requested rate
+ * @param	flags		flags of seek
+ * @param	start		position of rate change
+ *
+ * @return	true if rate is switched seamlessly, false otherwise
+ */
+static gboolean
+dlna_src_is_rate_switch_seamless (GstDlnaSrc * dlna_src, gdouble rate,
+    GstSeekFlags flags, gint64 start)
+{
+  if (!dlna_src->seamless_rate_switch || dlna_src->pull_mode ||
+      (flags & GST_SEEK_FLAG_FLUSH) ||
+      (dlna_src->trick_thread != NULL) || (start < 0) ||
+      (rate == dlna_src->requested_rate))
+    return FALSE;
+
+  if ((dlna_src->ts_packet_size == 0) || dlna_src_is_link_protected (dlna_src))
+    return FALSE;
+
+  if ((rate != 1.0) && !dlna_src_is_rate_supported (dlna_src, rate))
+    return FALSE;
+
+  // Some transfer must be flowing to overlap with
+  return (dlna_src->rate_switch != NULL) ||
+      (GST_STATE (dlna_src->http_src) == GST_STATE_PLAYING);
+}
+
+/**
+ * Starts thread which opens transfer of new rate and takes over from current
+ * transfer once it reaches a key frame.  Rate switch which has not switched
+ * over yet is superseded by the new one.
+ *
+ * @param	dlna_src	this element
+ * @param	rate		new rate
+ * @param	format		format of start position
+ * @param	start		position of rate change
+ * @param	seqnum		sequence number of seek
+ *
+ * @return	true if rate switch was started, false otherwise
+ */
+static gboolean
+dlna_src_rate_switch_start (GstDlnaSrc * dlna_src, gdouble rate,
+    GstFormat format, gint64 start, guint32 seqnum)
+{
+  GstDlnaSrcRateSwitch *rate_switch = NULL;
+  guint64 start_byte = 0;
+
+  // Time based positions are requested in bytes if server has no time seek
+  // support
+  if ((format == GST_FORMAT_TIME) &&
+      ((dlna_src->server_info->content_features == NULL) ||
+          (!dlna_src->server_info->content_features->op_time_seek_supported))) {
+    if (!dlna_src_time_to_bytes (dlna_src, start, FALSE, &start_byte))
+      return FALSE;
+    format = GST_FORMAT_BYTES;
+    start = start_byte;
+  }
+  // Current transfer has moved on since position of seek was queried, new
+  // one continues from data last passed on where that is known
+  g_mutex_lock (&dlna_src->event_mutex);
+  if ((format == GST_FORMAT_TIME) &&
+      GST_CLOCK_TIME_IS_VALID (dlna_src->last_pushed_time))
+    start = dlna_src->last_pushed_time;
+  else if ((format == GST_FORMAT_BYTES) &&
+      (dlna_src->last_pushed_offset != GST_BUFFER_OFFSET_NONE))
+    start = dlna_src->last_pushed_offset;
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  if (format == GST_FORMAT_BYTES)
+    start -= start % dlna_src->ts_packet_size;
+
+  GST_INFO_OBJECT (dlna_src, "Switching to rate %3.1f at %s %" G_GINT64_FORMAT,
+      rate, gst_format_get_name (format), start);
+
+  rate_switch = g_slice_new0 (GstDlnaSrcRateSwitch);
+  rate_switch->dlna_src = dlna_src;
+  rate_switch->previous = dlna_src->rate_switch;
+  rate_switch->rate = rate;
+  rate_switch->format = format;
+  rate_switch->start = start;
+  rate_switch->seqnum = seqnum;
+  rate_switch->keyframe_pid = -1;
+  g_atomic_int_set (&rate_switch->running, TRUE);
+
+  rate_switch->thread = g_thread_try_new ("dlnasrc-switch",
+      dlna_src_rate_switch_thread, rate_switch, NULL);
+  if (rate_switch->thread == NULL) {
+    GST_WARNING_OBJECT (dlna_src, "Unable to start rate switch thread");
+    g_slice_free (GstDlnaSrcRateSwitch, rate_switch);
+    return FALSE;
+  }
+  dlna_src->rate_switch = rate_switch;
+
+  return TRUE;
+}
+
+/**
+ * Stops latest rate switch if any, which stops the switches it superseded.
+ *
+ * @param	dlna_src	this element
+ * @param	flush		true to flush downstream so a blocked push returns,
+ * 						false if pads are inactive already
+ */
+static void
+dlna_src_rate_switch_stop (GstDlnaSrc * dlna_src, gboolean flush)
+{
+  GstDlnaSrcRateSwitch *rate_switch = dlna_src->rate_switch;
+
+  if (rate_switch == NULL)
+    return;
+
+  GST_INFO_OBJECT (dlna_src, "Stopping rate switch");
+
+  dlna_src->rate_switch = NULL;
+  g_atomic_int_set (&rate_switch->running, FALSE);
+  g_mutex_lock (&dlna_src->event_mutex);
+  dlna_src->rate_switch_pusher = NULL;
+  g_mutex_unlock (&dlna_src->event_mutex);
+  if (flush) {
+    gst_pad_push_event (dlna_src->src_pad, gst_event_new_flush_start ());
+  }
+
+  dlna_src_rate_switch_free (rate_switch);
+
+  if (flush)
+    gst_pad_push_event (dlna_src->src_pad, gst_event_new_flush_stop (TRUE));
+}
+
+/**
+ * Stops thread of rate switch and frees it.
+ *
+ * @param	rate_switch		rate switch to free
+ */
+static void
+dlna_src_rate_switch_free (GstDlnaSrcRateSwitch * rate_switch)
+{
+  g_atomic_int_set (&rate_switch->running, FALSE);
+  g_thread_join (rate_switch->thread);
+  g_slice_free (GstDlnaSrcRateSwitch, rate_switch);
+}
+
+/**
+ * Reads transfer of new rate, dropping packets until its first key frame.
+ * Thread pushing transfer which was flowing then switches over to new rate,
+ * after which that transfer is stopped and data of new rate is pushed in its
+ * place.  If transfer of new rate can not be opened current transfer keeps
+ * flowing.
+ *
+ * @param	data	rate switch
+ *
+ * @return	NULL
+ */
+static gpointer
+dlna_src_rate_switch_thread (gpointer data)
+{
+  GstDlnaSrcRateSwitch *rate_switch = data;
+  GstDlnaSrc *dlna_src = rate_switch->dlna_src;
+  GstBuffer *buf = NULL;
+  GstEvent *event = NULL;
+  GstFlowReturn flow = GST_FLOW_OK;
+  guint packet_size = dlna_src->ts_packet_size;
+  guint8 *pending = g_malloc (RATE_SWITCH_READ_SIZE);
+  gsize filled = 0;
+  gsize usable = 0;
+  gsize keep = 0;
+  gssize skip = 0;
+  gssize cnt = 0;
+  gboolean synced = FALSE;
+  gboolean switched = FALSE;
+  gboolean first = FALSE;
+  gboolean ended = FALSE;
+  gint sock = -1;
+
+  if (!dlna_src_rate_switch_request (dlna_src, rate_switch, &sock, pending,
+          &filled)) {
+    if (g_atomic_int_get (&rate_switch->running))
+      GST_WARNING_OBJECT (dlna_src, "Unable to open transfer at rate %3.1f, "
+          "keeping current transfer", rate_switch->rate);
+    goto done;
+  }
+
+  while (g_atomic_int_get (&rate_switch->running) && (flow == GST_FLOW_OK)) {
+    if (filled < RATE_SWITCH_READ_SIZE) {
+      cnt = dlna_src_rate_switch_read (rate_switch, sock, pending + filled,
+          RATE_SWITCH_READ_SIZE - filled);
+      if (cnt <= 0) {
+        ended = (cnt == 0);
+        break;
+      }
+      filled += cnt;
+    }
+    // Transfer of new rate need not start on a packet
+    if (!synced) {
+      skip = dlna_src_ts_find_sync (pending, filled, packet_size, &keep);
+      if (skip < 0) {
+        memmove (pending, pending + keep, filled - keep);
+        filled -= keep;
+        continue;
+      }
+      memmove (pending, pending + skip, filled - skip);
+      filled -= skip;
+      synced = TRUE;
+    }
+    usable = filled - filled % packet_size;
+    if (usable == 0)
+      continue;
+
+    // Packets ahead of first key frame of new transfer are not wanted
+    if (!switched) {
+      skip = dlna_src_rate_switch_find_keyframe (dlna_src, rate_switch,
+          pending, usable);
+      if (skip < 0) {
+        memmove (pending, pending + usable, filled - usable);
+        filled -= usable;
+        continue;
+      }
+      memmove (pending, pending + skip, filled - skip);
+      filled -= skip;
+      usable -= skip;
+
+      if (!dlna_src_rate_switch_hand_over (dlna_src, rate_switch))
+        break;
+      switched = TRUE;
+      first = TRUE;
+
+      // Transfer switched over from is no longer passed on
+      if (rate_switch->previous != NULL) {
+        dlna_src_rate_switch_free (rate_switch->previous);
+        rate_switch->previous = NULL;
+      }
+      gst_element_set_state (dlna_src->http_src, GST_STATE_READY);
+
+      // Transfer restarted later must not reuse range of souphttpsrc
+      dlna_src->range_headers_set = TRUE;
+    }
+
+    buf = gst_buffer_new_allocate (NULL, usable, NULL);
+    gst_buffer_fill (buf, 0, pending, usable);
+    memmove (pending, pending + usable, filled - usable);
+    filled -= usable;
+
+    // Tables let decoder start on key frame of new transfer right away
+    if (first) {
+      g_mutex_lock (&dlna_src->event_mutex);
+      buf = dlna_src_psi_inject (dlna_src, buf);
+      g_mutex_unlock (&dlna_src->event_mutex);
+      GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
+      first = FALSE;
+    }
+    flow = gst_pad_push (dlna_src->src_pad, buf);
+  }
+
+  if (!ended && switched && (flow == GST_FLOW_OK) &&
+      g_atomic_int_get (&rate_switch->running))
+    GST_ELEMENT_ERROR (dlna_src, RESOURCE, READ, (NULL),
+        ("Problems receiving transfer at rate %3.1f", rate_switch->rate));
+
+  if (ended && switched && g_atomic_int_get (&rate_switch->running)) {
+    GST_INFO_OBJECT (dlna_src, "Transfer at rate %3.1f reached its end",
+        rate_switch->rate);
+    event = gst_event_new_eos ();
+    gst_event_set_seqnum (event, rate_switch->seqnum);
+    gst_pad_push_event (dlna_src->src_pad, event);
+  }
+
+done:
+  if (sock >= 0)
+    dlna_src_close_socket (dlna_src, &sock);
+  g_free (pending);
+
+  // Transfer which was not switched over from keeps flowing until this rate
+  // switch is stopped
+  while (!switched && (rate_switch->previous != NULL) &&
+      g_atomic_int_get (&rate_switch->running))
+    g_usleep (RATE_SWITCH_POLL_MS * 1000);
+
+  if (rate_switch->previous != NULL) {
+    dlna_src_rate_switch_free (rate_switch->previous);
+    rate_switch->previous = NULL;
+  }
+
+  return NULL;
+}
+
+/**
+ * Opens transfer of new rate on a connection of its own, using the headers
+ * souphttpsrc would be given.  HTTP/1.0 is used so body is not chunked and
+ * ends when connection is closed.
+ *
+ * @param	dlna_src	this element
+ * @param	rate_switch	rate switch to open transfer of
+ * @param	sock		connection opened
+ * @param	data		storage for start of body received along with headers,
+ * 						at least MAX_HTTP_BUF_SIZE bytes
+ * @param	filled		number of body bytes stored
+ *
+ * @return	true if transfer was opened, false otherwise
+ */
+static gboolean
+dlna_src_rate_switch_request (GstDlnaSrc * dlna_src,
+    GstDlnaSrcRateSwitch * rate_switch, gint * sock, guint8 * data,
+    gsize * filled)
+{
+  GstStructure *headers = NULL;
+  GString *request = NULL;
+  const gchar *name = NULL;
+  gchar response_str[MAX_HTTP_BUF_SIZE + 1] = { 0 };
+  gchar *body = NULL;
+  gsize header_len = 0;
+  gssize cnt = 0;
+  gint ret_code = 0;
+  gint i = 0;
+
+  if (!dlna_src_formulate_extra_headers (dlna_src, rate_switch->rate,
+          rate_switch->format, rate_switch->start, -1, &headers))
+    return FALSE;
+
+  request = g_string_new (NULL);
+  g_string_append_printf (request, "GET %s HTTP/1.0%sHOST: %s:%d%s",
+      dlna_src->uri, CRLF, dlna_src->uri_addr, dlna_src->uri_port, CRLF);
+  for (i = 0; i < gst_structure_n_fields (headers); i++) {
+    name = gst_structure_nth_field_name (headers, i);
+    g_string_append_printf (request, "%s: %s%s", name,
+        gst_structure_get_string (headers, name), CRLF);
+  }
+  g_string_append (request, CRLF);
+  gst_structure_free (headers);
+
+  if (!dlna_src_open_socket (dlna_src, sock)) {
+    GST_WARNING_OBJECT (dlna_src, "Problems creating socket for rate switch");
+    g_string_free (request, TRUE);
+    return FALSE;
+  }
+
+  GST_LOG_OBJECT (dlna_src, "Issuing rate switch request: %s", request->str);
+  if (send (*sock, request->str, request->len, MSG_NOSIGNAL) !=
+      (gssize) request->len) {
+    GST_WARNING_OBJECT (dlna_src, "Problems sending rate switch request");
+    g_string_free (request, TRUE);
+    return FALSE;
+  }
+  g_string_free (request, TRUE);
+
+  // Read until end of response headers
+  while ((body = strstr (response_str, "\r\n\r\n")) == NULL) {
+    if (header_len >= MAX_HTTP_BUF_SIZE) {
+      GST_WARNING_OBJECT (dlna_src, "Rate switch response headers too large");
+      return FALSE;
+    }
+    cnt = dlna_src_rate_switch_read (rate_switch, *sock,
+        (guint8 *) response_str + header_len, MAX_HTTP_BUF_SIZE - header_len);
+    if (cnt <= 0)
+      return FALSE;
+    header_len += cnt;
+    response_str[header_len] = '\0';
+  }
+  body += strlen ("\r\n\r\n");
+
+  if ((sscanf (response_str, "%*s %d", &ret_code) != 1) ||
+      ((ret_code != HTTP_STATUS_OK) && (ret_code != HTTP_STATUS_PARTIAL))) {
+    GST_WARNING_OBJECT (dlna_src, "Unexpected rate switch response code: %d",
+        ret_code);
+    return FALSE;
+  }
+  // Part of body may have arrived along with headers
+  *filled = header_len - (body - response_str);
+  memcpy (data, body, *filled);
+
+  return TRUE;
+}
+
+/**
+ * Receives data of transfer opened for rate switch, waking up regularly to
+ * notice rate switch being stopped.
+ *
+ * @param	rate_switch		rate switch transfer belongs to
+ * @param	sock			connection of transfer
+ * @param	data			storage for data received
+ * @param	size			size of storage
+ *
+ * @return	number of bytes received, 0 at end of transfer, -1 on problems or
+ * 			if rate switch was stopped
+ */
+static gssize
+dlna_src_rate_switch_read (GstDlnaSrcRateSwitch * rate_switch, gint sock,
+    guint8 * data, gsize size)
+{
+  struct pollfd pfd;
+  gint ret = 0;
+
+  pfd.fd = sock;
+  pfd.events = POLLIN;
+  while (g_atomic_int_get (&rate_switch->running)) {
+    ret = poll (&pfd, 1, RATE_SWITCH_POLL_MS);
+    if ((ret < 0) && (errno != EINTR))
+      return -1;
+    if (ret > 0)
+      return recv (sock, data, size, 0);
+  }
+  return -1;
+}
+
+/**
+ * Looks for first packet of a key frame of video stream among packets of
+ * transfer opened for rate switch.  Tables are kept along the way, while
+ * state of key frame filter on packets passing src pad is swapped with that
+ * of the rate switch so neither transfer disturbs the other.
+ *
+ * @param	dlna_src	this element
+ * @param	rate_switch	rate switch packets belong to
+ * @param	data		packets starting on a packet
+ * @param	size		size of whole packets
+ *
+ * @return	offset of key frame packet, -1 if there is none
+ */
+static gssize
+dlna_src_rate_switch_find_keyframe (GstDlnaSrc * dlna_src,
+    GstDlnaSrcRateSwitch * rate_switch, const guint8 * data, gsize size)
+{
+  const guint8 *ts = NULL;
+  guint packet_size = dlna_src->ts_packet_size;
+  guint sync = packet_size - TS_PACKET_SIZE;
+  gboolean passing = FALSE;
+  gboolean found = FALSE;
+  gsize pos = 0;
+  gint keyframe_pid = 0;
+  gint pid = 0;
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  keyframe_pid = dlna_src->keyframe_pid;
+  passing = dlna_src->keyframe_passing;
+  dlna_src->keyframe_pid = rate_switch->keyframe_pid;
+  dlna_src->keyframe_passing = FALSE;
+  for (pos = 0; !found && (pos + packet_size <= size); pos += packet_size) {
+    ts = data + pos + sync;
+    if (ts[0] != TS_SYNC_BYTE)
+      continue;
+
+    dlna_src_psi_capture (dlna_src, data + pos, packet_size);
+    pid = ((ts[1] & 0x1f) << 8) | ts[2];
+    if ((pid == 0) || (pid == dlna_src->pmt_pid) || ((ts[1] & 0x40) == 0))
+      continue;
+
+    found = dlna_src_keyframe_packet (dlna_src, ts) &&
+        (pid == dlna_src->keyframe_pid);
+  }
+  rate_switch->keyframe_pid = dlna_src->keyframe_pid;
+  dlna_src->keyframe_pid = keyframe_pid;
+  dlna_src->keyframe_passing = passing;
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  return found ? (gssize) (pos - packet_size) : -1;
+}
+
+/**
+ * Waits until thread pushing transfer which has been flowing, be it that of
+ * souphttpsrc or of a previous rate switch, has switched over to transfer of
+ * supplied rate switch.  Switching over on that thread keeps segment of new
+ * rate from racing data of transfer it replaces.
+ *
+ * @param	dlna_src	this element
+ * @param	rate_switch	rate switch which takes over
+ *
+ * @return	true once switched over, false if rate switch was stopped first
+ */
+static gboolean
+dlna_src_rate_switch_hand_over (GstDlnaSrc * dlna_src,
+    GstDlnaSrcRateSwitch * rate_switch)
+{
+  gboolean switched = FALSE;
+
+  GST_INFO_OBJECT (dlna_src, "Handing over to transfer at rate %3.1f",
+      rate_switch->rate);
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  rate_switch->pusher = g_thread_self ();
+  dlna_src->rate_switch_ready = rate_switch;
+  while (!rate_switch->switched_over &&
+      (g_atomic_int_get (&rate_switch->running) || rate_switch->taking_over))
+    g_cond_wait_until (&dlna_src->rate_switch_cond, &dlna_src->event_mutex,
+        g_get_monotonic_time () + RATE_SWITCH_POLL_MS * G_TIME_SPAN_MILLISECOND);
+  if (dlna_src->rate_switch_ready == rate_switch)
+    dlna_src->rate_switch_ready = NULL;
+  switched = rate_switch->switched_over;
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  return switched;
+}
+
+/**
+ * Switches over to transfer of rate switch waiting to take over, if any, on
+ * thread pushing data through src pad.  Segment of new rate continues from
+ * running time of data last passed on, else from running time of the clock,
+ * so switch is not taken for a jump.  Once switched over, data, segments and
+ * end of stream of any thread but that of new transfer are dropped.
+ *
+ * @param	dlna_src	this element
+ * @param	info		data or event passing src pad
+ *
+ * @return	true if data or event is to be dropped, false if it is to be
+ * 			passed on
+ */
+static gboolean
+dlna_src_rate_switch_take_over (GstDlnaSrc * dlna_src, GstPadProbeInfo * info)
+{
+  GstDlnaSrcRateSwitch *rate_switch = NULL;
+  GstSegment segment;
+  GstEvent *event = NULL;
+  GstClock *clock = NULL;
+  GstClockTime now = 0;
+  GstClockTime base_time = 0;
+  GstClockTime running_time = GST_CLOCK_TIME_NONE;
+  GThread *self = g_thread_self ();
+  gboolean end = FALSE;
+
+  if (info->type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+    event = GST_PAD_PROBE_INFO_EVENT (info);
+    if ((GST_EVENT_TYPE (event) != GST_EVENT_EOS) &&
+        (GST_EVENT_TYPE (event) != GST_EVENT_SEGMENT))
+      return FALSE;
+    end = (GST_EVENT_TYPE (event) == GST_EVENT_EOS);
+  }
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  if ((dlna_src->rate_switch_pusher != NULL) &&
+      (dlna_src->rate_switch_pusher != self)) {
+    g_mutex_unlock (&dlna_src->event_mutex);
+    return TRUE;
+  }
+  // Switch is made on data or end of transfer switched over from
+  rate_switch = dlna_src->rate_switch_ready;
+  if ((rate_switch == NULL) || rate_switch->taking_over ||
+      (rate_switch->pusher == self) || ((event != NULL) && !end)) {
+    g_mutex_unlock (&dlna_src->event_mutex);
+    return FALSE;
+  }
+
+  GST_INFO_OBJECT (dlna_src, "Switching over to transfer at rate %3.1f",
+      rate_switch->rate);
+
+  gst_segment_init (&segment, rate_switch->format);
+  segment.rate = rate_switch->rate;
+  segment.start = rate_switch->start;
+  segment.time = rate_switch->start;
+  segment.position = rate_switch->start;
+
+  if ((dlna_src->segment.format == GST_FORMAT_TIME) &&
+      GST_CLOCK_TIME_IS_VALID (dlna_src->last_pushed_time))
+    running_time = gst_segment_to_running_time (&dlna_src->segment,
+        GST_FORMAT_TIME, dlna_src->last_pushed_time);
+  if (GST_CLOCK_TIME_IS_VALID (running_time)) {
+    segment.base = running_time;
+  } else {
+    clock = gst_element_get_clock (GST_ELEMENT (dlna_src));
+    if (clock != NULL) {
+      now = gst_clock_get_time (clock);
+      base_time = gst_element_get_base_time (GST_ELEMENT (dlna_src));
+      if (now > base_time)
+        segment.base = now - base_time;
+      gst_object_unref (clock);
+    }
+  }
+  dlna_src->rate = rate_switch->rate;
+  dlna_src->segment = segment;
+  dlna_src->segment_pending = FALSE;
+  dlna_src->byte_offset = 0;
+  dlna_src->offsets_known = FALSE;
+  dlna_src_ts_sync_reset (dlna_src, FALSE);
+  dlna_src->last_pushed_offset = GST_BUFFER_OFFSET_NONE;
+  dlna_src->last_pushed_time = GST_CLOCK_TIME_NONE;
+  dlna_src_keyframe_reset (dlna_src);
+  rate_switch->taking_over = TRUE;
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  event = gst_event_new_segment (&segment);
+  gst_event_set_seqnum (event, rate_switch->seqnum);
+  gst_pad_push_event (dlna_src->src_pad, event);
+
+  // Data of new rate follows its segment, unless rate switch was stopped
+  // meanwhile
+  g_mutex_lock (&dlna_src->event_mutex);
+  if (g_atomic_int_get (&rate_switch->running)) {
+    dlna_src->rate_switch_pusher = rate_switch->pusher;
+    rate_switch->switched_over = TRUE;
+  }
+  rate_switch->taking_over = FALSE;
+  g_cond_broadcast (&dlna_src->rate_switch_cond);
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  return TRUE;
+}
+
+/*********************************************/
+/**********                         **********/
+/**********  LIVE EDGE REFRESHING   **********/
+/**********                         **********/
+/*********************************************/
+
+/**
+ * Determines if content described by HEAD response is still growing, such as
+ * a recording in progress.
+ *
+ * @param	info	HEAD response
+ *
+ * @return	true if content is growing, false otherwise
+ */
+static gboolean
+dlna_src_is_content_growing (GstDlnaSrcHeadResponse * info)
+{
+  if ((info == NULL) || (info->content_features == NULL))
+    return FALSE;
+
+  return info->content_features->flag_so_increasing_set ||
+      info->content_features->flag_sn_increasing_set;
+}
+
+/**
+ * Starts refreshing ranges of growing content in background, with live edge
+ * taken from HEAD response of uri to begin with.
+ *
+ * @param	dlna_src	this element
+ */
+static void
+dlna_src_refresh_start (GstDlnaSrc * dlna_src)
+{
+  if (!dlna_src_is_content_growing (dlna_src->server_info) ||
+      (dlna_src->range_refresh_seconds == 0) ||
+      (dlna_src->refresh_thread != NULL))
+    return;
+
+  dlna_src_live_edge_update (dlna_src, dlna_src->server_info);
+
+  dlna_src->refresh_thread_stop = FALSE;
+  dlna_src->refresh_thread = g_thread_try_new ("dlnasrc-refresh",
+      dlna_src_refresh_thread, dlna_src, NULL);
+  if (dlna_src->refresh_thread == NULL)
+    GST_WARNING_OBJECT (dlna_src, "Unable to start range refresh thread");
+}
+
+/**
+ * Stops refreshing ranges of growing content.
+ *
+ * @param	dlna_src	this element
+ */
+static void
+dlna_src_refresh_stop (GstDlnaSrc * dlna_src)
+{
+  if (dlna_src->refresh_thread == NULL)
+    return;
+
+  g_mutex_lock (&dlna_src->refresh_mutex);
+  dlna_src->refresh_thread_stop = TRUE;
+  g_cond_signal (&dlna_src->refresh_cond);
+  g_mutex_unlock (&dlna_src->refresh_mutex);
+
+  g_thread_join (dlna_src->refresh_thread);
+  dlna_src->refresh_thread = NULL;
+}
+
+/**
+ * Thread which issues a HEAD request once per refresh interval and updates
+ * ranges of growing content from it.  Refreshing ends once content is no
+ * longer growing.
+ *
+ * @param	data	this element
+ *
+ * @return	NULL
+ */
+static gpointer
+dlna_src_refresh_thread (gpointer data)
+{
+  GstDlnaSrc *dlna_src = GST_DLNA_SRC (data);
+  GstDlnaSrcHeadResponse *info = NULL;
+  gboolean growing = TRUE;
+  gint64 next = 0;
+
+  g_mutex_lock (&dlna_src->refresh_mutex);
+
+  // Growth rates need a second sample, which low latency mode takes early
+  if (dlna_src_is_low_latency (dlna_src) && !dlna_src->live_rates_known &&
+      (dlna_src->range_refresh_seconds > LIVE_EDGE_FIRST_REFRESH_SECONDS))
+    next = g_get_monotonic_time () +
+        LIVE_EDGE_FIRST_REFRESH_SECONDS * G_TIME_SPAN_SECOND;
+  else
+    next = g_get_monotonic_time () +
+        dlna_src->range_refresh_seconds * G_TIME_SPAN_SECOND;
+  while (!dlna_src->refresh_thread_stop && growing) {
+    // Interval may have been changed, or refreshing disabled, meanwhile
+    if ((dlna_src->range_refresh_seconds == 0) ||
+        (g_get_monotonic_time () < next)) {
+      if (dlna_src->range_refresh_seconds == 0)
+        g_cond_wait (&dlna_src->refresh_cond, &dlna_src->refresh_mutex);
+      else
+        g_cond_wait_until (&dlna_src->refresh_cond, &dlna_src->refresh_mutex,
+            MIN (next, g_get_monotonic_time () +
+                dlna_src->range_refresh_seconds * G_TIME_SPAN_SECOND));
+      continue;
+    }
+    g_mutex_unlock (&dlna_src->refresh_mutex);
+
+    info = NULL;
+    if (dlna_src_head_request (dlna_src, 0, 0, TRUE, &info)) {
+      dlna_src_live_edge_update (dlna_src, info);
+      growing = dlna_src_is_content_growing (info);
+    } else {
+      GST_WARNING_OBJECT (dlna_src, "Unable to refresh ranges of content");
+    }
+    if (info != NULL)
+      dlna_src_head_response_free (dlna_src, info);
+
+    g_mutex_lock (&dlna_src->refresh_mutex);
+    next = g_get_monotonic_time () +
+        dlna_src->range_refresh_seconds * G_TIME_SPAN_SECOND;
+  }
+
+  g_mutex_unlock (&dlna_src->refresh_mutex);
+
+  if (!growing)
+    GST_INFO_OBJECT (dlna_src, "Content is no longer growing");
+
+  return NULL;
+}
+
+/**
+ * Takes live edge from supplied HEAD response and updates growth rates from
+ * progress since previous one.  Ranges of server info are updated so that
+ * conversions and range requests see content grown.  Growth stops being
+ * extrapolated once content is no longer growing.
+ *
+ * @param	dlna_src	this element
+ * @param	info		HEAD response of uri
+ */
+static void
+dlna_src_live_edge_update (GstDlnaSrc * dlna_src,
+    GstDlnaSrcHeadResponse * info)
+{
+  GstDlnaSrcHeadResponse *server_info = NULL;
+  gint64 now = g_get_monotonic_time ();
+  gint64 elapsed = 0;
+  guint64 time = 0;
+  guint64 bytes = 0;
+  gdouble time_rate = 0.0;
+  gdouble byte_rate = 0.0;
+
+  // Window announced for seeking is closest to live edge
+  if (info->available_seek_npt_received)
+    time = info->available_seek_npt_end;
+  else if (info->time_seek_response_received)
+    time = MAX (info->time_seek_npt_end, info->time_seek_npt_duration);
+
+  if (info->available_seek_bytes_received)
+    bytes = info->available_seek_byte_end + 1;
+  else if (info->time_seek_response_received && (info->byte_seek_end > 0))
+    bytes = MAX (info->byte_seek_end + 1, info->byte_seek_total);
+  else
+    bytes = info->content_length;
+
+  if ((time == 0) && (bytes == 0))
+    return;
+
+  g_mutex_lock (&dlna_src->event_mutex);
+
+  elapsed = now - dlna_src->live_edge_sampled;
+  if (dlna_src->live_edge_known && (elapsed > 0) &&
+      (time >= dlna_src->live_edge_time) &&
+      (bytes >= dlna_src->live_edge_bytes)) {
+    time_rate = (gdouble) (time - dlna_src->live_edge_time) /
+        (elapsed * 1000.0);
+    byte_rate = (gdouble) (bytes - dlna_src->live_edge_bytes) *
+        G_TIME_SPAN_SECOND / elapsed;
+
+    // Rates are smoothed so that a late response does not skew them
+    if (dlna_src->live_rates_known) {
+      time_rate = dlna_src->live_time_rate +
+          LIVE_EDGE_SMOOTHING * (time_rate - dlna_src->live_time_rate);
+      byte_rate = dlna_src->live_byte_rate +
+          LIVE_EDGE_SMOOTHING * (byte_rate - dlna_src->live_byte_rate);
+    }
+    dlna_src->live_time_rate = time_rate;
+    dlna_src->live_byte_rate = byte_rate;
+    dlna_src->live_rates_known = TRUE;
+  }
+  if (!dlna_src_is_content_growing (info)) {
+    dlna_src->live_time_rate = 0.0;
+    dlna_src->live_byte_rate = 0.0;
+  }
+  dlna_src->live_edge_known = TRUE;
+  dlna_src->live_edge_sampled = now;
+  dlna_src->live_edge_time = time;
+  dlna_src->live_edge_bytes = bytes;
+
+  GST_DEBUG_OBJECT (dlna_src, "Live edge at %" GST_TIME_FORMAT ", byte %"
+      G_GUINT64_FORMAT ", growing %f s/s, %f bytes/s", GST_TIME_ARGS (time),
+      bytes, dlna_src->live_time_rate, dlna_src->live_byte_rate);
+
+  // Ranges grown are published as a new snapshot of server info, readers
+  // which load server info once see one snapshot throughout
+  if ((info != dlna_src->server_info) && (dlna_src->server_info != NULL)) {
+    server_info = dlna_src_head_response_copy (dlna_src->server_info);
+    if (info->available_seek_npt_received) {
+      server_info->available_seek_npt_received = TRUE;
+      server_info->available_seek_npt_start = info->available_seek_npt_start;
+      server_info->available_seek_npt_end = info->available_seek_npt_end;
+    }
+    if (info->available_seek_bytes_received) {
+      server_info->available_seek_bytes_received = TRUE;
+      server_info->available_seek_byte_start =
+          info->available_seek_byte_start;
+      server_info->available_seek_byte_end = info->available_seek_byte_end;
+    }
+    if (info->time_seek_response_received) {
+      server_info->time_seek_npt_end = info->time_seek_npt_end;
+      server_info->time_seek_npt_duration = info->time_seek_npt_duration;
+      server_info->byte_seek_end = info->byte_seek_end;
+      server_info->byte_seek_total = info->byte_seek_total;
+    }
+    if (info->content_length > 0)
+      server_info->content_length = info->content_length;
+    dlna_src_server_info_swap (dlna_src, server_info);
+  }
+
+  g_mutex_unlock (&dlna_src->event_mutex);
+}
+
+/**
+ * Extrapolates live edge of growing content from last refresh using growth
+ * rates observed so far.
+ *
+ * @param	dlna_src	this element
+ * @param	time		media time of live edge
+ * @param	bytes		size of content at live edge
+ *
+ * @return	true if content is growing and live edge is known, false otherwise
+ */
+static gboolean
+dlna_src_live_edge_get (GstDlnaSrc * dlna_src, guint64 * time,
+    guint64 * bytes)
+{
+  gboolean known = FALSE;
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  known = dlna_src_live_edge_extrapolate (dlna_src, time, bytes);
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  return known;
+}
+
+/**
+ * Extrapolates live edge of growing content, called with event mutex held.
+ *
+ * @param	dlna_src	this element
+ * @param	time		media time of live edge
+ * @param	bytes		size of content at live edge
+ *
+ * @return	true if content is growing and live edge is known, false otherwise
+ */
+static gboolean
+dlna_src_live_edge_extrapolate (GstDlnaSrc * dlna_src, guint64 * time,
+    guint64 * bytes)
+{
+  gint64 elapsed = 0;
+
+  if (!dlna_src->live_edge_known ||
+      !dlna_src_is_content_growing (dlna_src->server_info))
+    return FALSE;
+
+  elapsed = g_get_monotonic_time () - dlna_src->live_edge_sampled;
+  *time = dlna_src->live_edge_time +
+      dlna_src->live_time_rate * elapsed * 1000.0;
+  *bytes = dlna_src->live_edge_bytes +
+      dlna_src->live_byte_rate * elapsed / G_TIME_SPAN_SECOND;
+
+  return TRUE;
+}
+
+/**
+ * Determines if content is played in low latency mode, which applies to live
+ * content only, either growing or paced by server.
+ *
+ * @param	dlna_src	this element
+ *
+ * @return	true if content is played in low latency mode, false otherwise
+ */
+static gboolean
+dlna_src_is_low_latency (GstDlnaSrc * dlna_src)
+{
+  if ((dlna_src->live_latency == 0) || (dlna_src->server_info == NULL) ||
+      (dlna_src->server_info->content_features == NULL))
+    return FALSE;
+
+  return dlna_src_is_content_growing (dlna_src->server_info) ||
+      dlna_src->server_info->content_features->flag_sender_paced_set;
+}
+
+/**
+ * Determines position target latency behind live edge at which live content
+ * is joined in low latency mode.  Time is used if server supports time seeks,
+ * bytes are estimated from growth of content otherwise.
+ *
+ * @param	dlna_src	this element
+ * @param	format		format of position, left untouched if unknown
+ * @param	start		position to join content at, left untouched if unknown
+ *
+ * @return	true if position is known, false otherwise
+ */
+static gboolean
+dlna_src_live_start_position (GstDlnaSrc * dlna_src, GstFormat * format,
+    guint64 * start)
+{
+  GstClockTime latency = dlna_src->live_latency * GST_MSECOND;
+  guint64 range_start = 0;
+  guint64 range_end = 0;
+  guint64 latency_bytes = 0;
+
+  if (!dlna_src_is_low_latency (dlna_src))
+    return FALSE;
+
+  if (!dlna_src->live_edge_known)
+    dlna_src_live_edge_update (dlna_src, dlna_src->server_info);
+
+  if ((dlna_src->server_info->content_features->op_time_seek_supported) &&
+      dlna_src_get_available_seek_range (dlna_src, GST_FORMAT_TIME,
+          &range_start, &range_end)) {
+    *format = GST_FORMAT_TIME;
+    *start = MAX (range_start, (range_end > latency) ? range_end - latency : 0);
+  } else if (dlna_src->server_info->accept_byte_ranges &&
+      dlna_src_get_available_seek_range (dlna_src, GST_FORMAT_BYTES,
+          &range_start, &range_end)) {
+    if (!dlna_src_time_to_bytes (dlna_src, latency, TRUE, &latency_bytes))
+      latency_bytes = PREFETCH_FALLBACK_BYTE_RATE * latency / GST_SECOND;
+    *format = GST_FORMAT_BYTES;
+    *start = MAX (range_start,
+        (range_end > latency_bytes) ? range_end - latency_bytes : 0);
+    if (dlna_src->ts_packet_size > 0)
+      *start -= *start % dlna_src->ts_packet_size;
+  } else {
+    return FALSE;
+  }
+
+  GST_INFO_OBJECT (dlna_src, "Joining live content at %s %" G_GUINT64_FORMAT
+      ", live edge at %" G_GUINT64_FORMAT, gst_format_get_name (*format),
+      *start, range_end);
+
+  return TRUE;
+}
+
+/**
+ * Requests transfer of new uri to start near live edge in low latency mode,
+ * using range headers of this element rather than restarting transfer.
+ *
+ * @param	dlna_src	this element
+ */
+static void
+dlna_src_live_start (GstDlnaSrc * dlna_src)
+{
+  GstStructure *extra_headers_struct = NULL;
+  GstFormat format = GST_FORMAT_BYTES;
+  guint64 start = 0;
+
+  if (!dlna_src_live_start_position (dlna_src, &format, &start) ||
+      !dlna_src_formulate_extra_headers (dlna_src, 1.0, format, start, -1,
+          &extra_headers_struct))
+    return;
+
+  dlna_src_set_range_headers (dlna_src, extra_headers_struct);
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  if (format == GST_FORMAT_TIME) {
+    gst_segment_init (&dlna_src->segment, GST_FORMAT_TIME);
+    dlna_src->segment.start = start;
+    dlna_src->segment.time = start;
+    dlna_src->segment.position = start;
+    dlna_src->segment_seqnum = gst_util_seqnum_next ();
+    dlna_src->segment_pending = TRUE;
+    dlna_src->offsets_known = FALSE;
+  } else {
+    dlna_src->byte_offset = start;
+    dlna_src->offsets_known = TRUE;
+  }
+  dlna_src_ts_sync_reset (dlna_src, TRUE);
+  dlna_src->live_pcr_anchored = FALSE;
+  dlna_src->live_pcr_pid = -1;
+  dlna_src->live_join_lag = dlna_src->live_latency * GST_MSECOND;
+  g_mutex_unlock (&dlna_src->event_mutex);
+}
+
+/**
+ * Measures lag of transport stream from last PCR of buffer.  First PCR
+ * after content was joined anchors the measurement at the lag content was
+ * joined at, later ones lag by however much less media time than wall
+ * clock time has passed since.  Called with event mutex held.
+ *
+ * @param	dlna_src	this element
+ * @param	buf			buffer passing src pad
+ * @param	lag			returned lag behind live edge
+ *
+ * @return	true if buffer carries a PCR, false otherwise
+ */
+static gboolean
+dlna_src_live_lag_pcr (GstDlnaSrc * dlna_src, GstBuffer * buf,
+    GstClockTime * lag)
+{
+  GstMapInfo map;
+  guint64 offset = GST_BUFFER_OFFSET (buf);
+  guint64 pcr = 0;
+  guint64 last_pcr = 0;
+  GstClockTime media = 0;
+  GstClockTime wall = 0;
+  guint packet_size = dlna_src->ts_packet_size;
+  guint sync = packet_size - TS_PACKET_SIZE;
+  gboolean found = FALSE;
+  gsize pos = 0;
+  gint pid = -1;
+
+  if ((packet_size == 0) || dlna_src->ts_resync ||
+      !GST_BUFFER_OFFSET_IS_VALID (buf) ||
+      !gst_buffer_map (buf, &map, GST_MAP_READ))
+    return FALSE;
+
+  pos = (packet_size + dlna_src->ts_phase - (offset % packet_size)) %
+      packet_size;
+  for (; pos + packet_size <= map.size; pos += packet_size) {
+    if (map.data[pos + sync] != TS_SYNC_BYTE)
+      break;
+    if (!dlna_src_pcr_parse (map.data + pos + sync, &pcr, &pid))
+      continue;
+    if (dlna_src->live_pcr_pid == -1)
+      dlna_src->live_pcr_pid = pid;
+    else if (pid != dlna_src->live_pcr_pid)
+      continue;
+    last_pcr = pcr;
+    found = TRUE;
+  }
+  gst_buffer_unmap (buf, &map);
+
+  if (!found)
+    return FALSE;
+
+  if (dlna_src->live_pcr_anchored) {
+    media = gst_util_uint64_scale ((last_pcr + PCR_WRAP -
+            dlna_src->live_pcr_anchor) % PCR_WRAP, 1000, 27);
+    wall = (g_get_monotonic_time () - dlna_src->live_wall_anchor) *
+        GST_USECOND;
+    if (media <= wall + dlna_src->live_join_lag + LIVE_PCR_MAX_LEAD) {
+      *lag = (wall + dlna_src->live_join_lag > media) ?
+          wall + dlna_src->live_join_lag - media : 0;
+      return TRUE;
+    }
+    GST_DEBUG_OBJECT (dlna_src, "PCR discontinuity, measuring lag anew");
+    dlna_src->live_join_lag = 0;
+  }
+
+  dlna_src->live_pcr_anchored = TRUE;
+  dlna_src->live_pcr_anchor = last_pcr;
+  dlna_src->live_wall_anchor = g_get_monotonic_time ();
+  *lag = dlna_src->live_join_lag;
+
+  return TRUE;
+}
+
+/**
+ * Measures lag of content as bytes behind live edge extrapolated from
+ * growth of content.  Called with event mutex held.
+ *
+ * @param	dlna_src	this element
+ * @param	buf			buffer passing src pad
+ * @param	lag			returned lag behind live edge
+ *
+ * @return	true if growth rate and live edge are known, false otherwise
+ */
+static gboolean
+dlna_src_live_lag_bytes (GstDlnaSrc * dlna_src, GstBuffer * buf,
+    GstClockTime * lag)
+{
+  guint64 edge_time = 0;
+  guint64 edge_bytes = 0;
+  guint64 end = 0;
+
+  if (!GST_BUFFER_OFFSET_IS_VALID (buf) || (dlna_src->live_byte_rate <= 0.0)
+      || !dlna_src_live_edge_extrapolate (dlna_src, &edge_time, &edge_bytes))
+    return FALSE;
+
+  end = GST_BUFFER_OFFSET (buf) + gst_buffer_get_size (buf);
+  *lag = (edge_bytes > end) ?
+      (GstClockTime) ((edge_bytes - end) * GST_SECOND /
+      dlna_src->live_byte_rate) : 0;
+
+  return TRUE;
+}
+
+/**
+ * Determines if buffer of live content lags behind live edge by more than
+ * target latency, in which case it is dropped until lag is down to half of
+ * target latency.  Content paced by sender arrives no faster than it plays,
+ * so dropping never brings its lag down, data is dropped for no longer than
+ * the lag in excess of target measured when dropping started and lag left
+ * then is taken as that content is joined at.  Lag is measured from PCRs of
+ * transport streams, else from growth of content.  Called with event mutex
+ * held.
+ *
+ * @param	dlna_src	this element
+ * @param	buf			buffer passing src pad
+ * @param	caught_up	set if buffer is first one kept after dropping
+ *
+ * @return	true if buffer is to be dropped, false otherwise
+ */
+static gboolean
+dlna_src_live_catch_up (GstDlnaSrc * dlna_src, GstBuffer * buf,
+    gboolean * caught_up)
+{
+  GstClockTime lag = 0;
+  GstClockTime target = dlna_src->live_latency * GST_MSECOND;
+
+  *caught_up = FALSE;
+  if (!dlna_src_is_low_latency (dlna_src))
+    return FALSE;
+
+  // Buffer without a measurement follows decision on previous one
+  if (!dlna_src_live_lag_pcr (dlna_src, buf, &lag) &&
+      !dlna_src_live_lag_bytes (dlna_src, buf, &lag)) {
+    if (dlna_src->live_catching_up)
+      dlna_src->live_dropped += gst_buffer_get_size (buf);
+    return dlna_src->live_catching_up;
+  }
+
+  if (!dlna_src->live_catching_up && (lag > target)) {
+    GST_INFO_OBJECT (dlna_src, "Lagging %" GST_TIME_FORMAT
+        " behind live edge, dropping data to catch up", GST_TIME_ARGS (lag));
+    dlna_src->live_catching_up = TRUE;
+    dlna_src->live_catch_up_end = g_get_monotonic_time () +
+        (lag - target) / GST_USECOND;
+  } else if (dlna_src->live_catching_up && ((lag <= target / 2) ||
+          (g_get_monotonic_time () >= dlna_src->live_catch_up_end))) {
+    GST_INFO_OBJECT (dlna_src, "Caught up with live edge after dropping %"
+        G_GUINT64_FORMAT " bytes, lagging %" GST_TIME_FORMAT,
+        dlna_src->live_dropped, GST_TIME_ARGS (lag));
+
+    // Lag which is left is measured from anew
+    if (lag > target / 2) {
+      dlna_src->live_pcr_anchored = FALSE;
+      dlna_src->live_join_lag = target;
+    }
+    dlna_src->live_catching_up = FALSE;
+    dlna_src->live_dropped = 0;
+    dlna_src_ts_sync_reset (dlna_src, TRUE);
+    *caught_up = TRUE;
+  }
+  if (dlna_src->live_catching_up)
+    dlna_src->live_dropped += gst_buffer_get_size (buf);
+
+  return dlna_src->live_catching_up;
+}
+
+/**
+ * Responds to latency query for live content in low latency mode with round
+ * trip time of last HEAD request as minimum latency, leaving room for target
+ * latency on top of it.
+ *
+ * @param	dlna_src	this element
+ * @param	query		latency query
+ *
+ * @return	true if query was answered, false otherwise
+ */
+static gboolean
+dlna_src_handle_query_latency (GstDlnaSrc * dlna_src, GstQuery * query)
+{
+  GstClockTime min_latency = 0;
+
+  if (!dlna_src_is_low_latency (dlna_src))
+    return FALSE;
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  min_latency = dlna_src->network_latency;
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  gst_query_set_latency (query, TRUE, min_latency,
+      min_latency + dlna_src->live_latency * GST_MSECOND);
+
+  GST_DEBUG_OBJECT (dlna_src, "Live latency, min %" GST_TIME_FORMAT
+      ", max %" GST_TIME_FORMAT, GST_TIME_ARGS (min_latency),
+      GST_TIME_ARGS (min_latency + dlna_src->live_latency * GST_MSECOND));
+
+  return TRUE;
+}
+
+/*********************************************/
+/**********                         **********/
+/********** PULL MODE BLOCK CACHE   **********/
+/**********                         **********/
+/*********************************************/
+
+/**
+ * Activates or deactivates the src pad in the requested scheduling mode.
+ * Push mode is handled by souphttpsrc through the ghost pad.  In pull mode
+ * souphttpsrc is kept idle and ranges are served from the block cache.
+ *
+ * @param pad       src pad of this element
+ * @param parent    this element
+ * @param mode      requested scheduling mode
+ * @param active    true if pad is to be activated, false if deactivated
+ *
+ * @return  true if mode change was successful, false otherwise
+ */
+static gboolean
+gst_dlna_src_activate_mode (GstPad * pad, GstObject * parent,
+    GstPadMode mode, gboolean active)
+{
+  GstDlnaSrc *dlna_src = GST_DLNA_SRC (parent);
+
+  if (mode != GST_PAD_MODE_PULL)
+    return gst_ghost_pad_activate_mode_default (pad, parent, mode, active);
+
+  if (active) {
+    if (!dlna_src_is_pull_supported (dlna_src)) {
+      GST_WARNING_OBJECT (dlna_src, "Pull mode not supported for content");
+      return FALSE;
+    }
+    GST_INFO_OBJECT (dlna_src, "Activating pull mode, stopping http src");
+
+    // Keep http src idle while ranges are served from cache
+    gst_element_set_locked_state (dlna_src->http_src, TRUE);
+    gst_element_set_state (dlna_src->http_src, GST_STATE_READY);
+
+    g_mutex_lock (&dlna_src->cache_mutex);
+    dlna_src->pull_mode = TRUE;
+    g_mutex_unlock (&dlna_src->cache_mutex);
+
+    // Prefetched data is only sent ahead of a push mode transfer
+    g_mutex_lock (&dlna_src->event_mutex);
+    if (dlna_src->prefetch_buffer != NULL) {
+      gst_buffer_unref (dlna_src->prefetch_buffer);
+      dlna_src->prefetch_buffer = NULL;
+    }
+    dlna_src->byte_offset = 0;
+    g_mutex_unlock (&dlna_src->event_mutex);
+  } else {
+    GST_INFO_OBJECT (dlna_src, "Deactivating pull mode");
+
+    g_mutex_lock (&dlna_src->cache_mutex);
+    dlna_src->pull_mode = FALSE;
+    g_mutex_unlock (&dlna_src->cache_mutex);
+
+    dlna_src_cache_clear (dlna_src);
+
+    gst_element_set_locked_state (dlna_src->http_src, FALSE);
+  }
+
+  return TRUE;
+}
+
+/**
+ * Returns requested range of content when src pad is in pull mode.  Data is
+ * copied out of cached blocks, missing blocks are fetched from the server
+ * using a single range request for each run of adjacent missing blocks.
+ *
+ * @param pad       src pad of this element
+ * @param parent    this element
+ * @param offset    byte offset of requested range
+ * @param length    number of bytes requested
+ * @param buffer    returned buffer, or buffer supplied by caller to fill
+ *
+ * @return  GST_FLOW_OK if range was returned, GST_FLOW_EOS if offset is
+ *          beyond end of content, GST_FLOW_ERROR otherwise
+ */
+static GstFlowReturn
+gst_dlna_src_getrange (GstPad * pad, GstObject * parent, guint64 offset,
+    guint length, GstBuffer ** buffer)
+{
+  GstDlnaSrc *dlna_src = GST_DLNA_SRC (parent);
+  GstDlnaSrcCacheBlock *block = NULL;
+  GstBuffer *buf = NULL;
+  GstMapInfo map;
+  guint64 content_size = 0;
+  guint64 first_index;
+  guint64 last_index;
+  guint64 index;
+  guint64 missing_index;
+  guint64 next_index;
+  gsize copied = 0;
+
+  if (!dlna_src_get_content_size (dlna_src, &content_size)) {
+    GST_ERROR_OBJECT (dlna_src, "Content size unknown, unable to get range");
+    return GST_FLOW_ERROR;
+  }
+
+  if (offset >= content_size) {
+    GST_DEBUG_OBJECT (dlna_src, "Offset %" G_GUINT64_FORMAT
+        " beyond content size %" G_GUINT64_FORMAT, offset, content_size);
+    return GST_FLOW_EOS;
+  }
+  if (offset + length > content_size)
+    length = content_size - offset;
+
+  first_index = offset / CACHE_BLOCK_SIZE;
+  last_index = (offset + length - 1) / CACHE_BLOCK_SIZE;
+
+  GST_LOG_OBJECT (dlna_src, "Get range offset %" G_GUINT64_FORMAT
+      ", length %u, blocks %" G_GUINT64_FORMAT " to %" G_GUINT64_FORMAT,
+      offset, length, first_index, last_index);
+
+  g_mutex_lock (&dlna_src->cache_mutex);
+
+  if (!dlna_src->pull_mode) {
+    g_mutex_unlock (&dlna_src->cache_mutex);
+    return GST_FLOW_FLUSHING;
+  }
+  // Fetch each run of missing blocks with one request, reading ahead so
+  // sequential pulls are coalesced into a few large range requests
+  for (index = first_index; index <= last_index; index++) {
+    if (dlna_src_cache_lookup (dlna_src, index) != NULL)
+      continue;
+
+    missing_index = index;
+    while ((index < last_index + CACHE_READAHEAD_BLOCKS) &&
+        ((index + 1) * CACHE_BLOCK_SIZE < content_size) &&
+        (index + 1 - missing_index < dlna_src->cache_max_blocks)) {
+      next_index = index + 1;
+      if (g_hash_table_lookup (dlna_src->cache_blocks, &next_index) != NULL)
+        break;
+      index++;
+    }
+
+    if (!dlna_src_cache_fetch (dlna_src, missing_index,
+            index - missing_index + 1, content_size)) {
+      // Pad was deactivated while range was being fetched
+      if (!dlna_src->pull_mode) {
+        g_mutex_unlock (&dlna_src->cache_mutex);
+        return GST_FLOW_FLUSHING;
+      }
+      g_mutex_unlock (&dlna_src->cache_mutex);
+      GST_ELEMENT_ERROR (dlna_src, RESOURCE, READ,
+          ("%s() - unable to fetch range %" G_GUINT64_FORMAT " to %"
+              G_GUINT64_FORMAT, __FUNCTION__,
+              missing_index * CACHE_BLOCK_SIZE,
+              (index + 1) * CACHE_BLOCK_SIZE - 1), NULL);
+      return GST_FLOW_ERROR;
+    }
+  }
+
+  // Hand out sub-buffer of cached block without copying when possible
+  if ((*buffer == NULL) && (first_index == last_index)) {
+    block = dlna_src_cache_lookup (dlna_src, first_index);
+    if (block != NULL) {
+      buf = gst_buffer_copy_region (block->buffer, GST_BUFFER_COPY_ALL,
+          offset - first_index * CACHE_BLOCK_SIZE, length);
+      g_mutex_unlock (&dlna_src->cache_mutex);
+
+      GST_BUFFER_OFFSET (buf) = offset;
+      GST_BUFFER_OFFSET_END (buf) = offset + length;
+      *buffer = buf;
+      return GST_FLOW_OK;
+    }
+  }
+
+  if (*buffer == NULL)
+    buf = gst_buffer_new_allocate (NULL, length, NULL);
+  else
+    buf = *buffer;
+
+  if (!gst_buffer_map (buf, &map, GST_MAP_WRITE)) {
+    g_mutex_unlock (&dlna_src->cache_mutex);
+    GST_ERROR_OBJECT (dlna_src, "Unable to map buffer for writing");
+    if (*buffer == NULL)
+      gst_buffer_unref (buf);
+    return GST_FLOW_ERROR;
+  }
+
+  for (index = first_index; index <= last_index; index++) {
+    guint64 block_start = index * CACHE_BLOCK_SIZE;
+    gsize block_offset = (offset + copied) - block_start;
+    gsize block_size;
+    gsize cnt;
+
+    block = dlna_src_cache_lookup (dlna_src, index);
+    if (block == NULL) {
+      // Block evicted by small cache while filling this request
+      if (!dlna_src_cache_fetch (dlna_src, index, 1, content_size) ||
+          ((block = dlna_src_cache_lookup (dlna_src, index)) == NULL)) {
+        gboolean flushing = !dlna_src->pull_mode;
+
+        gst_buffer_unmap (buf, &map);
+        g_mutex_unlock (&dlna_src->cache_mutex);
+        if (*buffer == NULL)
+          gst_buffer_unref (buf);
+        if (flushing)
+          return GST_FLOW_FLUSHING;
+        GST_ERROR_OBJECT (dlna_src, "Unable to get block %" G_GUINT64_FORMAT,
+            index);
+        return GST_FLOW_ERROR;
+      }
+    }
+    block_size = gst_buffer_get_size (block->buffer);
+    cnt = MIN (block_size - block_offset, length - copied);
+    gst_buffer_extract (block->buffer, block_offset, map.data + copied, cnt);
+    copied += cnt;
+  }
+
+  gst_buffer_unmap (buf, &map);
+  g_mutex_unlock (&dlna_src->cache_mutex);
+
+  gst_buffer_set_size (buf, length);
+  GST_BUFFER_OFFSET (buf) = offset;
+  GST_BUFFER_OFFSET_END (buf) = offset + length;
+  *buffer = buf;
+
+  return GST_FLOW_OK;
+}
+
+/**
+ * Determines if the src pad can be operated in pull mode, which requires
+ * clear text content of known size on a server which accepts byte ranges.
+ *
+ * @param dlna_src  this element
+ *
+ * @return  true if pull mode is supported, false otherwise
+ */
+static gboolean
+dlna_src_is_pull_supported (GstDlnaSrc * dlna_src)
+{
+  guint64 content_size = 0;
+
+  if ((dlna_src->uri == NULL) || (dlna_src->server_info == NULL))
+    return FALSE;
+
+  if (dlna_src->server_info->content_features != NULL) {
+    // Decrypter is in between, ranges of encrypted content can't be served
+    if (dlna_src->server_info->content_features->flag_link_protected_set)
+      return FALSE;
+
+    // Content which is still growing has no fixed size
+    if (dlna_src->server_info->content_features->flag_so_increasing_set ||
+        dlna_src->server_info->content_features->flag_sn_increasing_set)
+      return FALSE;
+  }
+
+  if (!dlna_src->server_info->accept_byte_ranges)
+    return FALSE;
+
+  return dlna_src_get_content_size (dlna_src, &content_size);
+}
+
+/**
+ * Returns the size in bytes of the content item based on HEAD response.
+ *
+ * @param dlna_src  this element
+ * @param size      returned size in bytes
+ *
+ * @return  true if size of content is known, false otherwise
+ */
+static gboolean
+dlna_src_get_content_size (GstDlnaSrc * dlna_src, guint64 * size)
+{
+  if (dlna_src->server_info == NULL)
+    return FALSE;
+
+  if ((dlna_src->server_info->content_features != NULL) &&
+      (dlna_src->server_info->content_features->op_range_supported) &&
+      (dlna_src->server_info->time_seek_response_received) &&
+      (dlna_src->server_info->byte_seek_total > 0)) {
+    *size = dlna_src->server_info->byte_seek_total;
+  } else if (dlna_src->server_info->content_length > 0) {
+    *size = dlna_src->server_info->content_length;
+  } else {
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+ * Looks up block in cache and marks it as most recently used.  Must be called
+ * with cache mutex held.
+ *
+ * @param dlna_src  this element
+ * @param index     index of block, which is byte offset / CACHE_BLOCK_SIZE
+ *
+ * @return  cached block, or NULL if block is not in cache
+ */
+static GstDlnaSrcCacheBlock *
+dlna_src_cache_lookup (GstDlnaSrc * dlna_src, guint64 index)
+{
+  GstDlnaSrcCacheBlock *block =
+      g_hash_table_lookup (dlna_src->cache_blocks, &index);
+
+  if (block != NULL) {
+    g_queue_unlink (&dlna_src->cache_lru, &block->lru_link);
+    g_queue_push_head_link (&dlna_src->cache_lru, &block->lru_link);
+  }
+
+  return block;
+}
+
+/**
+ * Fetches supplied count of adjacent blocks with a single range request and
+ * adds them to cache, evicting least recently used blocks as needed.  Must be
+ * called with cache mutex held, which is released while the range is read so
+ * a stalled server does not hold up clearing of the cache.
+ *
+ * @param dlna_src      this element
+ * @param first_index   index of first block to fetch
+ * @param cnt           number of adjacent blocks to fetch
+ * @param content_size  size of content, last block may be partial
+ *
+ * @return  true if blocks were fetched, false otherwise
+ */
+static gboolean
+dlna_src_cache_fetch (GstDlnaSrc * dlna_src, guint64 first_index,
+    guint cnt, guint64 content_size)
+{
+  GstDlnaSrcCacheBlock *block = NULL;
+  GstBuffer *range_buf = NULL;
+  GList *link = NULL;
+  guint8 *data = NULL;
+  guint64 start_byte = first_index * CACHE_BLOCK_SIZE;
+  guint64 end_byte = MIN (start_byte + (guint64) cnt * CACHE_BLOCK_SIZE,
+      content_size) - 1;
+  gsize range_size = end_byte - start_byte + 1;
+  gsize block_offset = 0;
+  guint epoch = dlna_src->cache_epoch;
+  gint sock = -1;
+  gboolean fetched = FALSE;
+  guint i = 0;
+
+  GST_DEBUG_OBJECT (dlna_src, "Fetching %u blocks, bytes %" G_GUINT64_FORMAT
+      "-%" G_GUINT64_FORMAT, cnt, start_byte, end_byte);
+
+  data = g_try_malloc (range_size);
+  if (data == NULL) {
+    GST_ERROR_OBJECT (dlna_src, "Unable to allocate %" G_GSIZE_FORMAT
+        " bytes for range", range_size);
+    return FALSE;
+  }
+  // Connection is owned by this request until it is done
+  sock = dlna_src->cache_sock;
+  dlna_src->cache_sock = -1;
+  g_mutex_unlock (&dlna_src->cache_mutex);
+
+  // Retry once on a new connection since server may have closed idle one
+  fetched = dlna_src_range_request (dlna_src, &sock, start_byte, end_byte,
+      data) || dlna_src_range_request (dlna_src, &sock, start_byte, end_byte,
+      data);
+
+  g_mutex_lock (&dlna_src->cache_mutex);
+
+  // Cache was cleared meanwhile, blocks and connection are stale
+  if (epoch != dlna_src->cache_epoch) {
+    GST_DEBUG_OBJECT (dlna_src, "Cache cleared while fetching range");
+    dlna_src_close_socket (dlna_src, &sock);
+    g_free (data);
+    return FALSE;
+  }
+  if (dlna_src->cache_sock < 0)
+    dlna_src->cache_sock = sock;
+  else
+    dlna_src_close_socket (dlna_src, &sock);
+
+  if (!fetched) {
+    g_free (data);
+    return FALSE;
+  }
+  range_buf = gst_buffer_new_wrapped (data, range_size);
+
+  // Blocks share memory of the range buffer
+  for (i = 0; i < cnt; i++, block_offset += CACHE_BLOCK_SIZE) {
+    guint64 index = first_index + i;
+
+    // Another pull may have fetched block while lock was released
+    if (g_hash_table_lookup (dlna_src->cache_blocks, &index) != NULL)
+      continue;
+
+    while (g_hash_table_size (dlna_src->cache_blocks) >=
+        dlna_src->cache_max_blocks) {
+      link = g_queue_pop_tail_link (&dlna_src->cache_lru);
+      if (link == NULL)
+        break;
+      block = link->data;
+      GST_LOG_OBJECT (dlna_src, "Evicting block %" G_GUINT64_FORMAT,
+          block->index);
+      g_hash_table_remove (dlna_src->cache_blocks, &block->index);
+      gst_buffer_unref (block->buffer);
+      g_slice_free (GstDlnaSrcCacheBlock, block);
+    }
+
+    block = g_slice_new0 (GstDlnaSrcCacheBlock);
+    block->index = first_index + i;
+    block->buffer = gst_buffer_copy_region (range_buf, GST_BUFFER_COPY_ALL,
+        block_offset, MIN (CACHE_BLOCK_SIZE, range_size - block_offset));
+    block->lru_link.data = block;
+
+    g_hash_table_insert (dlna_src->cache_blocks, &block->index, block);
+    g_queue_push_head_link (&dlna_src->cache_lru, &block->lru_link);
+  }
+  gst_buffer_unref (range_buf);
+
+  return TRUE;
+}
+
+/**
+ * Removes all blocks from cache and closes connection used to fetch blocks.
+ *
+ * @param dlna_src  this element
+ */
+static void
+dlna_src_cache_clear (GstDlnaSrc * dlna_src)
+{
+  GstDlnaSrcCacheBlock *block = NULL;
+  GList *link = NULL;
+
+  g_mutex_lock (&dlna_src->cache_mutex);
+
+  while ((link = g_queue_pop_tail_link (&dlna_src->cache_lru)) != NULL) {
+    block = link->data;
+    gst_buffer_unref (block->buffer);
+    g_slice_free (GstDlnaSrcCacheBlock, block);
+  }
+  g_hash_table_remove_all (dlna_src->cache_blocks);
+  dlna_src->cache_epoch++;
+
+  if (dlna_src->cache_sock >= 0)
+    dlna_src_close_socket (dlna_src, &dlna_src->cache_sock);
+
+  g_mutex_unlock (&dlna_src->cache_mutex);
+}
+
+/**
+ * Issues GET request for supplied byte range on a persistent connection and
+ * reads the entire range into supplied storage.  Connection is opened if
+ * needed and closed when problems are encountered.
+ *
+ * @param dlna_src      this element
+ * @param sock          persistent connection to use, -1 if not yet open
+ * @param start_byte    first byte of range
+ * @param end_byte      last byte of range, inclusive
+ * @param data          storage for end_byte - start_byte + 1 bytes
+ *
+ * @return  true if entire range was read, false otherwise
+ */
+static gboolean
+dlna_src_range_request (GstDlnaSrc * dlna_src, gint * sock,
+    guint64 start_byte, guint64 end_byte, guint8 * data)
+{
+  gchar request_str[MAX_HTTP_BUF_SIZE] = { 0 };
+  gchar response_str[MAX_HTTP_BUF_SIZE + 1] = { 0 };
+  gchar *body = NULL;
+  gsize range_size = end_byte - start_byte + 1;
+  gsize received = 0;
+  gsize header_len = 0;
+  gint ret_code = 0;
+  gssize cnt = 0;
+  gint len = 0;
+
+  if ((*sock < 0) && !dlna_src_open_socket (dlna_src, sock)) {
+    GST_WARNING_OBJECT (dlna_src, "Problems creating socket for range request");
+    return FALSE;
+  }
+
+  len = g_snprintf (request_str, MAX_HTTP_BUF_SIZE,
+      "GET %s HTTP/1.1%sHOST: %s:%d%sRange: bytes=%" G_GUINT64_FORMAT "-%"
+      G_GUINT64_FORMAT "%sConnection: keep-alive%s%s", dlna_src->uri, CRLF,
+      dlna_src->uri_addr, dlna_src->uri_port, CRLF, start_byte, end_byte,
+      CRLF, CRLF, CRLF);
+  if (len >= MAX_HTTP_BUF_SIZE) {
+    GST_ERROR_OBJECT (dlna_src,
+        "Overflow - exceeded range request string size of: %d",
+        MAX_HTTP_BUF_SIZE);
+    return FALSE;
+  }
+
+  GST_LOG_OBJECT (dlna_src, "Issuing range request: %s", request_str);
+  if (!dlna_src_send_request (dlna_src, sock, request_str, len)) {
+    GST_WARNING_OBJECT (dlna_src, "Problems sending range request");
+    goto fail;
+  }
+  // Read until end of response headers
+  while ((body = strstr (response_str, "\r\n\r\n")) == NULL) {
+    if (header_len >= MAX_HTTP_BUF_SIZE) {
+      GST_WARNING_OBJECT (dlna_src, "Range response headers too large");
+      goto fail;
+    }
+    cnt = recv (*sock, response_str + header_len,
+        MAX_HTTP_BUF_SIZE - header_len, 0);
+    if (cnt <= 0) {
+      GST_WARNING_OBJECT (dlna_src, "Range response recv() failed");
+      goto fail;
+    }
+    header_len += cnt;
+    response_str[header_len] = '\0';
+  }
+  body += strlen ("\r\n\r\n");
+
+  if ((sscanf (response_str, "%*s %d", &ret_code) != 1) ||
+      (ret_code != HTTP_STATUS_PARTIAL)) {
+    GST_WARNING_OBJECT (dlna_src, "Unexpected range response code: %d",
+        ret_code);
+    goto fail;
+  }
+  // Part of body may have arrived along with headers
+  received = MIN (header_len - (body - response_str), range_size);
+  memcpy (data, body, received);
+
+  while (received < range_size) {
+    cnt = recv (*sock, data + received, range_size - received, 0);
+    if (cnt <= 0) {
+      GST_WARNING_OBJECT (dlna_src, "Range body recv() failed after %"
+          G_GSIZE_FORMAT " of %" G_GSIZE_FORMAT " bytes", received,
+          range_size);
+      goto fail;
+    }
+    received += cnt;
+  }
+
+  return TRUE;
+
+fail:
+  dlna_src_close_socket (dlna_src, sock);
+  return FALSE;
+}
+
+
+/*********************************************/
+/**********                         **********/
+/**********  NEXT ITEM PREFETCHING  **********/
+/**********                         **********/
+/*********************************************/
+
+/**
+ * Default handler of prefetch-uri action signal, starts prefetching uri in
+ * background on behalf of this element.
+ *
+ * @param dlna_src	this element
+ * @param uri		uri of item which is to be played next
+ *
+ * @return	true if prefetch has been started, false otherwise
+ */
+static gboolean
+gst_dlna_src_prefetch_uri (GstDlnaSrc * dlna_src, const gchar * uri)
+{
+  GstDlnaSrcPrefetchRequest *request = NULL;
+  GThread *thread = NULL;
+  GError *error = NULL;
+
+  if (uri == NULL)
+    return FALSE;
+
+  GST_INFO_OBJECT (dlna_src, "Prefetching %s", uri);
+
+  request = g_slice_new0 (GstDlnaSrcPrefetchRequest);
+  request->uri = g_strdup (uri);
+  request->dtcp_decrypter_factory = g_strdup (dlna_src->dtcp_decrypter_factory);
+  request->dtcp_key_provider = g_strdup (dlna_src->dtcp_key_provider);
+  request->seconds = dlna_src->prefetch_seconds;
+
+  thread = g_thread_try_new ("dlnasrc-prefetch", dlna_src_prefetch_thread,
+      request, &error);
+  if (thread == NULL) {
+    GST_WARNING_OBJECT (dlna_src, "Unable to start prefetch thread: %s",
+        error->message);
+    g_error_free (error);
+    g_free (request->uri);
+    g_free (request->dtcp_decrypter_factory);
+    g_free (request->dtcp_key_provider);
+    g_slice_free (GstDlnaSrcPrefetchRequest, request);
+    return FALSE;
+  }
+  g_thread_unref (thread);
+
+  return TRUE;
+}
+
+/**
+ * Prefetches uri using an element of its own which is discarded afterwards.
+ * HEAD response and leading data are stored for element which is next set to
+ * uri.  For protected content, decrypter is authenticated instead and
+ * stashed.  Requests are issued by an element shared by all prefetches, data
+ * is fetched with a ranged GET on a socket of its own.
+ *
+ * @param data	prefetch request, freed by this thread
+ *
+ * @return	NULL
+ */
+static gpointer
+dlna_src_prefetch_thread (gpointer data)
+{
+  GstDlnaSrcPrefetchRequest *request = data;
+  GstDlnaSrcPrefetch *entry = NULL;
+  GstDlnaSrc *dlna_src = NULL;
+  GstBuffer *buf = NULL;
+  GstMapInfo map;
+  GList *item = NULL;
+  GList *next = NULL;
+  GList *dropped = NULL;
+  guint64 size = 0;
+  gint sock = -1;
+  guint cnt = 0;
+
+  g_mutex_lock (&prefetch_context_mutex);
+  if (prefetch_context == NULL) {
+    prefetch_context = g_object_new (GST_TYPE_DLNA_SRC, NULL);
+    gst_object_ref_sink (prefetch_context);
+    prefetch_context->warm_connection = FALSE;
+  }
+  dlna_src = prefetch_context;
+  g_free (dlna_src->dtcp_decrypter_factory);
+  dlna_src->dtcp_decrypter_factory = request->dtcp_decrypter_factory;
+  request->dtcp_decrypter_factory = NULL;
+  g_free (dlna_src->dtcp_key_provider);
+  dlna_src->dtcp_key_provider = request->dtcp_key_provider;
+  request->dtcp_key_provider = NULL;
+
+  if (!dlna_src_init_uri (dlna_src, request->uri) ||
+      (dlna_src->server_info == NULL)) {
+    GST_WARNING_OBJECT (dlna_src, "Unable to prefetch %s", request->uri);
+    goto done;
+  }
+
+  if (dlna_src_is_link_protected (dlna_src)) {
+    // Key exchange is performed by decrypter when it goes to READY
+    if (dlna_src_dtcp_setup (dlna_src))
+      dlna_src_dtcp_release (dlna_src,
+          gst_element_set_state (dlna_src->dtcp_decrypter,
+              GST_STATE_READY) != GST_STATE_CHANGE_FAILURE);
+  } else if (dlna_src_is_pull_supported (dlna_src) &&
+      dlna_src_prefetch_size (dlna_src, request->seconds, &size)) {
+    buf = gst_buffer_new_allocate (NULL, size, NULL);
+    if (gst_buffer_map (buf, &map, GST_MAP_WRITE)) {
+      if (!dlna_src_range_request (dlna_src, &sock, 0, size - 1, map.data)) {
+        GST_WARNING_OBJECT (dlna_src, "Unable to prefetch data of %s",
+            request->uri);
+        gst_buffer_unmap (buf, &map);
+        gst_buffer_unref (buf);
+        buf = NULL;
+      } else {
+        gst_buffer_unmap (buf, &map);
+      }
+    } else {
+      gst_buffer_unref (buf);
+      buf = NULL;
+    }
+    dlna_src_close_socket (dlna_src, &sock);
+  }
+
+  entry = g_slice_new0 (GstDlnaSrcPrefetch);
+  entry->uri = g_strdup (request->uri);
+  entry->server_info = dlna_src->server_info;
+  entry->data = buf;
+  entry->prefetch_time = g_get_monotonic_time ();
+  dlna_src->server_info = NULL;
+
+  GST_INFO_OBJECT (dlna_src, "Prefetched %s with %" G_GUINT64_FORMAT
+      " bytes of data", request->uri, buf ? size : 0);
+
+  // Newest entry replaces any entry for the same uri, oldest entries are
+  // dropped once there are too many
+  g_mutex_lock (&prefetch_mutex);
+  prefetched = g_list_prepend (prefetched, entry);
+  for (item = prefetched->next; item != NULL; item = next) {
+    next = item->next;
+    if ((++cnt >= MAX_PREFETCHED_ITEMS) ||
+        (g_strcmp0 (((GstDlnaSrcPrefetch *) item->data)->uri,
+                request->uri) == 0)) {
+      prefetched = g_list_remove_link (prefetched, item);
+      dropped = g_list_concat (item, dropped);
+    }
+  }
+  g_mutex_unlock (&prefetch_mutex);
+
+  for (item = dropped; item != NULL; item = item->next)
+    dlna_src_prefetch_free (item->data);
+  g_list_free (dropped);
+
+done:
+  // Data prefetched earlier which context took for same uri is not kept
+  if (dlna_src->prefetch_buffer != NULL) {
+    gst_buffer_unref (dlna_src->prefetch_buffer);
+    dlna_src->prefetch_buffer = NULL;
+  }
+  g_mutex_unlock (&prefetch_context_mutex);
+
+  g_free (request->uri);
+  g_free (request->dtcp_decrypter_factory);
+  g_free (request->dtcp_key_provider);
+  g_slice_free (GstDlnaSrcPrefetchRequest, request);
+
+  return NULL;
+}
+
+/**
+ * Determines number of bytes covering supplied duration of content, using
+ * byte and time totals of HEAD response when known.
+ *
+ * @param dlna_src	this element
+ * @param seconds	duration of content to cover
+ * @param size		returned number of bytes
+ *
+ * @return	true if there is data to prefetch, false otherwise
+ */
+static gboolean
+dlna_src_prefetch_size (GstDlnaSrc * dlna_src, guint seconds, guint64 * size)
+{
+  guint64 content_size = 0;
+
+  if ((seconds == 0) || !dlna_src_get_content_size (dlna_src, &content_size))
+    return FALSE;
+
+  if (dlna_src->server_info->time_seek_npt_duration > 0)
+    *size = gst_util_uint64_scale (content_size, seconds * GST_SECOND,
+        dlna_src->server_info->time_seek_npt_duration);
+  else
+    *size = (guint64) seconds *PREFETCH_FALLBACK_BYTE_RATE;
+
+  *size = MIN (*size, MIN (content_size, MAX_PREFETCH_BYTES));
+
+  return *size > 0;
+}
+
+/**
+ * Takes HEAD response and data prefetched for supplied uri, discarding items
+ * which were prefetched too long ago.
+ *
+ * @param dlna_src	this element
+ * @param uri		uri which element is being set to
+ *
+ * @return	true if uri was prefetched, false otherwise
+ */
+static gboolean
+dlna_src_prefetch_take (GstDlnaSrc * dlna_src, const gchar * uri)
+{
+  GstDlnaSrcPrefetch *entry = NULL;
+  GstDlnaSrcPrefetch *found = NULL;
+  GList *expired = NULL;
+  GList *item = NULL;
+  GList *next = NULL;
+  gint64 now = g_get_monotonic_time ();
+
+  g_mutex_lock (&prefetch_mutex);
+  for (item = prefetched; item != NULL; item = next) {
+    next = item->next;
+    entry = item->data;
+
+    if (now - entry->prefetch_time > PREFETCH_EXPIRY_SECS * G_TIME_SPAN_SECOND) {
+      prefetched = g_list_remove_link (prefetched, item);
+      expired = g_list_concat (item, expired);
+    } else if ((found == NULL) && (g_strcmp0 (entry->uri, uri) == 0)) {
+      prefetched = g_list_delete_link (prefetched, item);
+      found = entry;
+    }
+  }
+  g_mutex_unlock (&prefetch_mutex);
+
+  for (item = expired; item != NULL; item = item->next)
+    dlna_src_prefetch_free (item->data);
+  g_list_free (expired);
+
+  if (found == NULL)
+    return FALSE;
+
+  dlna_src->server_info = found->server_info;
+  dlna_src->prefetch_buffer = found->data;
+  found->server_info = NULL;
+  found->data = NULL;
+  dlna_src_prefetch_free (found);
+
+  return TRUE;
+}
+
+/**
+ * Pushes data prefetched for current uri from src pad in buffers of its own
+ * ahead of first buffer transferred by souphttpsrc.  Buffers pass through
+ * src pad probe again, which leaves their offsets as they are.
+ *
+ * @param dlna_src	this element
+ * @param pad		src pad of this element
+ *
+ * @return	true if prefetched data was pushed, false otherwise
+ */
+static gboolean
+dlna_src_prefetch_push (GstDlnaSrc * dlna_src, GstPad * pad)
+{
+  GstBuffer *prefetch = NULL;
+  GstBuffer *buf = NULL;
+  GstFlowReturn ret = GST_FLOW_OK;
+  gsize size = 0;
+  gsize offset = 0;
+  gsize len = 0;
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  prefetch = dlna_src->prefetch_buffer;
+  dlna_src->prefetch_buffer = NULL;
+  dlna_src->prefetch_pushing = (prefetch != NULL);
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  if (prefetch == NULL)
+    return FALSE;
+
+  size = gst_buffer_get_size (prefetch);
+  GST_DEBUG_OBJECT (dlna_src, "Sending %" G_GSIZE_FORMAT " prefetched bytes",
+      size);
+
+  for (offset = 0; (offset < size) && (ret == GST_FLOW_OK); offset += len) {
+    len = MIN (size - offset, PREFETCH_PUSH_BYTES);
+    buf = gst_buffer_copy_region (prefetch, GST_BUFFER_COPY_MEMORY, offset,
+        len);
+    GST_BUFFER_OFFSET (buf) = offset;
+    GST_BUFFER_OFFSET_END (buf) = offset + len;
+    if (offset == 0)
+      GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
+    ret = gst_pad_push (pad, buf);
+  }
+  if (ret != GST_FLOW_OK)
+    GST_INFO_OBJECT (dlna_src, "Sending prefetched data stopped: %s",
+        gst_flow_get_name (ret));
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  dlna_src->prefetch_pushing = FALSE;
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  gst_buffer_unref (prefetch);
+
+  return TRUE;
+}
+
+/**
+ * Frees prefetched item along with its HEAD response and data.
+ *
+ * @param entry	prefetched item to free
+ */
+static void
+dlna_src_prefetch_free (GstDlnaSrcPrefetch * entry)
+{
+  if (entry->server_info != NULL)
+    dlna_src_head_response_free (NULL, entry->server_info);
+  if (entry->data != NULL)
+    gst_buffer_unref (entry->data);
+  g_free (entry->uri);
+  g_slice_free (GstDlnaSrcPrefetch, entry);
+}
+
+/*********************************************/
+/**********                         **********/
+/********** PERSISTENT STORE        **********/
+/**********                         **********/
+/*********************************************/
+
+/**
+ * Records position of media time in content, reported by server in response
+ * to a time based request.  Called with event mutex held.
+ *
+ * @param dlna_src	this element
+ * @param time		media time in nanoseconds
+ * @param offset	byte position of media time
+ */
+static void
+dlna_src_seek_index_add (GstDlnaSrc * dlna_src, guint64 time, guint64 offset)
+{
+  GstDlnaSrcSeekAnchor anchor;
+  GstDlnaSrcSeekAnchor *cur = NULL;
+  guint lo = 0;
+  guint hi = dlna_src->seek_index->len;
+  guint mid = 0;
+
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    cur = &g_array_index (dlna_src->seek_index, GstDlnaSrcSeekAnchor, mid);
+    if (cur->time == time) {
+      if (cur->offset != offset) {
+        cur->offset = offset;
+        dlna_src->seek_index_dirty = TRUE;
+      }
+      return;
+    }
+    if (cur->time < time)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if (dlna_src->seek_index->len >= MAX_SEEK_INDEX_ENTRIES)
+    return;
+
+  anchor.time = time;
+  anchor.offset = offset;
+  g_array_insert_val (dlna_src->seek_index, lo, anchor);
+  dlna_src->seek_index_dirty = TRUE;
+}
+
+/**
+ * Converts media time into byte position by interpolating between the
+ * anchors of seek index which surround it.
+ *
+ * @param dlna_src	this element
+ * @param time		media time in nanoseconds
+ * @param bytes		returned byte position
+ *
+ * @return	true if time is covered by seek index, false otherwise
+ */
+static gboolean
+dlna_src_seek_index_time_to_bytes (GstDlnaSrc * dlna_src, guint64 time,
+    guint64 * bytes)
+{
+  GstDlnaSrcSeekAnchor *before = NULL;
+  GstDlnaSrcSeekAnchor *after = NULL;
+  gboolean found = FALSE;
+  guint lo = 0;
+  guint hi = 0;
+  guint mid = 0;
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  hi = dlna_src->seek_index->len;
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (g_array_index (dlna_src->seek_index, GstDlnaSrcSeekAnchor,
+            mid).time <= time)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  // Last anchor at or before time and first one after it
+  if (lo > 0)
+    before = &g_array_index (dlna_src->seek_index, GstDlnaSrcSeekAnchor,
+        lo - 1);
+  if (lo < dlna_src->seek_index->len)
+    after = &g_array_index (dlna_src->seek_index, GstDlnaSrcSeekAnchor, lo);
+
+  if ((before != NULL) && (before->time == time)) {
+    *bytes = before->offset;
+    found = TRUE;
+  } else if ((before != NULL) && (after != NULL) &&
+      (after->offset >= before->offset)) {
+    *bytes = before->offset + gst_util_uint64_scale (time - before->time,
+        after->offset - before->offset, after->time - before->time);
+    found = TRUE;
+  }
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  return found;
+}
+
+/**
+ * Converts byte position into media time by interpolating between the
+ * anchors of seek index which surround it.
+ *
+ * @param dlna_src	this element
+ * @param bytes		byte position
+ * @param time		returned media time in nanoseconds
+ *
+ * @return	true if byte position is covered by seek index, false otherwise
+ */
+static gboolean
+dlna_src_seek_index_bytes_to_time (GstDlnaSrc * dlna_src, guint64 bytes,
+    guint64 * time)
+{
+  GstDlnaSrcSeekAnchor *before = NULL;
+  GstDlnaSrcSeekAnchor *after = NULL;
+  gboolean found = FALSE;
+  guint lo = 0;
+  guint hi = 0;
+  guint mid = 0;
+
+  // Offsets of anchors increase along with their times
+  g_mutex_lock (&dlna_src->event_mutex);
+  hi = dlna_src->seek_index->len;
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (g_array_index (dlna_src->seek_index, GstDlnaSrcSeekAnchor,
+            mid).offset <= bytes)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo > 0)
+    before = &g_array_index (dlna_src->seek_index, GstDlnaSrcSeekAnchor,
+        lo - 1);
+  if (lo < dlna_src->seek_index->len)
+    after = &g_array_index (dlna_src->seek_index, GstDlnaSrcSeekAnchor, lo);
+
+  if ((before != NULL) && (before->offset == bytes)) {
+    *time = before->time;
+    found = TRUE;
+  } else if ((before != NULL) && (after != NULL) &&
+      (after->time >= before->time)) {
+    *time = before->time + gst_util_uint64_scale (bytes - before->offset,
+        after->time - before->time, after->offset - before->offset);
+    found = TRUE;
+  }
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  return found;
+}
+
+/**
+ * Returns path of file in which HEAD response and seek index of uri are
+ * stored, named after a hash of the uri.
+ *
+ * @param uri	uri of content item
+ *
+ * @return	newly allocated path
+ */
+static gchar *
+dlna_src_store_path (const gchar * uri)
+{
+  gchar *hash = g_compute_checksum_for_string (G_CHECKSUM_SHA1, uri, -1);
+  gchar *name = g_strconcat (hash, ".bin", NULL);
+  gchar *path = g_build_filename (g_get_user_cache_dir (), "dlnasrc", name,
+      NULL);
+
+  g_free (name);
+  g_free (hash);
+
+  return path;
+}
+
+/**
+ * Copies essentials of HEAD response into store record.
+ *
+ * @param info		HEAD response to copy
+ * @param record	record to fill in
+ */
+static void
+dlna_src_store_fill_record (GstDlnaSrcHeadResponse * info,
+    GstDlnaSrcStoreRecord * record)
+{
+  GstDlnaSrcHeadResponseContentFeatures *features = info->content_features;
+  guint i = 0;
+
+  record->magic = STORE_MAGIC;
+  record->version = STORE_VERSION;
+  record->accept_byte_ranges = info->accept_byte_ranges;
+  record->time_seek_response_received = info->time_seek_response_received;
+  record->content_length = info->content_length;
+  record->time_seek_npt_start = info->time_seek_npt_start;
+  record->time_seek_npt_end = info->time_seek_npt_end;
+  record->time_seek_npt_duration = info->time_seek_npt_duration;
+  record->byte_seek_start = info->byte_seek_start;
+  record->byte_seek_end = info->byte_seek_end;
+  record->byte_seek_total = info->byte_seek_total;
+  record->dtcp_range_start = info->dtcp_range_start;
+  record->dtcp_range_end = info->dtcp_range_end;
+  record->dtcp_range_total = info->dtcp_range_total;
+  record->dtcp_port = info->dtcp_port;
+  record->available_seek_mode = info->available_seek_mode;
+  record->available_seek_npt_received = info->available_seek_npt_received;
+  record->available_seek_npt_start = info->available_seek_npt_start;
+  record->available_seek_npt_end = info->available_seek_npt_end;
+  record->available_seek_bytes_received = info->available_seek_bytes_received;
+  record->available_seek_byte_start = info->available_seek_byte_start;
+  record->available_seek_byte_end = info->available_seek_byte_end;
+  if (info->content_type)
+    g_strlcpy (record->content_type, info->content_type,
+        sizeof (record->content_type));
+  if (info->dtcp_host)
+    g_strlcpy (record->dtcp_host, info->dtcp_host, sizeof (record->dtcp_host));
+
+  if (features->profile)
+    g_strlcpy (record->profile, features->profile, sizeof (record->profile));
+  for (i = 0; i < G_N_ELEMENTS (STORE_FEATURE_FLAGS); i++)
+    if (G_STRUCT_MEMBER (gboolean, features, STORE_FEATURE_FLAGS[i]))
+      record->feature_flags |= 1 << i;
+  record->playspeeds_cnt = features->playspeeds_cnt;
+  for (i = 0; i < features->playspeeds_cnt; i++) {
+    record->playspeeds[i] = features->playspeeds[i];
+    g_strlcpy (record->playspeed_strs[i], features->playspeed_strs[i],
+        sizeof (record->playspeed_strs[i]));
+  }
+}
+
+/**
+ * Loads HEAD response and seek index of current uri from persistent store.
+ * File is mapped into memory and its fixed layout record copied out, so
+ * nothing needs to be parsed.
+ *
+ * @param dlna_src	this element
+ *
+ * @return	true if uri was found in store, false otherwise
+ */
+static gboolean
+dlna_src_store_load (GstDlnaSrc * dlna_src)
+{
+  GMappedFile *file = NULL;
+  gchar *path = dlna_src_store_path (dlna_src->uri);
+  gboolean ret = FALSE;
+
+  file = g_mapped_file_new (path, FALSE, NULL);
+  if (file == NULL) {
+    GST_DEBUG_OBJECT (dlna_src, "No stored metadata in %s", path);
+    g_free (path);
+    return FALSE;
+  }
+
+  ret = dlna_src_store_read (dlna_src, g_mapped_file_get_contents (file),
+      g_mapped_file_get_length (file));
+  if (!ret)
+    GST_INFO_OBJECT (dlna_src, "Ignoring stored metadata in %s", path);
+
+  g_mapped_file_unref (file);
+  g_free (path);
+
+  return ret;
+}
+
+/**
+ * Installs HEAD response and seek index of current uri from a stored record,
+ * after verifying record is complete and belongs to the uri.
+ *
+ * @param dlna_src	this element
+ * @param contents	stored record followed by uri and seek index
+ * @param size		number of bytes of contents
+ *
+ * @return	true if record was installed, false otherwise
+ */
+static gboolean
+dlna_src_store_read (GstDlnaSrc * dlna_src, const gchar * contents,
+    gsize size)
+{
+  const GstDlnaSrcStoreRecord *record = (const GstDlnaSrcStoreRecord *)
+      contents;
+  GstDlnaSrcHeadResponse *info = NULL;
+  GstDlnaSrcHeadResponseContentFeatures *features = NULL;
+  gsize uri_len = strlen (dlna_src->uri);
+  guint i = 0;
+
+  if ((size < sizeof (GstDlnaSrcStoreRecord)) ||
+      (record->magic != STORE_MAGIC) || (record->version != STORE_VERSION) ||
+      (record->uri_len != uri_len) ||
+      (record->playspeeds_cnt > PLAYSPEEDS_MAX_CNT) ||
+      (record->seek_index_cnt > MAX_SEEK_INDEX_ENTRIES) ||
+      (size != sizeof (GstDlnaSrcStoreRecord) + STORE_URI_SIZE (uri_len) +
+          record->seek_index_cnt * sizeof (GstDlnaSrcSeekAnchor)) ||
+      (memcmp (contents + sizeof (GstDlnaSrcStoreRecord), dlna_src->uri,
+              uri_len) != 0))
+    return FALSE;
+
+  if (!dlna_src_head_response_init_struct (dlna_src, &info))
+    return FALSE;
+  info->ret_code = HTTP_STATUS_OK;
+  info->accept_byte_ranges = record->accept_byte_ranges;
+  info->time_seek_response_received = record->time_seek_response_received;
+  info->content_length = record->content_length;
+  info->time_seek_npt_start = record->time_seek_npt_start;
+  info->time_seek_npt_end = record->time_seek_npt_end;
+  info->time_seek_npt_duration = record->time_seek_npt_duration;
+  info->byte_seek_start = record->byte_seek_start;
+  info->byte_seek_end = record->byte_seek_end;
+  info->byte_seek_total = record->byte_seek_total;
+  info->dtcp_range_start = record->dtcp_range_start;
+  info->dtcp_range_end = record->dtcp_range_end;
+  info->dtcp_range_total = record->dtcp_range_total;
+  info->dtcp_port = record->dtcp_port;
+  info->available_seek_mode = record->available_seek_mode;
+  info->available_seek_npt_received = record->available_seek_npt_received;
+  info->available_seek_npt_start = record->available_seek_npt_start;
+  info->available_seek_npt_end = record->available_seek_npt_end;
+  info->available_seek_bytes_received = record->available_seek_bytes_received;
+  info->available_seek_byte_start = record->available_seek_byte_start;
+  info->available_seek_byte_end = record->available_seek_byte_end;
+  if (record->content_type[0] != '\0')
+    info->content_type = g_strndup (record->content_type,
+        sizeof (record->content_type));
+  if (record->dtcp_host[0] != '\0')
+    info->dtcp_host = g_strndup (record->dtcp_host,
+        sizeof (record->dtcp_host));
+  if (info->time_seek_response_received) {
+    info->time_seek_npt_start_str = g_malloc0 (32);
+    dlna_src_nanos_to_npt (dlna_src, info->time_seek_npt_start,
+        info->time_seek_npt_start_str, 32);
+    info->time_seek_npt_end_str = g_malloc0 (32);
+    dlna_src_nanos_to_npt (dlna_src, info->time_seek_npt_end,
+        info->time_seek_npt_end_str, 32);
+    info->time_seek_npt_duration_str = g_malloc0 (32);
+    dlna_src_nanos_to_npt (dlna_src, info->time_seek_npt_duration,
+        info->time_seek_npt_duration_str, 32);
+  }
+
+  features = info->content_features;
+  if (record->profile[0] != '\0')
+    features->profile = g_strndup (record->profile, sizeof (record->profile));
+  for (i = 0; i < G_N_ELEMENTS (STORE_FEATURE_FLAGS); i++)
+    G_STRUCT_MEMBER (gboolean, features, STORE_FEATURE_FLAGS[i]) =
+        (record->feature_flags & (1 << i)) != 0;
+  features->playspeeds_cnt = record->playspeeds_cnt;
+  for (i = 0; i < record->playspeeds_cnt; i++) {
+    features->playspeeds[i] = record->playspeeds[i];
+    features->playspeed_strs[i] = g_strndup (record->playspeed_strs[i],
+        sizeof (record->playspeed_strs[i]));
+  }
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  g_array_set_size (dlna_src->seek_index, 0);
+  g_array_append_vals (dlna_src->seek_index,
+      contents + sizeof (GstDlnaSrcStoreRecord) + STORE_URI_SIZE (uri_len),
+      record->seek_index_cnt);
+  dlna_src->seek_index_dirty = FALSE;
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  GST_INFO_OBJECT (dlna_src, "Loaded stored metadata with %u seek anchors",
+      record->seek_index_cnt);
+
+  dlna_src->server_info = info;
+
+  return TRUE;
+}
+
+/**
+ * Writes HEAD response and seek index of current uri to persistent store
+ * and, if enabled, to shared memory cache.  File is replaced atomically so
+ * it can be mapped by other processes at any time.
+ *
+ * @param dlna_src	this element
+ */
+static void
+dlna_src_store_save (GstDlnaSrc * dlna_src)
+{
+  GError *error = NULL;
+  gchar *path = NULL;
+  gchar *dir = NULL;
+  gchar *data = NULL;
+  gsize size = 0;
+
+  if ((!dlna_src->metadata_cache && (dlna_src->shared_cache == NULL)) ||
+      (dlna_src->uri == NULL) || (dlna_src->server_info == NULL) ||
+      (dlna_src->server_info->content_features == NULL) ||
+      g_atomic_int_get (&dlna_src->store_stale))
+    return;
+
+  if (dlna_src->shared_cache != NULL) {
+    data = dlna_src_store_serialize (dlna_src, SHM_SLOT_DATA_SIZE, &size);
+    if (data != NULL)
+      dlna_src_shm_publish (dlna_src, data, size);
+    g_free (data);
+  }
+  if (!dlna_src->metadata_cache)
+    return;
+
+  data = dlna_src_store_serialize (dlna_src, G_MAXSIZE, &size);
+  if (data == NULL)
+    return;
+
+  path = dlna_src_store_path (dlna_src->uri);
+  dir = g_path_get_dirname (path);
+  if (g_mkdir_with_parents (dir, 0700) != 0) {
+    GST_WARNING_OBJECT (dlna_src, "Unable to create metadata store %s", dir);
+  } else if (!g_file_set_contents (path, data, size, &error)) {
+    GST_WARNING_OBJECT (dlna_src, "Unable to store metadata: %s",
+        error->message);
+    g_error_free (error);
+  } else {
+    GST_DEBUG_OBJECT (dlna_src, "Stored metadata in %s", path);
+  }
+
+  g_free (dir);
+  g_free (path);
+  g_free (data);
+}
+
+/**
+ * Formats HEAD response and seek index of current uri as stored record,
+ * dropping anchors of seek index which do not fit into supplied size.
+ *
+ * @param dlna_src	this element
+ * @param max_size	maximum size of record
+ * @param size		returned size of record
+ *
+ * @return	newly allocated record, NULL if uri does not fit
+ */
+static gchar *
+dlna_src_store_serialize (GstDlnaSrc * dlna_src, gsize max_size, gsize * size)
+{
+  GstDlnaSrcStoreRecord *record = NULL;
+  gchar *data = NULL;
+  gsize uri_len = strlen (dlna_src->uri);
+  guint cnt = 0;
+
+  if (sizeof (GstDlnaSrcStoreRecord) + STORE_URI_SIZE (uri_len) > max_size)
+    return NULL;
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  cnt = MIN (dlna_src->seek_index->len, (max_size -
+          sizeof (GstDlnaSrcStoreRecord) - STORE_URI_SIZE (uri_len)) /
+      sizeof (GstDlnaSrcSeekAnchor));
+  *size = sizeof (GstDlnaSrcStoreRecord) + STORE_URI_SIZE (uri_len) +
+      cnt * sizeof (GstDlnaSrcSeekAnchor);
+  data = g_malloc0 (*size);
+  memcpy (data + sizeof (GstDlnaSrcStoreRecord) + STORE_URI_SIZE (uri_len),
+      dlna_src->seek_index->data, cnt * sizeof (GstDlnaSrcSeekAnchor));
+  dlna_src->seek_index_dirty = FALSE;
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  record = (GstDlnaSrcStoreRecord *) data;
+  dlna_src_store_fill_record (dlna_src->server_info, record);
+  record->uri_len = uri_len;
+  record->seek_index_cnt = cnt;
+  memcpy (data + sizeof (GstDlnaSrcStoreRecord), dlna_src->uri, uri_len);
+
+  return data;
+}
+
+/**
+ * Starts validating HEAD response loaded from persistent store against the
+ * server in background, so startup does not wait on the server.
+ *
+ * @param dlna_src	this element
+ */
+static void
+dlna_src_store_validate (GstDlnaSrc * dlna_src)
+{
+  GstDlnaSrcStoreValidation *validation = NULL;
+  GThread *thread = NULL;
+
+  validation = g_slice_new0 (GstDlnaSrcStoreValidation);
+  validation->dlna_src = gst_object_ref (dlna_src);
+  validation->uri = g_strdup (dlna_src->uri);
+  validation->shared_cache = g_strdup (dlna_src->shared_cache);
+  validation->generation = dlna_src->store_generation;
+  dlna_src_store_fill_record (dlna_src->server_info, &validation->record);
+
+  thread = g_thread_try_new ("dlnasrc-validate",
+      dlna_src_store_validate_thread, validation, NULL);
+  if (thread == NULL) {
+    GST_WARNING_OBJECT (dlna_src, "Unable to start metadata validation");
+    gst_object_unref (validation->dlna_src);
+    g_free (validation->uri);
+    g_free (validation->shared_cache);
+    g_slice_free (GstDlnaSrcStoreValidation, validation);
+    return;
+  }
+  g_thread_unref (thread);
+}
+
+/**
+ * Issues HEAD request for uri whose HEAD response was loaded from persistent
+ * store and compares the essentials.  If content has changed the store is
+ * replaced by the new response, which the element also switches to unless
+ * it has been set to another uri meanwhile.
+ *
+ * @param data	validation request, freed by this thread
+ *
+ * @return	NULL
+ */
+static gpointer
+dlna_src_store_validate_thread (gpointer data)
+{
+  GstDlnaSrcStoreValidation *validation = data;
+  GstDlnaSrcStoreRecord *record = NULL;
+  GstDlnaSrc *dlna_src = NULL;
+
+  dlna_src = g_object_new (GST_TYPE_DLNA_SRC, NULL);
+  gst_object_ref_sink (dlna_src);
+  dlna_src->warm_connection = FALSE;
+
+  if (!dlna_src_init_uri (dlna_src, validation->uri) ||
+      (dlna_src->server_info == NULL) ||
+      (dlna_src->server_info->content_features == NULL)) {
+    GST_WARNING_OBJECT (validation->dlna_src,
+        "Unable to validate stored metadata of %s", validation->uri);
+    goto done;
+  }
+
+  record = g_slice_new0 (GstDlnaSrcStoreRecord);
+  dlna_src_store_fill_record (dlna_src->server_info, record);
+  if ((record->content_length != validation->record.content_length) ||
+      (record->byte_seek_total != validation->record.byte_seek_total) ||
+      (record->time_seek_npt_duration !=
+          validation->record.time_seek_npt_duration) ||
+      (record->feature_flags != validation->record.feature_flags) ||
+      (g_strcmp0 (record->profile, validation->record.profile) != 0)) {
+    GST_WARNING_OBJECT (validation->dlna_src,
+        "Stored metadata of %s is stale, replacing it", validation->uri);
+    g_atomic_int_set (&validation->dlna_src->store_stale, TRUE);
+
+    dlna_src->metadata_cache = TRUE;
+    dlna_src->shared_cache = validation->shared_cache;
+    validation->shared_cache = NULL;
+    dlna_src_store_save (dlna_src);
+
+    // Element switches to new response, anchors of old content are dropped
+    g_mutex_lock (&validation->dlna_src->event_mutex);
+    if (validation->generation == validation->dlna_src->store_generation) {
+      dlna_src_server_info_swap (validation->dlna_src, dlna_src->server_info);
+      dlna_src->server_info = NULL;
+      g_array_set_size (validation->dlna_src->seek_index, 0);
+      validation->dlna_src->seek_index_dirty = FALSE;
+      g_atomic_int_set (&validation->dlna_src->store_stale, FALSE);
+    }
+    g_mutex_unlock (&validation->dlna_src->event_mutex);
+  } else {
+    GST_DEBUG_OBJECT (validation->dlna_src, "Stored metadata of %s is valid",
+        validation->uri);
+  }
+  g_slice_free (GstDlnaSrcStoreRecord, record);
+
+done:
+  gst_object_unref (dlna_src);
+  gst_object_unref (validation->dlna_src);
+  g_free (validation->uri);
+  g_free (validation->shared_cache);
+  g_slice_free (GstDlnaSrcStoreValidation, validation);
+
+  return NULL;
+}
+
+/**
+ * Replaces HEAD response of element while it may be streaming.  Threads
+ * reading server info do not lock, so the new response is published whole
+ * by an atomic pointer store and is not modified afterwards.  Readers which
+ * load server info more than once may see fields of successive responses,
+ * so previous response is kept rather than freed until element is set to
+ * another uri, when no transfer of it can be reading any more.  Must be
+ * called with event mutex held.
+ *
+ * @param dlna_src	this element
+ * @param info		HEAD response which element takes ownership of
+ */
+static void
+dlna_src_server_info_swap (GstDlnaSrc * dlna_src,
+    GstDlnaSrcHeadResponse * info)
+{
+  GstDlnaSrcHeadResponse *old = dlna_src->server_info;
+
+  g_atomic_pointer_set (&dlna_src->server_info, info);
+
+  if (old != NULL)
+    dlna_src->server_info_retired =
+        g_list_prepend (dlna_src->server_info_retired, old);
+}
+
+/**
+ * Frees HEAD responses retired while element was set to previous uri.
+ *
+ * @param dlna_src	this element
+ */
+static void
+dlna_src_server_info_retired_free (GstDlnaSrc * dlna_src)
+{
+  GList *item = NULL;
+
+  for (item = dlna_src->server_info_retired; item != NULL; item = item->next)
+    dlna_src_head_response_free (dlna_src, item->data);
+  g_list_free (dlna_src->server_info_retired);
+  dlna_src->server_info_retired = NULL;
+}
+
+/*********************************************/
+/**********                         **********/
+/********** SHARED MEMORY CACHE     **********/
+/**********                         **********/
+/*********************************************/
+
+/**
+ * Maps shared memory segment holding cache of HEAD responses, creating it if
+ * no other process has yet.  Segments stay mapped for lifetime of process.
+ *
+ * @param dlna_src	this element
+ * @param name		name of shared memory segment
+ *
+ * @return	mapped table, NULL if segment could not be used
+ */
+static GstDlnaSrcShmTable *
+dlna_src_shm_open (GstDlnaSrc * dlna_src, const gchar * name)
+{
+  GstDlnaSrcShmTable *table = NULL;
+  gchar *shm_name = NULL;
+  struct stat st;
+  gboolean created = FALSE;
+  gint64 deadline = 0;
+  guint attempt = 0;
+  gint fd = -1;
+
+  g_mutex_lock (&shm_mutex);
+  if (shm_tables == NULL)
+    shm_tables = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  if (g_hash_table_lookup_extended (shm_tables, name, NULL,
+          (gpointer *) & table)) {
+    g_mutex_unlock (&shm_mutex);
+    return table;
+  }
+
+  shm_name = (name[0] == '/') ? g_strdup (name) : g_strconcat ("/", name,
+      NULL);
+
+  // Segment is either created by this process or opened once it exists
+  for (attempt = 0; (fd < 0) && (attempt < SHM_OPEN_ATTEMPTS); attempt++) {
+    fd = shm_open (shm_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0) {
+      created = TRUE;
+    } else if (errno == EEXIST) {
+      fd = shm_open (shm_name, O_RDWR, 0600);
+      if ((fd < 0) && (errno != ENOENT))
+        break;
+    } else {
+      break;
+    }
+  }
+  if (fd < 0) {
+    GST_WARNING_OBJECT (dlna_src, "Unable to open shared cache %s: %s",
+        shm_name, strerror (errno));
+    goto done;
+  }
+  // Segment is zero filled when sized by its creator, which is an empty
+  // table, others wait until it has been sized before mapping it
+  if (created) {
+    if (ftruncate (fd, sizeof (GstDlnaSrcShmTable)) != 0) {
+      GST_WARNING_OBJECT (dlna_src, "Unable to size shared cache %s: %s",
+          shm_name, strerror (errno));
+      shm_unlink (shm_name);
+      goto done;
+    }
+  } else {
+    deadline = g_get_monotonic_time () + SHM_INIT_WAIT_USECS;
+    while ((fstat (fd, &st) == 0) &&
+        (st.st_size < sizeof (GstDlnaSrcShmTable)) &&
+        (g_get_monotonic_time () < deadline))
+      g_usleep (SHM_INIT_POLL_USECS);
+    if ((fstat (fd, &st) != 0) || (st.st_size < sizeof (GstDlnaSrcShmTable))) {
+      GST_WARNING_OBJECT (dlna_src, "Shared cache %s was not sized by its "
+          "creator", shm_name);
+      goto done;
+    }
+  }
+
+  table = mmap (NULL, sizeof (GstDlnaSrcShmTable), PROT_READ | PROT_WRITE,
+      MAP_SHARED, fd, 0);
+  if (table == MAP_FAILED) {
+    GST_WARNING_OBJECT (dlna_src, "Unable to map shared cache %s: %s",
+        shm_name, strerror (errno));
+    table = NULL;
+    goto done;
+  }
+  // Creator stamps layout and publishes magic last, the atomic store being
+  // a full barrier, so layout is complete once magic is seen
+  if (created) {
+    table->version = SHM_VERSION;
+    table->slot_cnt = SHM_SLOT_CNT;
+    table->slot_size = sizeof (GstDlnaSrcShmSlot);
+    g_atomic_int_set (&table->magic, SHM_MAGIC);
+  } else {
+    deadline = g_get_monotonic_time () + SHM_INIT_WAIT_USECS;
+    while ((g_atomic_int_get (&table->magic) == 0) &&
+        (g_get_monotonic_time () < deadline))
+      g_usleep (SHM_INIT_POLL_USECS);
+  }
+  if ((g_atomic_int_get (&table->magic) != SHM_MAGIC) ||
+      (table->version != SHM_VERSION) || (table->slot_cnt != SHM_SLOT_CNT) ||
+      (table->slot_size != sizeof (GstDlnaSrcShmSlot))) {
+    GST_WARNING_OBJECT (dlna_src, "Shared cache %s has unknown layout",
+        shm_name);
+    munmap (table, sizeof (GstDlnaSrcShmTable));
+    table = NULL;
+  }
+
+done:
+  if (fd >= 0)
+    close (fd);
+  g_free (shm_name);
+
+  // Segment which can not be used is not tried again
+  g_hash_table_insert (shm_tables, g_strdup (name), table);
+  g_mutex_unlock (&shm_mutex);
+
+  return table;
+}
+
+/**
+ * Returns key of uri in shared memory cache, never 0 since 0 marks unused
+ * slots.
+ *
+ * @param uri	uri of content item
+ *
+ * @return	key of uri
+ */
+static gint
+dlna_src_shm_key (const gchar * uri)
+{
+  return (gint) (g_str_hash (uri) | 1);
+}
+
+/**
+ * Looks up HEAD response and seek index of current uri in shared memory
+ * cache.  Slots are probed linearly from the slot the key hashes to, each
+ * slot is copied out and only used if it was not written meanwhile.
+ *
+ * @param dlna_src	this element
+ *
+ * @return	true if uri was found in cache, false otherwise
+ */
+static gboolean
+dlna_src_shm_lookup (GstDlnaSrc * dlna_src)
+{
+  GstDlnaSrcShmTable *table = NULL;
+  GstDlnaSrcShmSlot *slot = NULL;
+  gchar *data = NULL;
+  gint key = dlna_src_shm_key (dlna_src->uri);
+  gint seq = 0;
+  gint slot_key = 0;
+  guint32 size = 0;
+  gint64 stored_time = 0;
+  gboolean found = FALSE;
+  guint i = 0;
+  guint attempt = 0;
+
+  table = dlna_src_shm_open (dlna_src, dlna_src->shared_cache);
+  if (table == NULL)
+    return FALSE;
+
+  data = g_malloc (SHM_SLOT_DATA_SIZE);
+  for (i = 0; (i < SHM_MAX_PROBES) && !found; i++) {
+    slot = &table->slots[((guint) key + i) % SHM_SLOT_CNT];
+    slot_key = g_atomic_int_get (&slot->key);
+    if (slot_key == 0)
+      break;
+    if (slot_key != key)
+      continue;
+
+    for (attempt = 0; attempt < SHM_READ_ATTEMPTS; attempt++) {
+      seq = g_atomic_int_get (&slot->seq);
+      if (seq & 1)
+        continue;
+
+      size = MIN (slot->size, SHM_SLOT_DATA_SIZE);
+      stored_time = slot->stored_time;
+      memcpy (data, (const gchar *) slot->data, size);
+
+      // Copy is consistent if slot was neither written nor reused meanwhile
+      if ((g_atomic_int_get (&slot->key) == key) &&
+          (g_atomic_int_get (&slot->seq) == seq))
+        break;
+    }
+    if (attempt == SHM_READ_ATTEMPTS) {
+      GST_DEBUG_OBJECT (dlna_src, "Shared cache slot is busy");
+      continue;
+    }
+    if (g_get_real_time () - stored_time >
+        SHM_ENTRY_EXPIRY_SECS * G_TIME_SPAN_SECOND) {
+      GST_DEBUG_OBJECT (dlna_src, "Shared cache entry has expired");
+      continue;
+    }
+    found = dlna_src_store_read (dlna_src, data, size);
+  }
+  g_free (data);
+
+  if (found)
+    GST_INFO_OBJECT (dlna_src, "Found HEAD response in shared cache %s",
+        dlna_src->shared_cache);
+
+  return found;
+}
+
+/**
+ * Claims shared memory cache slot for writing by storing id of this process
+ * in it.  Slot claimed by a process which no longer exists is taken over,
+ * that process died while writing and left the slot claimed.
+ *
+ * @param slot	slot to claim
+ *
+ * @return	true if slot was claimed, false if another writer holds it
+ */
+static gboolean
+dlna_src_shm_claim (GstDlnaSrcShmSlot * slot)
+{
+  gint self = (gint) getpid ();
+  gint writer = g_atomic_int_get (&slot->writer);
+
+  if (writer == 0)
+    return g_atomic_int_compare_and_exchange (&slot->writer, 0, self);
+
+  // Process which is alive, or which may not be signalled, still writes
+  if ((writer == self) || (kill ((pid_t) writer, 0) == 0) || (errno != ESRCH))
+    return FALSE;
+
+  return g_atomic_int_compare_and_exchange (&slot->writer, writer, self);
+}
+
+/**
+ * Publishes stored record of current uri in shared memory cache.  Slot
+ * already holding uri or first unused slot is claimed, otherwise the slot
+ * key hashes to is reused.  Writing is skipped if another process or element
+ * is writing the slot at the same time.
+ *
+ * @param dlna_src	this element
+ * @param data		stored record
+ * @param size		size of record, no larger than a slot
+ */
+static void
+dlna_src_shm_publish (GstDlnaSrc * dlna_src, const gchar * data, gsize size)
+{
+  GstDlnaSrcShmTable *table = NULL;
+  GstDlnaSrcShmSlot *slot = NULL;
+  gint key = dlna_src_shm_key (dlna_src->uri);
+  gint slot_key = 0;
+  gint seq = 0;
+  guint i = 0;
+
+  table = dlna_src_shm_open (dlna_src, dlna_src->shared_cache);
+  if (table == NULL)
+    return;
+
+  for (i = 0; i < SHM_MAX_PROBES; i++) {
+    slot = &table->slots[((guint) key + i) % SHM_SLOT_CNT];
+    slot_key = g_atomic_int_get (&slot->key);
+    if ((slot_key == key) || ((slot_key == 0) &&
+            g_atomic_int_compare_and_exchange (&slot->key, 0, key)))
+      break;
+  }
+  if (i == SHM_MAX_PROBES)
+    slot = &table->slots[(guint) key % SHM_SLOT_CNT];
+
+  if (!dlna_src_shm_claim (slot)) {
+    GST_DEBUG_OBJECT (dlna_src, "Shared cache slot is being written");
+    return;
+  }
+  // Odd sequence number marks slot as being written, a writer which died
+  // leaves it odd and readers keep skipping slot until it is written again
+  seq = g_atomic_int_get (&slot->seq);
+  if (!(seq & 1))
+    g_atomic_int_inc (&slot->seq);
+
+  g_atomic_int_set (&slot->key, key);
+  memcpy ((gchar *) slot->data, data, size);
+  slot->size = size;
+  slot->stored_time = g_get_real_time ();
+
+  g_atomic_int_inc (&slot->seq);
+  g_atomic_int_set (&slot->writer, 0);
+
+  GST_DEBUG_OBJECT (dlna_src, "Published HEAD response in shared cache %s",
+      dlna_src->shared_cache);
+}
+
+
+/*********************************************/
+/**********                         **********/
+/********** GstUriHandler INTERFACE **********/
+/**********                         **********/
+/*********************************************/
+static guint
+gst_dlna_src_uri_get_type (GType type)
+{
+  return GST_URI_SRC;
+}
+
+static const gchar *const *
+gst_dlna_src_uri_get_protocols (GType type)
+{
+  static const gchar *protocols[] = { "http", "https", NULL };
   return protocols;
 }
 
@@ -1389,8 +8003,24 @@ gst_dlna_src_uri_handler_init (gpointer g_iface, gpointer iface_data)
 static gboolean
 dlna_src_set_uri (GstDlnaSrc * dlna_src, const gchar * value)
 {
+  GstEvent *flush_event = NULL;
+  gboolean switching = FALSE;
+
   // Determine if this is a new URI or just another request using same URI
   if ((dlna_src->uri == NULL) || (g_strcmp0 (value, dlna_src->uri) != 0)) {
+    // Switch of uri while streaming keeps elements and pads of this bin,
+    // only the transfer is restarted once new uri has been initialized
+    if ((dlna_src->uri != NULL) && (GST_STATE (dlna_src) >= GST_STATE_PAUSED)
+        && !dlna_src->pull_mode) {
+      GST_INFO_OBJECT (dlna_src, "Switching uri while streaming");
+      switching = TRUE;
+
+      flush_event = gst_event_new_flush_start ();
+      dlna_src_push_flush (dlna_src, flush_event);
+      gst_element_set_state (dlna_src->http_src, GST_STATE_READY);
+    }
+    dlna_src_reset_uri_state (dlna_src);
+
     if (dlna_src->uri == NULL) {
       GST_DEBUG_OBJECT (dlna_src, "Need to initialize due to NULL URI");
     } else {
@@ -1410,10 +8040,51 @@ dlna_src_set_uri (GstDlnaSrc * dlna_src, const gchar * value)
     }
     GST_INFO_OBJECT (dlna_src, "Successfully initialized URI: %s",
         dlna_src->uri);
+
+    dlna_src_update_caps (dlna_src);
+    dlna_src_refresh_start (dlna_src);
   }
   // Set the URI
   g_object_set (G_OBJECT (dlna_src->http_src), "location", dlna_src->uri, NULL);
 
+  // Range of previous transfer must not be requested for new one
+  if (dlna_src->range_headers_set)
+    dlna_src_set_range_headers (dlna_src, NULL);
+  // Data prefetched for live content is behind its live edge by now
+  if ((dlna_src->prefetch_buffer != NULL) && dlna_src_is_low_latency (dlna_src)) {
+    gst_buffer_unref (dlna_src->prefetch_buffer);
+    dlna_src->prefetch_buffer = NULL;
+  }
+  // Souphttpsrc is a live source in low latency mode so pipeline does not
+  // preroll on it, how far it reads ahead is left unchanged
+  g_object_set (G_OBJECT (dlna_src->http_src), "is-live",
+      dlna_src_is_low_latency (dlna_src), NULL);
+
+  // Prefetched data is sent ahead of data transferred by souphttpsrc, which
+  // is requested to start right after it
+  if ((dlna_src->prefetch_buffer != NULL) && !switching) {
+    GstStructure *extra_headers_struct = NULL;
+    guint64 size = gst_buffer_get_size (dlna_src->prefetch_buffer);
+
+    if (dlna_src_formulate_extra_headers (dlna_src, 1.0, GST_FORMAT_BYTES,
+            size, -1, &extra_headers_struct)) {
+      dlna_src_set_range_headers (dlna_src, extra_headers_struct);
+
+      g_mutex_lock (&dlna_src->event_mutex);
+      dlna_src->byte_offset = size;
+      g_mutex_unlock (&dlna_src->event_mutex);
+    } else {
+      gst_buffer_unref (dlna_src->prefetch_buffer);
+      dlna_src->prefetch_buffer = NULL;
+    }
+  } else if (dlna_src->prefetch_buffer != NULL) {
+    // Transfer restarted below replaces prefetched data
+    gst_buffer_unref (dlna_src->prefetch_buffer);
+    dlna_src->prefetch_buffer = NULL;
+  } else if (!switching) {
+    dlna_src_live_start (dlna_src);
+  }
+
   // Reset to default values
   dlna_src->requested_rate = 1.0;
   dlna_src->requested_format = GST_FORMAT_BYTES;
@@ -1431,102 +8102,736 @@ dlna_src_set_uri (GstDlnaSrc * dlna_src, const gchar * value)
       GST_ERROR_OBJECT (dlna_src, "Problems setting up dtcp elements");
       return FALSE;
     }
-  } else {
-    GST_INFO_OBJECT (dlna_src, "No DTCP setup required");
+  } else {
+    GST_INFO_OBJECT (dlna_src, "No DTCP setup required");
+
+    // Decrypter of previous URI may still be needed by another element
+    dlna_src_dtcp_release (dlna_src, TRUE);
+
+    // Create src ghost pad of dlna src using http src so playbin will recognize element as a src
+    GST_DEBUG_OBJECT (dlna_src, "Getting http src pad");
+    GstPad *pad = gst_element_get_static_pad (dlna_src->http_src, "src");
+    if (!pad) {
+      GST_ERROR_OBJECT (dlna_src,
+          "Could not get pad for dtcp decrypter. Exiting.");
+      return FALSE;
+    }
+
+    GST_DEBUG_OBJECT (dlna_src,
+        "Creating src pad for dlnasrc bin using http src pad");
+    if (!dlna_src_create_src_pad (dlna_src, pad)) {
+      gst_object_unref (pad);
+      return FALSE;
+    }
+    gst_object_unref (pad);
+  }
+
+  if (switching) {
+    // Decrypter and queue may have been added for new uri
+    if (dlna_src->dtcp_queue)
+      gst_element_sync_state_with_parent (dlna_src->dtcp_queue);
+    if (dlna_src->dtcp_decrypter)
+      gst_element_sync_state_with_parent (dlna_src->dtcp_decrypter);
+
+    GstFormat format = GST_FORMAT_BYTES;
+    guint64 start = 0;
+
+    dlna_src_live_start_position (dlna_src, &format, &start);
+    if (!dlna_src_restart_transfer (dlna_src, 1.0, format, start, -1,
+            GST_SEEK_FLAG_FLUSH, gst_util_seqnum_next ())) {
+      GST_ERROR_OBJECT (dlna_src, "Problem starting transfer of new uri");
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+ * Discards state which was gathered for the current uri, such as cached
+ * blocks and seeks not yet issued, so none of it is applied to a new uri.
+ *
+ * @param dlna_src	this element
+ */
+static void
+dlna_src_reset_uri_state (GstDlnaSrc * dlna_src)
+{
+  dlna_src_seek_discard_pending (dlna_src);
+
+  dlna_src_cache_clear (dlna_src);
+  dlna_src_refresh_stop (dlna_src);
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  dlna_src->segment_pending = FALSE;
+  dlna_src->byte_offset = 0;
+  dlna_src->offsets_known = TRUE;
+  dlna_src->live_edge_known = FALSE;
+  dlna_src->live_rates_known = FALSE;
+  dlna_src->live_catching_up = FALSE;
+  dlna_src->live_pcr_anchored = FALSE;
+  dlna_src->live_pcr_pid = -1;
+  dlna_src->live_join_lag = 0;
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  dlna_src->rate = 1.0;
+}
+
+/**
+ * Create the ghost src pad of this bin which targets supplied pad and install
+ * the event, query and pull mode functions of this element on it.  Ghost pad
+ * which already exists is retargeted so downstream links and negotiation
+ * survive a change of uri.
+ *
+ * @param dlna_src	this element
+ * @param pad		src pad of element within bin which is to be ghosted
+ *
+ * @return	true if pad was created and added, false otherwise
+ */
+static gboolean
+dlna_src_create_src_pad (GstDlnaSrc * dlna_src, GstPad * pad)
+{
+  GstPad *target = NULL;
+  GstPad *internal = NULL;
+
+  if (dlna_src->src_pad) {
+    target = gst_ghost_pad_get_target (GST_GHOST_PAD (dlna_src->src_pad));
+    if (target != NULL)
+      gst_object_unref (target);
+    if ((target != pad) &&
+        !gst_ghost_pad_set_target (GST_GHOST_PAD (dlna_src->src_pad), pad)) {
+      GST_ERROR_OBJECT (dlna_src, "Could not retarget ghost src pad");
+      return FALSE;
+    }
+    return TRUE;
+  }
+
+  dlna_src->src_pad = gst_ghost_pad_new ("src", pad);
+  if (!dlna_src->src_pad) {
+    GST_ERROR_OBJECT (dlna_src, "Could not create ghost src pad");
+    return FALSE;
+  }
+  // Configure pad functions before activating and adding pad to element
+  gst_pad_set_event_function (dlna_src->src_pad,
+      (GstPadEventFunction) gst_dlna_src_event);
+
+  gst_pad_set_query_function (dlna_src->src_pad,
+      (GstPadQueryFunction) gst_dlna_src_query);
+
+  // Pull mode is served from block cache rather than by souphttpsrc
+  gst_pad_set_activatemode_function (dlna_src->src_pad,
+      (GstPadActivateModeFunction) gst_dlna_src_activate_mode);
+
+  gst_pad_set_getrange_function (dlna_src->src_pad,
+      (GstPadGetRangeFunction) gst_dlna_src_getrange);
+
+  // Stamp segment and offsets on data of transfers restarted by this element
+  dlna_src->event_probe = gst_pad_add_probe (dlna_src->src_pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+      dlna_src_src_pad_probe, dlna_src, NULL);
+
+  // Caps known from HEAD response follow stream start of every transfer
+  internal = GST_PAD (gst_proxy_pad_get_internal (GST_PROXY_PAD
+          (dlna_src->src_pad)));
+  gst_pad_set_event_function (internal,
+      (GstPadEventFunction) dlna_src_internal_event);
+  gst_object_unref (internal);
+
+  gst_pad_set_active (dlna_src->src_pad, TRUE);
+  gst_element_add_pad (GST_ELEMENT (&dlna_src->bin), dlna_src->src_pad);
+
+  return TRUE;
+}
+
+/**
+ * Setup dtcp decoder element and add to src in order to handle DTCP encrypted
+ * content
+ *
+ * @param dlna_src	this element
+ *
+ * @return	true if successfully setup, false otherwise
+ */
+static gboolean
+dlna_src_dtcp_setup (GstDlnaSrc * dlna_src)
+{
+  GST_INFO_OBJECT (dlna_src, "Setup for dtcp content");
+
+  // Packet positions of previous content do not apply
+  g_mutex_lock (&dlna_src->event_mutex);
+  g_array_set_size (dlna_src->pcp_map, 0);
+  g_mutex_unlock (&dlna_src->event_mutex);
+  dlna_src_pcp_reset (dlna_src, TRUE, 0, 0);
+
+  // Decrypter which already authenticated with this host can be kept
+  if (dlna_src->dtcp_decrypter) {
+    if (dlna_src_dtcp_is_factory (dlna_src, dlna_src->dtcp_decrypter,
+            dlna_src->dtcp_decrypter_factory) &&
+        (g_strcmp0 (dlna_src->dtcp_decrypter_host,
+                dlna_src->server_info->dtcp_host) == 0) &&
+        (dlna_src->dtcp_decrypter_port == dlna_src->server_info->dtcp_port)) {
+      GST_INFO_OBJECT (dlna_src, "Reusing dtcp decrypter for %s:%d",
+          dlna_src->dtcp_decrypter_host, dlna_src->dtcp_decrypter_port);
+      return TRUE;
+    }
+    dlna_src_dtcp_release (dlna_src, TRUE);
+  }
+
+  dlna_src->dtcp_decrypter = dlna_src_dtcp_take_stashed (dlna_src,
+      dlna_src->dtcp_decrypter_factory, dlna_src->server_info->dtcp_host,
+      dlna_src->server_info->dtcp_port);
+
+  if (!dlna_src->dtcp_decrypter) {
+    dlna_src->dtcp_decrypter = dlna_src_dtcp_create (dlna_src,
+        dlna_src->dtcp_decrypter_factory);
+    if (!dlna_src->dtcp_decrypter)
+      return FALSE;
+  }
+  g_free (dlna_src->dtcp_decrypter_host);
+  dlna_src->dtcp_decrypter_host = g_strdup (dlna_src->server_info->dtcp_host);
+  dlna_src->dtcp_decrypter_port = dlna_src->server_info->dtcp_port;
+
+  // Add this element to the src
+  gst_bin_add (GST_BIN (&dlna_src->bin), dlna_src->dtcp_decrypter);
+
+  // Queue moves decryption to its own streaming thread so network reads
+  // continue while packets are being decrypted
+  if (dlna_src->dtcp_queue_size > 0) {
+    dlna_src->dtcp_queue = gst_element_factory_make ("queue",
+        ELEMENT_NAME_DTCP_QUEUE);
+    if (!dlna_src->dtcp_queue) {
+      GST_WARNING_OBJECT (dlna_src,
+          "The dtcp queue element could not be created, decrypting on network thread");
+    } else {
+      guint queue_size = dlna_src->dtcp_queue_size;
+      guint64 latency_bytes = 0;
+
+      // Queue holds no more than target latency of live content, it is not
+      // made leaky since encrypted data can't be dropped
+      if (dlna_src_is_low_latency (dlna_src)) {
+        if (!dlna_src_time_to_bytes (dlna_src,
+                dlna_src->live_latency * GST_MSECOND, TRUE, &latency_bytes))
+          latency_bytes = PREFETCH_FALLBACK_BYTE_RATE *
+              dlna_src->live_latency / 1000;
+        queue_size = MIN (queue_size, MAX (latency_bytes, 1));
+      }
+      g_object_set (G_OBJECT (dlna_src->dtcp_queue),
+          "max-size-bytes", queue_size,
+          "max-size-buffers", 0, "max-size-time", (guint64) 0, NULL);
+      gst_bin_add (GST_BIN (&dlna_src->bin), dlna_src->dtcp_queue);
+    }
+  }
+  // Http src pad may still be the target of ghost src pad
+  if (dlna_src->src_pad)
+    gst_ghost_pad_set_target (GST_GHOST_PAD (dlna_src->src_pad), NULL);
+
+  // Link elements together
+  if (dlna_src->dtcp_queue) {
+    if (!gst_element_link_many (dlna_src->http_src, dlna_src->dtcp_queue,
+            dlna_src->dtcp_decrypter, NULL)) {
+      GST_ERROR_OBJECT (dlna_src,
+          "Problems linking elements in src. Exiting.");
+      return FALSE;
+    }
+  } else if (!gst_element_link_many
+      (dlna_src->http_src, dlna_src->dtcp_decrypter, NULL)) {
+    GST_ERROR_OBJECT (dlna_src, "Problems linking elements in src. Exiting.");
+    return FALSE;
+  }
+  // Follow packets in encrypted stream so cleartext seeks can be aligned
+  if (dlna_src->pcp_probe == 0) {
+    GstPad *http_pad = gst_element_get_static_pad (dlna_src->http_src, "src");
+    dlna_src->pcp_probe = gst_pad_add_probe (http_pad,
+        GST_PAD_PROBE_TYPE_BUFFER, dlna_src_pcp_probe, dlna_src, NULL);
+    gst_object_unref (http_pad);
+  }
+
+  GST_INFO_OBJECT (dlna_src, "Getting dtcpip decrypter src pad");
+  GstPad *pad = gst_element_get_static_pad (dlna_src->dtcp_decrypter, "src");
+  if (!pad) {
+    GST_ERROR_OBJECT (dlna_src,
+        "Could not get pad for dtcp decrypter. Exiting.");
+    return FALSE;
+  }
+
+  GST_INFO_OBJECT (dlna_src,
+      "Creating src pad for dlnasrc bin using decyrpter src pad");
+  if (!dlna_src_create_src_pad (dlna_src, pad)) {
+    gst_object_unref (pad);
+    return FALSE;
+  }
+  gst_object_unref (pad);
+
+  return TRUE;
+}
+
+/**
+ * Removes decrypter from this bin, either stashing it along with the host and
+ * port it authenticated with for reuse or discarding it.
+ *
+ * @param dlna_src	this element
+ * @param stash		true to keep decrypter for reuse, false to discard
+ */
+static void
+dlna_src_dtcp_release (GstDlnaSrc * dlna_src, gboolean stash)
+{
+  GstDlnaSrcDtcpDecrypter *entry = NULL;
+  GstElement *decrypter = dlna_src->dtcp_decrypter;
+
+  if (decrypter == NULL)
+    return;
+
+  dlna_src->dtcp_decrypter = NULL;
+
+  // Ghost src pad is retargeted once content of next uri is known
+  if (dlna_src->src_pad)
+    gst_ghost_pad_set_target (GST_GHOST_PAD (dlna_src->src_pad), NULL);
+
+  if (dlna_src->pcp_probe != 0) {
+    GstPad *http_pad = gst_element_get_static_pad (dlna_src->http_src, "src");
+    gst_pad_remove_probe (http_pad, dlna_src->pcp_probe);
+    gst_object_unref (http_pad);
+    dlna_src->pcp_probe = 0;
+  }
+
+  if (dlna_src->dtcp_queue) {
+    gst_element_unlink (dlna_src->dtcp_queue, decrypter);
+    gst_element_set_state (dlna_src->dtcp_queue, GST_STATE_NULL);
+    gst_bin_remove (GST_BIN (&dlna_src->bin), dlna_src->dtcp_queue);
+    dlna_src->dtcp_queue = NULL;
+  } else {
+    gst_element_unlink (dlna_src->http_src, decrypter);
+  }
+
+  // Decrypter is kept in READY, as when element is shut down, so it has no
+  // active pads once unlinked but keeps its authentication
+  gst_object_ref (decrypter);
+  gst_element_set_locked_state (decrypter, TRUE);
+  gst_element_set_state (decrypter, GST_STATE_READY);
+  gst_bin_remove (GST_BIN (&dlna_src->bin), decrypter);
+
+  if (stash && (dlna_src->dtcp_decrypter_host != NULL)) {
+    GST_INFO_OBJECT (dlna_src, "Stashing dtcp decrypter for %s:%d",
+        dlna_src->dtcp_decrypter_host, dlna_src->dtcp_decrypter_port);
+
+    entry = g_slice_new0 (GstDlnaSrcDtcpDecrypter);
+    entry->host = dlna_src->dtcp_decrypter_host;
+    entry->port = dlna_src->dtcp_decrypter_port;
+    entry->decrypter = decrypter;
+    entry->stashed_time = g_get_monotonic_time ();
+    dlna_src->dtcp_decrypter_host = NULL;
+
+    g_mutex_lock (&dtcp_decrypters_mutex);
+    dtcp_decrypters = g_list_prepend (dtcp_decrypters, entry);
+    g_mutex_unlock (&dtcp_decrypters_mutex);
+  } else {
+    gst_element_set_state (decrypter, GST_STATE_NULL);
+    gst_object_unref (decrypter);
+
+    g_free (dlna_src->dtcp_decrypter_host);
+    dlna_src->dtcp_decrypter_host = NULL;
+  }
+}
+
+/**
+ * Takes stashed decrypter which authenticated with supplied host and port,
+ * discarding decrypters whose exchange key has expired meanwhile.
+ *
+ * @param dlna_src	this element
+ * @param factory	name of factory decrypter must have been created by
+ * @param host		DTCP host content is to be decrypted for
+ * @param port		DTCP port content is to be decrypted for
+ *
+ * @return	decrypter which is no longer locked in state, NULL if none
+ */
+static GstElement *
+dlna_src_dtcp_take_stashed (GstDlnaSrc * dlna_src, const gchar * factory,
+    const gchar * host, guint port)
+{
+  GstDlnaSrcDtcpDecrypter *entry = NULL;
+  GstElement *decrypter = NULL;
+  GList *expired = NULL;
+  GList *item = NULL;
+  GList *next = NULL;
+  gint64 now = g_get_monotonic_time ();
+
+  g_mutex_lock (&dtcp_decrypters_mutex);
+  for (item = dtcp_decrypters; item != NULL; item = next) {
+    next = item->next;
+    entry = item->data;
+
+    if (now - entry->stashed_time >
+        DTCP_DECRYPTER_EXPIRY_SECS * G_TIME_SPAN_SECOND) {
+      dtcp_decrypters = g_list_remove_link (dtcp_decrypters, item);
+      expired = g_list_concat (item, expired);
+    } else if ((decrypter == NULL) && (g_strcmp0 (entry->host, host) == 0) &&
+        (entry->port == port) &&
+        dlna_src_dtcp_is_factory (dlna_src, entry->decrypter, factory)) {
+      dtcp_decrypters = g_list_delete_link (dtcp_decrypters, item);
+      decrypter = entry->decrypter;
+      g_free (entry->host);
+      g_slice_free (GstDlnaSrcDtcpDecrypter, entry);
+    }
+  }
+  g_mutex_unlock (&dtcp_decrypters_mutex);
+
+  // Release expired decrypters outside of lock
+  for (item = expired; item != NULL; item = item->next) {
+    entry = item->data;
+    GST_INFO_OBJECT (dlna_src, "Discarding expired dtcp decrypter for %s:%d",
+        entry->host, entry->port);
+    gst_element_set_state (entry->decrypter, GST_STATE_NULL);
+    gst_object_unref (entry->decrypter);
+    g_free (entry->host);
+    g_slice_free (GstDlnaSrcDtcpDecrypter, entry);
+  }
+  g_list_free (expired);
+
+  if (decrypter != NULL) {
+    GST_INFO_OBJECT (dlna_src, "Reusing stashed dtcp decrypter for %s:%d",
+        host, port);
+    gst_element_set_locked_state (decrypter, FALSE);
+  }
+
+  return decrypter;
+}
+
+/**
+ * Creates decrypter for protected content using supplied element factory.
+ * Decrypter is configured with DTCP host and port of content through its
+ * dtcp1host and dtcp1port properties, the key exchange and decryption are
+ * performed within the decrypter.
+ *
+ * @param dlna_src	this element
+ * @param factory	name of element factory to create decrypter with
+ *
+ * @return	decrypter which has been configured, NULL if not possible
+ */
+static GstElement *
+dlna_src_dtcp_create (GstDlnaSrc * dlna_src, const gchar * factory)
+{
+  GstElement *decrypter = NULL;
+  GObjectClass *klass = NULL;
+
+  GST_INFO_OBJECT (dlna_src, "Creating dtcp decrypter using %s", factory);
+  decrypter = gst_element_factory_make (factory, ELEMENT_NAME_DTCP_DECRYPTER);
+  if (!decrypter) {
+    GST_ERROR_OBJECT (dlna_src,
+        "The dtcp decrypter element %s could not be created. Exiting.",
+        factory);
+    return NULL;
+  }
+  // Verify element can be configured like dtcpip
+  klass = G_OBJECT_GET_CLASS (decrypter);
+  if ((g_object_class_find_property (klass, "dtcp1host") == NULL) ||
+      (g_object_class_find_property (klass, "dtcp1port") == NULL)) {
+    GST_ERROR_OBJECT (dlna_src,
+        "The dtcp decrypter element %s has no dtcp1host and dtcp1port properties",
+        factory);
+    gst_object_unref (gst_object_ref_sink (decrypter));
+    return NULL;
+  }
+  // Set DTCP host property
+  g_object_set (G_OBJECT (decrypter), "dtcp1host",
+      dlna_src->server_info->dtcp_host, NULL);
+
+  // Set DTCP port property
+  g_object_set (G_OBJECT (decrypter), "dtcp1port",
+      dlna_src->server_info->dtcp_port, NULL);
+
+  // Decrypters which obtain content keys from a key provider get this
+  // element's one
+  if (g_object_class_find_property (klass, "key_provider") != NULL)
+    g_object_set (G_OBJECT (decrypter), "key_provider",
+        dlna_src->dtcp_key_provider, NULL);
+
+  return decrypter;
+}
+
+/**
+ * Determines if decrypter was created by supplied element factory.  Decrypter
+ * with a key provider also has to use this element's key provider.
+ *
+ * @param dlna_src	this element
+ * @param decrypter	decrypter to check
+ * @param factory	name of element factory
+ *
+ * @return	true if decrypter was created by factory, false otherwise
+ */
+static gboolean
+dlna_src_dtcp_is_factory (GstDlnaSrc * dlna_src, GstElement * decrypter,
+    const gchar * factory)
+{
+  GstElementFactory *element_factory = gst_element_get_factory (decrypter);
+  gchar *key_provider = NULL;
+  gboolean same_key_provider = TRUE;
+
+  if ((element_factory == NULL) ||
+      (g_strcmp0 (gst_plugin_feature_get_name (GST_PLUGIN_FEATURE
+                  (element_factory)), factory) != 0))
+    return FALSE;
+
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (decrypter),
+          "key_provider") != NULL) {
+    g_object_get (G_OBJECT (decrypter), "key_provider", &key_provider, NULL);
+    same_key_provider =
+        (g_strcmp0 (key_provider, dlna_src->dtcp_key_provider) == 0);
+    g_free (key_provider);
+  }
+
+  return same_key_provider;
+}
+
+/**
+ * Determines if content is link protected, meaning byte positions requested
+ * from server are cleartext positions rather than positions in encrypted
+ * stream.
+ *
+ * @param dlna_src	this element
+ *
+ * @return	true if content is protected with DTCP, false otherwise
+ */
+static gboolean
+dlna_src_is_link_protected (GstDlnaSrc * dlna_src)
+{
+  return (dlna_src->server_info != NULL) &&
+      (dlna_src->server_info->content_features != NULL) &&
+      dlna_src->server_info->content_features->flag_link_protected_set;
+}
+
+/**
+ * Probe on souphttpsrc src pad which follows protected content packets
+ * (PCPs) in encrypted stream before it reaches the decrypter.
+ *
+ * @param	pad			src pad of souphttpsrc
+ * @param	info		buffer passing through pad
+ * @param	user_data	this element
+ *
+ * @return	GST_PAD_PROBE_OK so data is always passed on
+ */
+static GstPadProbeReturn
+dlna_src_pcp_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GstDlnaSrc *dlna_src = GST_DLNA_SRC (user_data);
+  GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstMapInfo map;
+
+  if (!gst_buffer_map (buf, &map, GST_MAP_READ)) {
+    GST_WARNING_OBJECT (dlna_src, "Unable to map buffer to follow PCPs");
+    return GST_PAD_PROBE_OK;
+  }
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  dlna_src_pcp_parse (dlna_src, map.data, map.size);
+  g_mutex_unlock (&dlna_src->event_mutex);
+
+  gst_buffer_unmap (buf, &map);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/**
+ * Walks PCP headers in supplied encrypted data, recording cleartext and
+ * encrypted position of each packet while cleartext position is known.
+ * PCP header is 14 bytes with cleartext length in last 4 bytes, payload is
+ * padded to AES block size.  Called with event mutex held.
+ *
+ * @param	dlna_src	this element
+ * @param	data		encrypted data following previously parsed data
+ * @param	size		number of bytes of data
+ */
+static void
+dlna_src_pcp_parse (GstDlnaSrc * dlna_src, const guint8 * data, gsize size)
+{
+  gsize len = 0;
+  guint32 clear_len = 0;
+
+  while (size > 0) {
+    if (dlna_src->pcp_payload_remaining > 0) {
+      len = MIN (size, dlna_src->pcp_payload_remaining);
+      dlna_src->pcp_payload_remaining -= len;
+    } else {
+      len = MIN (size, DTCP_PCP_HEADER_SIZE - dlna_src->pcp_header_fill);
+      memcpy (&dlna_src->pcp_header[dlna_src->pcp_header_fill], data, len);
+      dlna_src->pcp_header_fill += len;
+    }
+    if (dlna_src->pcp_encrypted_offset != G_MAXUINT64)
+      dlna_src->pcp_encrypted_offset += len;
+    data += len;
+    size -= len;
 
-    // Create src ghost pad of dlna src using http src so playbin will recognize element as a src
-    GST_DEBUG_OBJECT (dlna_src, "Getting http src pad");
-    GstPad *pad = gst_element_get_static_pad (dlna_src->http_src, "src");
-    if (!pad) {
-      GST_ERROR_OBJECT (dlna_src,
-          "Could not get pad for dtcp decrypter. Exiting.");
-      return FALSE;
+    if (dlna_src->pcp_header_fill < DTCP_PCP_HEADER_SIZE)
+      continue;
+
+    dlna_src->pcp_header_fill = 0;
+    clear_len = GST_READ_UINT32_BE (&dlna_src->pcp_header[10]);
+
+    if (dlna_src->pcp_offsets_known) {
+      dlna_src_pcp_map_add (dlna_src, dlna_src->pcp_clear_offset,
+          (dlna_src->pcp_encrypted_offset == G_MAXUINT64) ? G_MAXUINT64 :
+          dlna_src->pcp_encrypted_offset - DTCP_PCP_HEADER_SIZE, clear_len);
+      dlna_src->pcp_clear_offset += clear_len;
     }
+    dlna_src->pcp_payload_remaining = ((guint64) clear_len + 15) & ~15;
+  }
+}
 
-    GST_DEBUG_OBJECT (dlna_src,
-        "Creating src pad for dlnasrc bin using http src pad");
-    dlna_src->src_pad = gst_ghost_pad_new ("src", pad);
-    gst_pad_set_active (dlna_src->src_pad, TRUE);
+/**
+ * Records position of a PCP, keeping map sorted by cleartext position.
+ * Called with event mutex held.
+ *
+ * @param	dlna_src			this element
+ * @param	clear_offset		cleartext position of first byte of packet
+ * @param	encrypted_offset	position of packet header in encrypted stream,
+ *							G_MAXUINT64 if unknown
+ * @param	clear_len			number of cleartext bytes in packet
+ */
+static void
+dlna_src_pcp_map_add (GstDlnaSrc * dlna_src, guint64 clear_offset,
+    guint64 encrypted_offset, guint32 clear_len)
+{
+  GstDlnaSrcPcpEntry entry;
+  GstDlnaSrcPcpEntry *cur = NULL;
+  guint lo = 0;
+  guint hi = dlna_src->pcp_map->len;
+  guint mid = 0;
 
-    gst_element_add_pad (GST_ELEMENT (&dlna_src->bin), dlna_src->src_pad);
-    gst_object_unref (pad);
+  if (clear_len == 0)
+    return;
 
-    // Configure event function on sink pad before adding pad to element
-    gst_pad_set_event_function (dlna_src->src_pad,
-        (GstPadEventFunction) gst_dlna_src_event);
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    cur = &g_array_index (dlna_src->pcp_map, GstDlnaSrcPcpEntry, mid);
+    if (cur->clear_offset == clear_offset) {
+      if (cur->encrypted_offset == G_MAXUINT64)
+        cur->encrypted_offset = encrypted_offset;
+      return;
+    }
+    if (cur->clear_offset < clear_offset)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
 
-    // Configure event function on sink pad before adding pad to element
-    gst_pad_set_query_function (dlna_src->src_pad,
-        (GstPadQueryFunction) gst_dlna_src_query);
+  if (dlna_src->pcp_map->len >= MAX_PCP_MAP_ENTRIES) {
+    GST_LOG_OBJECT (dlna_src, "PCP map is full, not recording packet at %"
+        G_GUINT64_FORMAT, clear_offset);
+    return;
   }
 
-  return TRUE;
+  entry.clear_offset = clear_offset;
+  entry.encrypted_offset = encrypted_offset;
+  entry.clear_len = clear_len;
+  g_array_insert_val (dlna_src->pcp_map, lo, entry);
 }
 
 /**
- * Setup dtcp decoder element and add to src in order to handle DTCP encrypted
- * content
+ * Looks up PCP containing supplied cleartext position.
  *
- * @param dlna_src	this element
+ * @param	dlna_src				this element
+ * @param	clear_offset			cleartext position to look up
+ * @param	pcp_clear_offset		returned cleartext position of packet
+ * @param	pcp_encrypted_offset	returned encrypted position of packet
  *
- * @return	true if successfully setup, false otherwise
+ * @return	true if packet containing position has been seen, false otherwise
  */
 static gboolean
-dlna_src_dtcp_setup (GstDlnaSrc * dlna_src)
+dlna_src_pcp_map_align (GstDlnaSrc * dlna_src, guint64 clear_offset,
+    guint64 * pcp_clear_offset, guint64 * pcp_encrypted_offset)
 {
-  GST_INFO_OBJECT (dlna_src, "Setup for dtcp content");
-
-  // Create non-encrypt sink element
-  GST_INFO_OBJECT (dlna_src, "Creating dtcp decrypter");
-  dlna_src->dtcp_decrypter = gst_element_factory_make ("dtcpip",
-      ELEMENT_NAME_DTCP_DECRYPTER);
-  if (!dlna_src->dtcp_decrypter) {
-    GST_ERROR_OBJECT (dlna_src,
-        "The dtcp decrypter element could not be created. Exiting.");
-    return FALSE;
+  GstDlnaSrcPcpEntry *cur = NULL;
+  gboolean found = FALSE;
+  guint lo = 0;
+  guint hi = 0;
+  guint mid = 0;
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  hi = dlna_src->pcp_map->len;
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    cur = &g_array_index (dlna_src->pcp_map, GstDlnaSrcPcpEntry, mid);
+    if (clear_offset < cur->clear_offset) {
+      hi = mid;
+    } else if (clear_offset >= cur->clear_offset + cur->clear_len) {
+      lo = mid + 1;
+    } else {
+      *pcp_clear_offset = cur->clear_offset;
+      *pcp_encrypted_offset = cur->encrypted_offset;
+      found = TRUE;
+      break;
+    }
   }
-  // Set DTCP host property
-  g_object_set (G_OBJECT (dlna_src->dtcp_decrypter), "dtcp1host",
-      dlna_src->server_info->dtcp_host, NULL);
-
-  // Set DTCP port property
-  g_object_set (G_OBJECT (dlna_src->dtcp_decrypter), "dtcp1port",
-      dlna_src->server_info->dtcp_port, NULL);
+  g_mutex_unlock (&dlna_src->event_mutex);
 
-  // Add this element to the src
-  gst_bin_add (GST_BIN (&dlna_src->bin), dlna_src->dtcp_decrypter);
+  return found;
+}
 
-  // Link elements together
-  if (!gst_element_link_many
-      (dlna_src->http_src, dlna_src->dtcp_decrypter, NULL)) {
-    GST_ERROR_OBJECT (dlna_src, "Problems linking elements in src. Exiting.");
-    return FALSE;
-  }
+/**
+ * Resets PCP parser for a transfer which starts at supplied position.
+ *
+ * @param	dlna_src			this element
+ * @param	known				true if cleartext position of transfer is known
+ * @param	clear_offset		cleartext position of first packet of transfer
+ * @param	encrypted_offset	encrypted position of first packet of transfer,
+ *							G_MAXUINT64 if unknown
+ */
+static void
+dlna_src_pcp_reset (GstDlnaSrc * dlna_src, gboolean known,
+    guint64 clear_offset, guint64 encrypted_offset)
+{
+  g_mutex_lock (&dlna_src->event_mutex);
+  dlna_src->pcp_header_fill = 0;
+  dlna_src->pcp_payload_remaining = 0;
+  dlna_src->pcp_offsets_known = known;
+  dlna_src->pcp_clear_offset = clear_offset;
+  dlna_src->pcp_encrypted_offset = encrypted_offset;
+  g_mutex_unlock (&dlna_src->event_mutex);
+}
 
-  GST_INFO_OBJECT (dlna_src, "Getting dtcpip decrypter src pad");
-  GstPad *pad = gst_element_get_static_pad (dlna_src->dtcp_decrypter, "src");
-  if (!pad) {
-    GST_ERROR_OBJECT (dlna_src,
-        "Could not get pad for dtcp decrypter. Exiting.");
-    return FALSE;
-  }
+/**
+ * Updates pending byte based segment using Content-Range.dtcp.com header
+ * returned in response to a cleartext byte seek, since server starts at the
+ * beginning of the packet which contains requested position.
+ *
+ * @param	dlna_src	this element
+ * @param	value		value of Content-Range.dtcp.com response header
+ */
+static void
+dlna_src_update_clear_text_segment (GstDlnaSrc * dlna_src,
+    const gchar * value)
+{
+  const gchar *start_str = NULL;
+  guint64 start = 0;
 
-  GST_INFO_OBJECT (dlna_src,
-      "Creating src pad for dlnasrc bin using decyrpter src pad");
-  dlna_src->src_pad = gst_ghost_pad_new ("src", pad);
-  gst_pad_set_active (dlna_src->src_pad, TRUE);
-  gst_element_add_pad (GST_ELEMENT (&dlna_src->bin), dlna_src->src_pad);
-  gst_object_unref (pad);
+  if (value == NULL)
+    return;
 
-  // Configure event function on sink pad before adding pad to element
-  gst_pad_set_event_function (dlna_src->src_pad,
-      (GstPadEventFunction) gst_dlna_src_event);
+  GST_DEBUG_OBJECT (dlna_src, "Cleartext range in response: %s", value);
 
-  // Configure event function on sink pad before adding pad to element
-  gst_pad_set_query_function (dlna_src->src_pad,
-      (GstPadQueryFunction) gst_dlna_src_query);
+  // Value is formatted as bytes=start-end/total
+  start_str = strpbrk (value, "0123456789");
+  if ((start_str == NULL) ||
+      (sscanf (start_str, "%" G_GUINT64_FORMAT, &start) != 1)) {
+    GST_WARNING_OBJECT (dlna_src, "Unable to parse cleartext range: %s",
+        value);
+    return;
+  }
 
-  return TRUE;
+  g_mutex_lock (&dlna_src->event_mutex);
+  if (!dlna_src->pcp_offsets_known) {
+    dlna_src->pcp_offsets_known = TRUE;
+    dlna_src->pcp_clear_offset = start;
+  }
+  if (dlna_src->segment_pending &&
+      (dlna_src->segment.format == GST_FORMAT_BYTES) &&
+      (dlna_src->segment.start != start)) {
+    GST_INFO_OBJECT (dlna_src, "Server started at cleartext byte %"
+        G_GUINT64_FORMAT, start);
+
+    dlna_src->segment.start = start;
+    dlna_src->segment.time = start;
+    dlna_src->segment.position = start;
+    dlna_src->byte_offset = start;
+  }
+  g_mutex_unlock (&dlna_src->event_mutex);
 }
 
 /**
@@ -1543,6 +8848,17 @@ dlna_src_init_uri (GstDlnaSrc * dlna_src, const gchar * value)
 {
   gchar struct_str[MAX_HTTP_BUF_SIZE] = { 0 };
 
+  // Keep seek anchors gathered for previous uri
+  if (dlna_src->seek_index_dirty)
+    dlna_src_store_save (dlna_src);
+
+  g_mutex_lock (&dlna_src->event_mutex);
+  g_array_set_size (dlna_src->seek_index, 0);
+  dlna_src->seek_index_dirty = FALSE;
+  dlna_src->store_generation++;
+  g_mutex_unlock (&dlna_src->event_mutex);
+  g_atomic_int_set (&dlna_src->store_stale, FALSE);
+
   // Set the uri in the src
   if (dlna_src->uri) {
     GST_INFO_OBJECT (dlna_src, "Resetting URI from: %s, to: %s",
@@ -1562,6 +8878,31 @@ dlna_src_init_uri (GstDlnaSrc * dlna_src, const gchar * value)
     dlna_src->uri = NULL;
     return FALSE;
   }
+  // HEAD response of previous uri no longer applies
+  if (dlna_src->server_info != NULL) {
+    dlna_src_head_response_free (dlna_src, dlna_src->server_info);
+    dlna_src->server_info = NULL;
+  }
+  dlna_src_server_info_retired_free (dlna_src);
+  if (dlna_src->prefetch_buffer != NULL) {
+    gst_buffer_unref (dlna_src->prefetch_buffer);
+    dlna_src->prefetch_buffer = NULL;
+  }
+  // Server info may already be known if uri was prefetched
+  if (dlna_src_prefetch_take (dlna_src, value)) {
+    GST_INFO_OBJECT (dlna_src, "Using prefetched HEAD response");
+    return TRUE;
+  }
+  // or has been published by another process
+  if ((dlna_src->shared_cache != NULL) && dlna_src_shm_lookup (dlna_src))
+    return TRUE;
+
+  // or has been stored by a previous run, server is consulted in background
+  if (dlna_src->metadata_cache && dlna_src_store_load (dlna_src)) {
+    GST_INFO_OBJECT (dlna_src, "Using stored HEAD response");
+    dlna_src_store_validate (dlna_src);
+    return TRUE;
+  }
   // Update all server info based on HEAD response
   GST_DEBUG_OBJECT (dlna_src, "Issuing HEAD Request");
   if (!dlna_src_head_request (dlna_src, 0, 0, TRUE, &dlna_src->server_info)) {
@@ -1624,6 +8965,8 @@ dlna_src_init_uri (GstDlnaSrc * dlna_src, const gchar * value)
     dlna_src_head_response_free (dlna_src, head_response);
   }
 
+  dlna_src_store_save (dlna_src);
+
   return TRUE;
 }
 
@@ -1681,6 +9024,51 @@ dlna_src_head_response_free (GstDlnaSrc * dlna_src,
   }
 }
 
+/**
+ * Copies HEAD response along with the strings and content features it owns.
+ *
+ * @param   head_response   HEAD response to copy
+ *
+ * @return  newly allocated copy, freed with dlna_src_head_response_free()
+ */
+static GstDlnaSrcHeadResponse *
+dlna_src_head_response_copy (const GstDlnaSrcHeadResponse * head_response)
+{
+  GstDlnaSrcHeadResponse *copy = NULL;
+  GstDlnaSrcHeadResponseContentFeatures *features = NULL;
+  guint i = 0;
+
+  copy = g_new (GstDlnaSrcHeadResponse, 1);
+  memcpy (copy, head_response, sizeof (GstDlnaSrcHeadResponse));
+  copy->http_rev = g_strdup (head_response->http_rev);
+  copy->ret_msg = g_strdup (head_response->ret_msg);
+  copy->accept_ranges = g_strdup (head_response->accept_ranges);
+  copy->content_range = g_strdup (head_response->content_range);
+  copy->time_seek_npt_start_str =
+      g_strdup (head_response->time_seek_npt_start_str);
+  copy->time_seek_npt_end_str = g_strdup (head_response->time_seek_npt_end_str);
+  copy->time_seek_npt_duration_str =
+      g_strdup (head_response->time_seek_npt_duration_str);
+  copy->transfer_mode = g_strdup (head_response->transfer_mode);
+  copy->transfer_encoding = g_strdup (head_response->transfer_encoding);
+  copy->date = g_strdup (head_response->date);
+  copy->server = g_strdup (head_response->server);
+  copy->content_type = g_strdup (head_response->content_type);
+  copy->dtcp_host = g_strdup (head_response->dtcp_host);
+
+  if (head_response->content_features != NULL) {
+    features = g_new (GstDlnaSrcHeadResponseContentFeatures, 1);
+    memcpy (features, head_response->content_features,
+        sizeof (GstDlnaSrcHeadResponseContentFeatures));
+    features->profile = g_strdup (features->profile);
+    for (i = 0; i < features->playspeeds_cnt; i++)
+      features->playspeed_strs[i] = g_strdup (features->playspeed_strs[i]);
+    copy->content_features = features;
+  }
+
+  return copy;
+}
+
 /**
  * Sends HEAD request and reads response to gather info about content item associated
  * with supplied URL.
@@ -1698,31 +9086,46 @@ dlna_src_head_request (GstDlnaSrc * dlna_src,
 {
   gchar head_request_str[MAX_HTTP_BUF_SIZE] = { 0 };
   gchar head_response_str[MAX_HTTP_BUF_SIZE] = { 0 };
+  gint64 sent = 0;
+  GstClockTime latency = 0;
+
+  g_mutex_lock (&dlna_src->head_mutex);
 
   // Open socket to send HEAD request
-  if (!dlna_src_open_socket (dlna_src)) {
+  if (!dlna_src_open_socket (dlna_src, &dlna_src->sock)) {
     GST_WARNING_OBJECT (dlna_src,
         "Problems creating socket to send HEAD request");
+    g_mutex_unlock (&dlna_src->head_mutex);
     return FALSE;
   }
   // Formulate HEAD request
   if (!dlna_src_head_request_formulate (dlna_src, head_request_str,
           MAX_HTTP_BUF_SIZE, start_npt, start_byte, include_range_header)) {
     GST_WARNING_OBJECT (dlna_src, "Problems formulating HEAD request");
+    g_mutex_unlock (&dlna_src->head_mutex);
     return FALSE;
   }
-  // Send HEAD Request and read response
+  // Send HEAD Request and read response, timing round trip
+  sent = g_get_monotonic_time ();
   if (!dlna_src_head_request_issue (dlna_src, head_request_str,
           head_response_str)) {
     GST_WARNING_OBJECT (dlna_src,
         "Problems sending and receiving HEAD request");
+    g_mutex_unlock (&dlna_src->head_mutex);
     return FALSE;
   }
+  latency = (g_get_monotonic_time () - sent) * GST_USECOND;
   // Close socket
-  if (!dlna_src_close_socket (dlna_src)) {
+  if (!dlna_src_close_socket (dlna_src, &dlna_src->sock)) {
     GST_WARNING_OBJECT (dlna_src,
         "Problems closing socket used to send HEAD request");
   }
+  g_mutex_unlock (&dlna_src->head_mutex);
+
+  // Round trip is read by latency queries of streaming threads
+  g_mutex_lock (&dlna_src->event_mutex);
+  dlna_src->network_latency = latency;
+  g_mutex_unlock (&dlna_src->event_mutex);
   // Parse HEAD response to gather info about URI content item
   if (!dlna_src_head_response_parse (dlna_src, head_response_str,
           head_response)) {
@@ -1809,68 +9212,159 @@ dlna_src_parse_uri (GstDlnaSrc * dlna_src)
 }
 
 /**
- * Create a socket for sending to HEAD request
+ * Create a socket connected to the server of the URI, used for sending HEAD
+ * and range requests
  *
  * @param dlna_src	this element
+ * @param sock		returned connected socket
  *
  * @return	true if successful, false otherwise
  */
 static gboolean
-dlna_src_open_socket (GstDlnaSrc * dlna_src)
+dlna_src_open_socket (GstDlnaSrc * dlna_src, gint * sock)
 {
   GST_LOG_OBJECT (dlna_src, "Opening socket to URI src");
 
+  // Use spare connection if one has been opened while seeking
+  if (dlna_src_warm_socket_take (dlna_src, sock))
+    return TRUE;
+
+  return dlna_src_connect_socket (dlna_src, dlna_src->uri_addr,
+      dlna_src->uri_port, sock);
+}
+
+/**
+ * Sends request on supplied connection.  A spare or kept alive connection
+ * may have been closed by the server in the meantime, in which case a new
+ * connection is opened and the request is sent once more.
+ *
+ * @param	dlna_src	this element instance
+ * @param	sock		connection to send on, replaced if reopened
+ * @param	request		request to send
+ * @param	len			length of request
+ *
+ * @return	true if entire request was sent, false otherwise
+ */
+static gboolean
+dlna_src_send_request (GstDlnaSrc * dlna_src, gint * sock,
+    const gchar * request, gsize len)
+{
+  gssize sent = 0;
+
+  sent = send (*sock, request, len, MSG_NOSIGNAL);
+  if ((sent < 0) && ((errno == EPIPE) || (errno == ECONNRESET))) {
+    GST_INFO_OBJECT (dlna_src, "Connection closed by server, reconnecting");
+
+    dlna_src_close_socket (dlna_src, sock);
+    if (!dlna_src_connect_socket (dlna_src, dlna_src->uri_addr,
+            dlna_src->uri_port, sock))
+      return FALSE;
+    sent = send (*sock, request, len, MSG_NOSIGNAL);
+  }
+
+  if (sent != (gssize) len) {
+    GST_WARNING_OBJECT (dlna_src, "Sent %" G_GSSIZE_FORMAT " bytes instead of %"
+        G_GSIZE_FORMAT ": %s", sent, len, g_strerror (errno));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+ * Creates socket and connects it to supplied address and port.
+ *
+ * @param	dlna_src	this element instance
+ * @param	addr		host name or address to connect to
+ * @param	port		port to connect to
+ * @param	sock		returned connected socket
+ *
+ * @return	true if successfully connected, false otherwise
+ */
+static gboolean
+dlna_src_connect_socket (GstDlnaSrc * dlna_src, const gchar * addr,
+    guint port, gint * sock)
+{
+
+  struct timeval timeout = { SOCKET_TIMEOUT_SECONDS, 0 };
+#ifdef SO_NOSIGPIPE
+  gint nosigpipe = 1;
+#endif
+
   // Create socket
   struct addrinfo hints = { 0 };
   hints.ai_family = AF_INET;
   hints.ai_socktype = SOCK_STREAM;
   hints.ai_protocol = 0;
 
-  if ((dlna_src->sock =
+  if ((*sock =
           socket (hints.ai_family, hints.ai_socktype, hints.ai_protocol)) == -1)
   {
     GST_ERROR_OBJECT (dlna_src, "Socket creation failed");
     return FALSE;
   }
+  // Socket is re-created below for the resolved address family
+  CLOSESOCK (*sock);
+  *sock = -1;
 
   gint ret = 0;
   gchar portStr[8] = { 0 };
-  if (dlna_src->uri_port > 0) {
-    g_snprintf (portStr, 8, "%d", dlna_src->uri_port);
+  if (port > 0) {
+    g_snprintf (portStr, 8, "%d", port);
   }
 
   struct addrinfo *srvrInfo = NULL;
-  if (0 != (ret = getaddrinfo (dlna_src->uri_addr, portStr, &hints, &srvrInfo))) {
+  if (0 != (ret = getaddrinfo (addr, portStr, &hints, &srvrInfo))) {
     GST_WARNING_OBJECT (dlna_src, "getaddrinfo[%s] using addr %s, port %d",
-        gai_strerror (ret), dlna_src->uri_addr, dlna_src->uri_port);
+        gai_strerror (ret), addr, port);
     return FALSE;
   }
 
   struct addrinfo *pSrvr = NULL;
   for (pSrvr = srvrInfo; pSrvr != NULL; pSrvr = pSrvr->ai_next) {
-    if (0 > (dlna_src->sock = socket (pSrvr->ai_family,
+    if (0 > (*sock = socket (pSrvr->ai_family,
                 pSrvr->ai_socktype, pSrvr->ai_protocol))) {
       GST_WARNING_OBJECT (dlna_src, "socket() failed?");
       continue;
     }
 
     /*
-       if (0 > setsockopt(dlna_src->sock, SOL_SOCKET, SO_REUSEADDR,
+       if (0 > setsockopt(*sock, SOL_SOCKET, SO_REUSEADDR,
        (char*) &yes, sizeof(yes)))
        {
        GST_ERROR_OBJECT(dlna_src, "setsockopt() failed?");
        return FALSE;
        }
      */
-    GST_LOG_OBJECT (dlna_src, "Got sock: %d", dlna_src->sock);
+    GST_LOG_OBJECT (dlna_src, "Got sock: %d", *sock);
+
+    // Bound connect, send and recv so threads blocked on a stalled server
+    // can be joined
+    if ((setsockopt (*sock, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                sizeof (timeout)) != 0) ||
+        (setsockopt (*sock, SOL_SOCKET, SO_SNDTIMEO, &timeout,
+                sizeof (timeout)) != 0)) {
+      GST_WARNING_OBJECT (dlna_src, "Unable to set socket timeouts: %s",
+          g_strerror (errno));
+    }
+#ifdef SO_NOSIGPIPE
+    // Platforms without MSG_NOSIGNAL suppress SIGPIPE per socket
+    if (setsockopt (*sock, SOL_SOCKET, SO_NOSIGPIPE, &nosigpipe,
+            sizeof (nosigpipe)) != 0) {
+      GST_WARNING_OBJECT (dlna_src, "Unable to suppress SIGPIPE: %s",
+          g_strerror (errno));
+    }
+#endif
 
-    if (connect (dlna_src->sock, pSrvr->ai_addr, pSrvr->ai_addrlen) != 0) {
+    if (connect (*sock, pSrvr->ai_addr, pSrvr->ai_addrlen) != 0) {
       GST_WARNING_OBJECT (dlna_src, "srcd() failed?");
+      CLOSESOCK (*sock);
+      *sock = -1;
       continue;
     }
     // Successfully connected
     GST_DEBUG_OBJECT (dlna_src, "Successful connect to sock: %d",
-        dlna_src->sock);
+        *sock);
     break;
   }
 
@@ -1886,23 +9380,168 @@ dlna_src_open_socket (GstDlnaSrc * dlna_src)
 }
 
 /**
- * Close socket used to send HEAD request.
+ * Close socket used to send HEAD or range request.
  *
- * @param	this element instance
+ * @param	dlna_src	this element instance
+ * @param	sock		socket to close, set to -1 once closed
  *
  * @return	true
  */
 static gboolean
-dlna_src_close_socket (GstDlnaSrc * dlna_src)
+dlna_src_close_socket (GstDlnaSrc * dlna_src, gint * sock)
 {
   GST_LOG_OBJECT (dlna_src, "Closing socket used for HEAD request");
 
-  if (dlna_src->sock >= 0)
-    CLOSESOCK (dlna_src->sock);
+  if (*sock >= 0)
+    CLOSESOCK (*sock);
+  *sock = -1;
 
   return TRUE;
 }
 
+/**
+ * Starts opening a spare connection to server in background if none is
+ * available, so the next request issued by this element does not have to
+ * wait for connection to be established.
+ *
+ * @param	dlna_src	this element instance
+ */
+static void
+dlna_src_warm_socket_prepare (GstDlnaSrc * dlna_src)
+{
+  GThread *thread = NULL;
+
+  if (!dlna_src->warm_connection || (dlna_src->uri_addr == NULL))
+    return;
+
+  g_mutex_lock (&dlna_src->warm_mutex);
+  if ((dlna_src->warm_sock >= 0) || dlna_src->warm_pending) {
+    g_mutex_unlock (&dlna_src->warm_mutex);
+    return;
+  }
+  // Record host which connection is for since URI may change meanwhile
+  g_free (dlna_src->warm_addr);
+  dlna_src->warm_addr = g_strdup (dlna_src->uri_addr);
+  dlna_src->warm_port = dlna_src->uri_port;
+  dlna_src->warm_pending = TRUE;
+  g_mutex_unlock (&dlna_src->warm_mutex);
+
+  thread = g_thread_try_new ("dlnasrc-warm", dlna_src_warm_socket_thread,
+      gst_object_ref (dlna_src), NULL);
+  if (thread == NULL) {
+    GST_WARNING_OBJECT (dlna_src, "Unable to start warm connection thread");
+    g_mutex_lock (&dlna_src->warm_mutex);
+    dlna_src->warm_pending = FALSE;
+    g_mutex_unlock (&dlna_src->warm_mutex);
+    gst_object_unref (dlna_src);
+    return;
+  }
+  g_thread_unref (thread);
+}
+
+/**
+ * Thread which connects spare socket and stores it for later use.
+ *
+ * @param	data	this element instance, reference is released when done
+ *
+ * @return	NULL
+ */
+static gpointer
+dlna_src_warm_socket_thread (gpointer data)
+{
+  GstDlnaSrc *dlna_src = GST_DLNA_SRC (data);
+  gchar *addr = NULL;
+  guint port = 0;
+  gint sock = -1;
+
+  g_mutex_lock (&dlna_src->warm_mutex);
+  addr = g_strdup (dlna_src->warm_addr);
+  port = dlna_src->warm_port;
+  g_mutex_unlock (&dlna_src->warm_mutex);
+
+  if ((addr != NULL) && !dlna_src_connect_socket (dlna_src, addr, port,
+          &sock)) {
+    GST_DEBUG_OBJECT (dlna_src, "Unable to open warm connection to %s:%d",
+        addr, port);
+  }
+
+  g_mutex_lock (&dlna_src->warm_mutex);
+  if ((sock >= 0) && dlna_src->warm_connection && dlna_src->warm_pending &&
+      (dlna_src->warm_sock < 0)) {
+    GST_DEBUG_OBJECT (dlna_src, "Warm connection to %s:%d ready, sock: %d",
+        addr, port, sock);
+    dlna_src->warm_sock = sock;
+  } else if (sock >= 0) {
+    CLOSESOCK (sock);
+  }
+  dlna_src->warm_pending = FALSE;
+  g_mutex_unlock (&dlna_src->warm_mutex);
+
+  g_free (addr);
+  gst_object_unref (dlna_src);
+
+  return NULL;
+}
+
+/**
+ * Hands over spare connection if one is available for current URI host and
+ * the server has not closed it while idle.
+ *
+ * @param	dlna_src	this element instance
+ * @param	sock		returned connected socket
+ *
+ * @return	true if spare connection was handed over, false otherwise
+ */
+static gboolean
+dlna_src_warm_socket_take (GstDlnaSrc * dlna_src, gint * sock)
+{
+  gboolean taken = FALSE;
+  gchar peek_buf = 0;
+  gssize cnt = 0;
+
+  g_mutex_lock (&dlna_src->warm_mutex);
+  if (dlna_src->warm_sock >= 0) {
+    cnt = recv (dlna_src->warm_sock, &peek_buf, 1, MSG_PEEK | MSG_DONTWAIT);
+
+    if ((g_strcmp0 (dlna_src->warm_addr, dlna_src->uri_addr) != 0) ||
+        (dlna_src->warm_port != dlna_src->uri_port)) {
+      GST_DEBUG_OBJECT (dlna_src, "Warm connection is for other host");
+      CLOSESOCK (dlna_src->warm_sock);
+    } else if ((cnt == 0) || ((cnt < 0) && (errno != EAGAIN) &&
+            (errno != EWOULDBLOCK))) {
+      GST_DEBUG_OBJECT (dlna_src, "Warm connection was closed by server");
+      CLOSESOCK (dlna_src->warm_sock);
+    } else {
+      GST_LOG_OBJECT (dlna_src, "Using warm connection, sock: %d",
+          dlna_src->warm_sock);
+      *sock = dlna_src->warm_sock;
+      taken = TRUE;
+    }
+    dlna_src->warm_sock = -1;
+  }
+  g_mutex_unlock (&dlna_src->warm_mutex);
+
+  return taken;
+}
+
+/**
+ * Closes spare connection and discards any connection still being opened.
+ *
+ * @param	dlna_src	this element instance
+ */
+static void
+dlna_src_warm_socket_close (GstDlnaSrc * dlna_src)
+{
+  g_mutex_lock (&dlna_src->warm_mutex);
+  if (dlna_src->warm_sock >= 0)
+    CLOSESOCK (dlna_src->warm_sock);
+  dlna_src->warm_sock = -1;
+  dlna_src->warm_pending = FALSE;
+  g_free (dlna_src->warm_addr);
+  dlna_src->warm_addr = NULL;
+  g_mutex_unlock (&dlna_src->warm_mutex);
+}
+
 /**
  * Creates the string which represents the HEAD request to send
  * to server to get info related to URI
@@ -1988,7 +9627,7 @@ dlna_src_head_request_formulate (GstDlnaSrc * dlna_src,
   if (g_strlcat (head_request_str, "npt=",
           head_request_max_size) >= head_request_max_size)
     goto overflow;
-  g_snprintf (tmpStr, tmp_str_max_size, "%" G_GUINT64_FORMAT, start_npt);
+  dlna_src_nanos_to_npt (dlna_src, start_npt, tmpStr, tmp_str_max_size);
   if (g_strlcat (head_request_str, tmpStr,
           head_request_max_size) >= head_request_max_size)
     goto overflow;
@@ -2029,19 +9668,10 @@ dlna_src_head_request_issue (GstDlnaSrc * dlna_src, gchar * head_request_str,
   GST_LOG_OBJECT (dlna_src, "Issuing head request: %s", head_request_str);
 
   // Send HEAD request on socket
-  gint bytesTxd = 0;
-  gint bytesToTx = strlen (head_request_str);
-
-  if ((bytesTxd = send (dlna_src->sock, head_request_str, bytesToTx, 0)) < -1) {
+  if (!dlna_src_send_request (dlna_src, &dlna_src->sock, head_request_str,
+          strlen (head_request_str))) {
     GST_ERROR_OBJECT (dlna_src, "Problems sending on socket");
     return FALSE;
-  } else if (bytesTxd == -1) {
-    GST_ERROR_OBJECT (dlna_src, "Problems sending on socket, got back -1");
-    return FALSE;
-  } else if (bytesTxd != bytesToTx) {
-    GST_ERROR_OBJECT (dlna_src, "Sent %d bytes instead of %d", bytesTxd,
-        bytesToTx);
-    return FALSE;
   }
   GST_INFO_OBJECT (dlna_src, "Issued head request: \n%s", head_request_str);
 
@@ -2182,6 +9812,16 @@ dlna_src_head_response_init_struct (GstDlnaSrc * dlna_src,
   head_response->dtcp_range_end = 0;
   head_response->dtcp_range_total = 0;
 
+  // {"AVAILABLESEEKRANGE.DLNA.ORG", STRING_TYPE}
+  head_response->available_seek_idx = HEADER_INDEX_AVAILABLE_SEEK_RANGE;
+  head_response->available_seek_mode = -1;
+  head_response->available_seek_npt_received = FALSE;
+  head_response->available_seek_npt_start = 0;
+  head_response->available_seek_npt_end = 0;
+  head_response->available_seek_bytes_received = FALSE;
+  head_response->available_seek_byte_start = 0;
+  head_response->available_seek_byte_end = 0;
+
   // {"TRANSFERMODE.DLNA.ORG", STRING_TYPE}
   head_response->transfer_mode_idx = HEADER_INDEX_TRANSFERMODE;
   head_response->transfer_mode = NULL;
@@ -2408,6 +10048,15 @@ dlna_src_head_response_assign_field_value (GstDlnaSrc * dlna_src,
       }
       break;
 
+    case HEADER_INDEX_AVAILABLE_SEEK_RANGE:
+      if (!dlna_src_head_response_parse_available_seek (dlna_src,
+              head_response, idx, field_str)) {
+        GST_WARNING_OBJECT (dlna_src,
+            "Problems with HEAD response field header %s, value: %s",
+            HEAD_RESPONSE_HEADERS[idx], field_str);
+      }
+      break;
+
     case HEADER_INDEX_VARY:
     case HEADER_INDEX_PRAGMA:
     case HEADER_INDEX_CACHE_CONTROL:
@@ -2544,11 +10193,15 @@ dlna_src_head_response_parse_byte_range (GstDlnaSrc * dlna_src, gint idx,
     }
     if (tmp_str1 != NULL) {
       tmp_str1++;
-      // *TODO* - add logic to deal with '*'
-      if ((ret_code =
-              sscanf (tmp_str1,
-                  "%" G_GUINT64_FORMAT "-%" G_GUINT64_FORMAT "/%"
-                  G_GUINT64_FORMAT, &ullong1, &ullong2, &ullong3)) != 3) {
+      ret_code = sscanf (tmp_str1, "%" G_GUINT64_FORMAT "-%" G_GUINT64_FORMAT
+          "/%" G_GUINT64_FORMAT, &ullong1, &ullong2, &ullong3);
+      // Total of growing content is given as '*', range is still known
+      if ((ret_code == 2) && (strstr (tmp_str1, "/*") != NULL)) {
+        if (start_byte)
+          *start_byte = ullong1;
+        if (end_byte)
+          *end_byte = ullong2;
+      } else if (ret_code != 3) {
         GST_WARNING_OBJECT (dlna_src,
             "Problems parsing BYTES from HEAD response field headr %s, idx: %d, value: %s, retcode: %d, ullong: %"
             G_GUINT64_FORMAT ", %" G_GUINT64_FORMAT
@@ -2576,6 +10229,77 @@ dlna_src_head_response_parse_byte_range (GstDlnaSrc * dlna_src, gint idx,
   return TRUE;
 }
 
+/**
+ * Available seek range header formatting as specified in DLNA 7.5.4.3.2.20:
+ *
+ * availableSeekRange.dlna.org: 1 npt=0-4980.000 bytes=0-4280000000
+ *
+ * Either range may be omitted.
+ *
+ * @param	dlna_src	this element instance
+ * @param	idx			index which describes HEAD response field and type
+ * @param	field_str	string containing HEAD response field header and value
+ *
+ * @return	returns TRUE if mode could be parsed, false otherwise
+ */
+static gboolean
+dlna_src_head_response_parse_available_seek (GstDlnaSrc * dlna_src,
+    GstDlnaSrcHeadResponse * head_response, gint idx, gchar * field_str)
+{
+  char tmp1[32] = { 0 };
+  char tmp2[32] = { 0 };
+  char *tmp_str = NULL;
+  guint64 ullong1 = 0;
+  guint64 ullong2 = 0;
+
+  tmp_str = strstr (field_str, ":");
+  if ((tmp_str == NULL) ||
+      (sscanf (tmp_str + 1, "%d", &head_response->available_seek_mode) != 1)) {
+    GST_WARNING_OBJECT (dlna_src,
+        "No mode found in HEAD response field header %s, value: %s",
+        HEAD_RESPONSE_HEADERS[idx], field_str);
+    return FALSE;
+  }
+
+  tmp_str = strstr (field_str, TIME_SEEK_HEADERS[HEADER_INDEX_NPT]);
+  if ((tmp_str != NULL) && ((tmp_str = strstr (tmp_str, "=")) != NULL)) {
+    if ((sscanf (tmp_str + 1, "%31[^-]-%31[^ ]", tmp1, tmp2) == 2) &&
+        dlna_src_npt_to_nanos (dlna_src, tmp1,
+            &head_response->available_seek_npt_start) &&
+        dlna_src_npt_to_nanos (dlna_src, tmp2,
+            &head_response->available_seek_npt_end))
+      head_response->available_seek_npt_received = TRUE;
+    else
+      GST_WARNING_OBJECT (dlna_src,
+          "Problems parsing NPT from HEAD response field header %s, value: %s",
+          HEAD_RESPONSE_HEADERS[idx], field_str);
+  }
+
+  tmp_str = strstr (field_str, TIME_SEEK_HEADERS[HEADER_INDEX_BYTES]);
+  if ((tmp_str != NULL) && ((tmp_str = strstr (tmp_str, "=")) != NULL)) {
+    if (sscanf (tmp_str + 1, "%" G_GUINT64_FORMAT "-%" G_GUINT64_FORMAT,
+            &ullong1, &ullong2) == 2) {
+      head_response->available_seek_byte_start = ullong1;
+      head_response->available_seek_byte_end = ullong2;
+      head_response->available_seek_bytes_received = TRUE;
+    } else {
+      GST_WARNING_OBJECT (dlna_src,
+          "Problems parsing BYTES from HEAD response field header %s, value: %s",
+          HEAD_RESPONSE_HEADERS[idx], field_str);
+    }
+  }
+
+  GST_DEBUG_OBJECT (dlna_src, "Available seek range mode %d, npt %"
+      GST_TIME_FORMAT "-%" GST_TIME_FORMAT ", bytes %" G_GUINT64_FORMAT "-%"
+      G_GUINT64_FORMAT, head_response->available_seek_mode,
+      GST_TIME_ARGS (head_response->available_seek_npt_start),
+      GST_TIME_ARGS (head_response->available_seek_npt_end),
+      head_response->available_seek_byte_start,
+      head_response->available_seek_byte_end);
+
+  return TRUE;
+}
+
 /**
  * DTCP Range header formatting:
  *
@@ -3626,6 +11350,27 @@ dlna_src_npt_to_nanos (GstDlnaSrc * dlna_src, gchar * string,
   return ret;
 }
 
+/**
+ * Formats media time into npt string in seconds as used in TimeSeekRange
+ * requests, i.e. 335.100
+ *
+ * @param	dlna_src			this element
+ * @param	media_time_nanos	media time in nanoseconds
+ * @param	npt_str				returned npt string
+ * @param	npt_str_size		size of storage for npt string
+ */
+static void
+dlna_src_nanos_to_npt (GstDlnaSrc * dlna_src, guint64 media_time_nanos,
+    gchar * npt_str, gsize npt_str_size)
+{
+  g_snprintf (npt_str, npt_str_size, "%" G_GUINT64_FORMAT ".%03u",
+      media_time_nanos / GST_SECOND,
+      (guint) ((media_time_nanos % GST_SECOND) / GST_MSECOND));
+
+  GST_LOG_OBJECT (dlna_src, "Convert nanosecs %" G_GUINT64_FORMAT
+      " into npt str %s", media_time_nanos, npt_str);
+}
+
 /* entry point to initialize the plug-in
  * initialize the plug-in itself
  * register the element factories and other features
@@ -3640,6 +11385,11 @@ dlna_src_init (GstPlugin * dlna_src)
   GST_DEBUG_CATEGORY_INIT (gst_dlna_src_debug, "dlnasrc", 0,
       "MPEG+DLNA Player");
 
+  // In-bin decrypter is only selected through dtcp_decrypter_factory
+  if (!gst_element_register ((GstPlugin *) dlna_src,
+          GST_DLNA_DECRYPTER_FACTORY, GST_RANK_NONE, GST_TYPE_DLNA_DECRYPTER))
+    return FALSE;
+
   // *TODO* - setting  + 1 forces this element to get selected as src by playsrc2
   return gst_element_register ((GstPlugin *) dlna_src, "dlnasrc",
       GST_RANK_PRIMARY + 101,
@@ -43,6 +43,11 @@ G_BEGIN_DECLS
         (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_DLNA_SRC))
 
 #define PLAYSPEEDS_MAX_CNT 64
+#define DTCP_PCP_HEADER_SIZE 14
+
+// Name of sticky custom event carrying duration, size and seek index of
+// content downstream, see dlna_src_content_info_event()
+#define GST_DLNA_SRC_CONTENT_INFO "GstDlnaSrcContentInfo"
 
 typedef struct _GstDlnaSrc GstDlnaSrc;
 typedef struct _GstDlnaSrcClass GstDlnaSrcClass;
@@ -50,6 +55,11 @@ typedef struct _GstDlnaSrcClass GstDlnaSrcClass;
 typedef struct _GstDlnaSrcHeadResponse GstDlnaSrcHeadResponse;
 typedef struct _GstDlnaSrcHeadResponseContentFeatures GstDlnaSrcHeadResponseContentFeatures;
 
+typedef struct _GstDlnaSrcCacheBlock GstDlnaSrcCacheBlock;
+typedef struct _GstDlnaSrcPcpEntry GstDlnaSrcPcpEntry;
+typedef struct _GstDlnaSrcSeekAnchor GstDlnaSrcSeekAnchor;
+typedef struct _GstDlnaSrcRateSwitch GstDlnaSrcRateSwitch;
+
 /**
  * GstDlnaSrc:
  *
@@ -60,9 +70,108 @@ struct _GstDlnaSrc
     GstBin bin;
     GstElement* http_src;
     GstElement* dtcp_decrypter;
+    GstElement* dtcp_queue;
+    guint dtcp_queue_size;
+
+    // DTCP host and port the decrypter has authenticated with
+    gchar* dtcp_decrypter_factory;
+    gchar* dtcp_key_provider;
+    gchar* dtcp_decrypter_host;
+    guint dtcp_decrypter_port;
+
+    // PCPs seen in encrypted stream, used to align cleartext byte seeks
+    GArray* pcp_map;
+    gulong pcp_probe;
+    guint8 pcp_header[DTCP_PCP_HEADER_SIZE];
+    guint pcp_header_fill;
+    guint64 pcp_payload_remaining;
+    gboolean pcp_offsets_known;
+    guint64 pcp_clear_offset;
+    guint64 pcp_encrypted_offset;
 
     GstPad* src_pad;
 
+    // Caps of content determined from HEAD response, NULL if unknown
+    GstCaps* caps;
+
+    // Transport stream scan feeding seek index, packet size 0 if content
+    // is no transport stream
+    guint ts_packet_size;
+    guint ts_phase;
+    gboolean ts_resync;
+    GstBuffer* ts_sync_tail;
+    gint pcr_pid;
+    gboolean pcr_from_start;
+    gboolean pcr_base_known;
+    guint64 pcr_base;
+    guint64 pcr_scan_next;
+    GstClockTime pcr_last_indexed;
+
+    // Last PAT and PMT packets seen, sent again after transfer restarts
+    gint pmt_pid;
+    guint8 video_stream_type;
+    GstBuffer* pat_packet;
+    GstBuffer* pmt_packet;
+    guint8 pat_cc;
+    guint8 pmt_cc;
+
+    // Key frame filter of transport streams at high rates
+    gfloat keyframe_filter_rate;
+    gint keyframe_pid;
+    gboolean keyframe_passing;
+    GstBuffer* keyframe_rest;
+
+    // Emulation of rates server does not support
+    gboolean trick_mode_emulation;
+    GThread* trick_thread;
+    gint trick_running;
+    gint trick_sock;
+    gdouble trick_rate;
+    guint64 trick_position;
+    GstFormat trick_format;
+    guint64 trick_segment_stop;
+    guint32 trick_seqnum;
+
+    // Rate switches overlapping transfer of new rate with current one, switch
+    // over is made by thread pushing current transfer, guarded by event mutex
+    gboolean seamless_rate_switch;
+    GstDlnaSrcRateSwitch* rate_switch;
+    GstDlnaSrcRateSwitch* rate_switch_ready;
+    GThread* rate_switch_pusher;
+    GCond rate_switch_cond;
+
+    // HEAD requests share connection, issued from background threads too,
+    // round trip of last one is guarded by event mutex
+    GMutex head_mutex;
+    GstClockTime network_latency;
+
+    // Live edge of growing content, refreshed in background and extrapolated
+    // in between refreshes, guarded by event mutex
+    guint range_refresh_seconds;
+    GMutex refresh_mutex;
+    GCond refresh_cond;
+    GThread* refresh_thread;
+    gboolean refresh_thread_stop;
+    gboolean live_edge_known;
+    gboolean live_rates_known;
+    gint64 live_edge_sampled;
+    guint64 live_edge_time;
+    guint64 live_edge_bytes;
+    gdouble live_time_rate;
+    gdouble live_byte_rate;
+
+    // Low latency mode of live content, which is joined near its live edge
+    // and dropped while lagging behind it by more than target latency
+    guint live_latency;
+    gboolean live_catching_up;
+    gint64 live_catch_up_end;
+    guint64 live_dropped;
+    gboolean live_pcr_anchored;
+    gint live_pcr_pid;
+    guint64 live_pcr_anchor;
+    gint64 live_wall_anchor;
+    GstClockTime live_join_lag;
+
     GstElement* pipeline;
     GstBus* bus;
 
@@ -101,6 +210,101 @@ struct _GstDlnaSrc
     GMutex event_mutex;
     GCond event_cond;
     gulong event_probe;
+
+    // Segment stamped on data of transfer restarted by this element
+    gboolean segment_pending;
+    GstSegment segment;
+    guint32 segment_seqnum;
+    guint64 byte_offset;
+    gboolean offsets_known;
+
+    // Position of data last passed on, which rate switches continue from
+    guint64 last_pushed_offset;
+    GstClockTime last_pushed_time;
+
+    // Block cache used to serve src pad when operating in pull mode
+    gboolean pull_mode;
+    GMutex cache_mutex;
+    GHashTable* cache_blocks;
+    GQueue cache_lru;
+    guint cache_max_blocks;
+    gint cache_sock;
+    guint cache_epoch;
+
+    // Spare connection opened while seeking for requests issued by element,
+    // not used by souphttpsrc which makes its own connections
+    gboolean warm_connection;
+    GMutex warm_mutex;
+    gint warm_sock;
+    gchar* warm_addr;
+    guint warm_port;
+    gboolean warm_pending;
+
+    // Seek scheduler which coalesces bursts of seeks
+    guint seek_window;
+    GMutex seek_mutex;
+    GCond seek_cond;
+    GThread* seek_thread;
+    gboolean seek_thread_stop;
+    GstEvent* seek_pending;
+    gint64 seek_window_end;
+    gboolean seek_flushing;
+    guint32 seek_flush_seqnum;
+    guint seeks_issued;
+    guint seeks_dropped;
+
+    // Data of next item fetched ahead of time, sent ahead of first buffer
+    guint prefetch_seconds;
+    GstBuffer* prefetch_buffer;
+    gboolean prefetch_pushing;
+    gboolean range_headers_set;
+
+    // Persistent store of HEAD response and time to byte anchors of uri
+    gboolean metadata_cache;
+    gchar* shared_cache;
+    GArray* seek_index;
+    gboolean seek_index_dirty;
+    gint store_stale;
+    guint store_generation;
+
+    // HEAD responses replaced while streaming, freed once uri changes
+    GList* server_info_retired;
+};
+
+struct _GstDlnaSrcCacheBlock
+{
+    guint64 index;
+    GstBuffer* buffer;
+    GList lru_link;
+};
+
+struct _GstDlnaSrcPcpEntry
+{
+    guint64 clear_offset;
+    guint64 encrypted_offset;
+    guint32 clear_len;
+};
+
+struct _GstDlnaSrcSeekAnchor
+{
+    guint64 time;
+    guint64 offset;
+};
+
+struct _GstDlnaSrcRateSwitch
+{
+    GstDlnaSrc* dlna_src;
+    GThread* thread;
+    GstDlnaSrcRateSwitch* previous;
+    gint running;
+    gdouble rate;
+    GstFormat format;
+    guint64 start;
+    guint32 seqnum;
+    gint keyframe_pid;
+    GThread* pusher;
+    gboolean taking_over;
+    gboolean switched_over;
 };
 
 struct _GstDlnaSrcHeadResponse
@@ -145,6 +349,16 @@ struct _GstDlnaSrcHeadResponse
     guint64 dtcp_range_total;
     gint dtcp_range_idx;
 
+    // Window of limited operation content which can currently be seeked
+    gint available_seek_idx;
+    gint available_seek_mode;
+    gboolean available_seek_npt_received;
+    guint64 available_seek_npt_start;
+    guint64 available_seek_npt_end;
+    gboolean available_seek_bytes_received;
+    guint64 available_seek_byte_start;
+    guint64 available_seek_byte_end;
+
     gchar* transfer_mode;
     gint transfer_mode_idx;
 
@@ -205,6 +419,9 @@ struct _GstDlnaSrcHeadResponseContentFeatures
 struct _GstDlnaSrcClass
 {
     GstBinClass parent_class;
+
+    // Action signals
+    gboolean (*prefetch_uri) (GstDlnaSrc* dlna_src, const gchar* uri);
 };
 
 GType gst_dlna_src_get_type (void);